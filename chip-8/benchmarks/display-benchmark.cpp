@@ -0,0 +1,113 @@
+#include "benchmark/benchmark.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "chip8constants.hpp"
+#include "chip8machine.hpp"
+#include "display.hpp"
+#include "upscaler.hpp"
+
+namespace {
+void BM_DisplayClear(benchmark::State &bench) {
+  Emulator::Display display(Emulator::MAX_HEIGHT, Emulator::MAX_WIDTH);
+  for (auto _ : bench) {
+    display.clear();
+    benchmark::ClobberMemory();
+  }
+}
+BENCHMARK(BM_DisplayClear);
+
+void BM_DisplaySetPixel(benchmark::State &bench) {
+  Emulator::Display display(Emulator::MAX_HEIGHT, Emulator::MAX_WIDTH);
+  int pixel = 0;
+  for (auto _ : bench) {
+    display.set_pixel(pixel % Emulator::MAX_WIDTH,
+                      (pixel / Emulator::MAX_WIDTH) % Emulator::MAX_HEIGHT, 1);
+    pixel += 7;
+  }
+  bench.SetItemsProcessed(bench.iterations());
+}
+BENCHMARK(BM_DisplaySetPixel);
+
+// Blank screen, then a checkerboard, so that both pixel values are covered
+Emulator::Chip8Machine create_upscaled_machine(const bool checkerboard) {
+  Emulator::Chip8Machine machine;
+  machine.reset();
+  if (checkerboard) {
+    Emulator::MachineState state = machine.get_state();
+    for (int row = 0; row < Emulator::MAX_HEIGHT; row++) {
+      state.screen[row] = (row % 2 == 0) ? 0xAAAAAAAAAAAAAAAAu
+                                         : 0x5555555555555555u;
+    }
+    machine.set_state(state);
+  }
+  return machine;
+}
+
+void BM_Upscale(benchmark::State &bench) {
+  Emulator::Chip8Machine machine = create_upscaled_machine(bench.range(1));
+  Emulator::Upscaler upscaler(8, 8, bench.range(0) == 0
+                                        ? Emulator::PixelFormat::RGB565
+                                        : Emulator::PixelFormat::XRGB8888);
+  int width = upscaler.x_scale * machine.display_width;
+  int height = upscaler.y_scale * machine.display_height;
+  std::vector<unsigned char> frame_buffer(
+      width * height * upscaler.get_bytes_per_pixel());
+  for (auto _ : bench) {
+    upscaler.upscale(frame_buffer.data(), width, machine);
+    benchmark::ClobberMemory();
+  }
+  bench.SetBytesProcessed(bench.iterations() * frame_buffer.size());
+}
+BENCHMARK(BM_Upscale)->ArgNames({"xrgb8888", "checkerboard"})
+    ->Args({0, 0})->Args({0, 1})->Args({1, 0})->Args({1, 1});
+
+// Spans grow with the scale factor, and so does each copy
+void BM_UpscaleScale(benchmark::State &bench) {
+  Emulator::Chip8Machine machine = create_upscaled_machine(true);
+  Emulator::Upscaler upscaler(bench.range(0), bench.range(0));
+  int width = upscaler.x_scale * machine.display_width;
+  int height = upscaler.y_scale * machine.display_height;
+  std::vector<uint16_t> frame_buffer(width * height);
+  for (auto _ : bench) {
+    upscaler.upscale(frame_buffer.data(), width, machine);
+    benchmark::ClobberMemory();
+  }
+  bench.SetBytesProcessed(bench.iterations() * frame_buffer.size()
+                          * sizeof(uint16_t));
+}
+BENCHMARK(BM_UpscaleScale)->ArgName("scale")->Arg(1)->Arg(3)->Arg(4)->Arg(10);
+
+// Cost of changing the configuration:  the spans are precomputed again
+void BM_UpscalerCreate(benchmark::State &bench) {
+  for (auto _ : bench) {
+    Emulator::Upscaler upscaler(bench.range(0), bench.range(0));
+    benchmark::DoNotOptimize(&upscaler);
+  }
+}
+BENCHMARK(BM_UpscalerCreate)->ArgName("scale")->Arg(1)->Arg(8);
+
+// Baseline for BM_Upscale:  one output pixel at a time, as the upscaler
+// used to
+void BM_UpscaleOnePixelAtATime(benchmark::State &bench) {
+  Emulator::Chip8Machine machine = create_upscaled_machine(bench.range(0));
+  Emulator::Upscaler upscaler;
+  int width = upscaler.x_scale * machine.display_width;
+  int height = upscaler.y_scale * machine.display_height;
+  std::vector<uint16_t> frame_buffer(width * height);
+  for (auto _ : bench) {
+    for (int y = 0; y < height; y++) {
+      for (int x = 0; x < width; x++) {
+        bool on = machine.get_pixel(x / upscaler.x_scale,
+                                    y / upscaler.y_scale) != 0;
+        frame_buffer[y * width + x] = on ? 0xFFFF : 0;
+      }
+    }
+    benchmark::ClobberMemory();
+  }
+  bench.SetBytesProcessed(bench.iterations() * frame_buffer.size()
+                          * sizeof(uint16_t));
+}
+BENCHMARK(BM_UpscaleOnePixelAtATime)->ArgName("checkerboard")->Arg(0)->Arg(1);
+}  // namespace
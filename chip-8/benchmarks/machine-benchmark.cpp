@@ -0,0 +1,134 @@
+#include "benchmark/benchmark.h"
+
+#include <vector>
+
+#include "chip8machine.hpp"
+#include "machinestate.hpp"
+
+namespace {
+// Sprite data, away from the ROM and the font
+const Emulator::REG_TYPE SPRITE_ADDRESS = 0x300;
+
+Emulator::Chip8Machine create_machine() {
+  Emulator::Chip8Machine machine;
+  machine.reset();
+  Emulator::MachineState state = machine.get_state();
+  for (int reg = 0; reg < Emulator::NUM_V_REGS; reg++) {
+    state.v[reg] = static_cast<Emulator::REG_TYPE>(0x11 * reg);
+  }
+  state.i = SPRITE_ADDRESS;
+  for (int row = 0; row < 16; row++) {
+    state.ram[SPRITE_ADDRESS + row] = static_cast<Emulator::MEM_TYPE>(
+        0xA5 ^ (row * 0x1F));
+  }
+  machine.set_state(state);
+  return machine;
+}
+
+// One instruction per family, executed over and over through decode();
+// registers are left as the instruction leaves them
+void BM_Decode(benchmark::State &bench, const Emulator::OPCODE_TYPE opcode) {
+  Emulator::Chip8Machine machine = create_machine();
+  for (auto _ : bench) {
+    machine.decode(opcode);
+  }
+  bench.SetItemsProcessed(bench.iterations());
+}
+BENCHMARK_CAPTURE(BM_Decode, 00E0_clear, 0x00E0);
+BENCHMARK_CAPTURE(BM_Decode, 1NNN_jump, 0x1200);
+BENCHMARK_CAPTURE(BM_Decode, 3XNN_skip, 0x3122);
+BENCHMARK_CAPTURE(BM_Decode, 4XNN_skip, 0x4122);
+BENCHMARK_CAPTURE(BM_Decode, 6XNN_load, 0x6A42);
+BENCHMARK_CAPTURE(BM_Decode, 7XNN_add, 0x7A01);
+BENCHMARK_CAPTURE(BM_Decode, 8XY1_or, 0x8121);
+BENCHMARK_CAPTURE(BM_Decode, 8XY4_add, 0x8124);
+BENCHMARK_CAPTURE(BM_Decode, 8XY5_sub, 0x8125);
+BENCHMARK_CAPTURE(BM_Decode, 8XYE_shift, 0x812E);
+BENCHMARK_CAPTURE(BM_Decode, ANNN_load_i, 0xA300);
+BENCHMARK_CAPTURE(BM_Decode, BNNN_jump, 0xB200);
+BENCHMARK_CAPTURE(BM_Decode, CXNN_random, 0xC1FF);
+BENCHMARK_CAPTURE(BM_Decode, EX9E_key, 0xE19E);
+BENCHMARK_CAPTURE(BM_Decode, FX07_delay, 0xF107);
+BENCHMARK_CAPTURE(BM_Decode, FX15_delay, 0xF115);
+BENCHMARK_CAPTURE(BM_Decode, FX29_font, 0xF129);
+BENCHMARK_CAPTURE(BM_Decode, FX33_bcd, 0xFF33);
+BENCHMARK_CAPTURE(BM_Decode, FX55_store, 0xF755);
+BENCHMARK_CAPTURE(BM_Decode, FX65_load, 0xF765);
+
+// Calls cannot be repeated alone without overflowing the stack
+void BM_DecodeCallReturn(benchmark::State &bench) {
+  Emulator::Chip8Machine machine = create_machine();
+  for (auto _ : bench) {
+    machine.decode(0x2300);
+    machine.decode(0x00EE);
+  }
+  bench.SetItemsProcessed(2 * bench.iterations());
+}
+BENCHMARK(BM_DecodeCallReturn);
+
+// Sprite at (x, y), with the given number of rows;  positions which are not
+// a multiple of 8 straddle two bytes of the screen, and positions near the
+// bottom-right corner are clipped
+void BM_DrawSprite(benchmark::State &bench) {
+  Emulator::Chip8Machine machine = create_machine();
+  Emulator::MachineState state = machine.get_state();
+  state.v[0] = static_cast<Emulator::REG_TYPE>(bench.range(0));
+  state.v[1] = static_cast<Emulator::REG_TYPE>(bench.range(1));
+  machine.set_state(state);
+  const Emulator::OPCODE_TYPE opcode =
+      static_cast<Emulator::OPCODE_TYPE>(0xD010 | bench.range(2));
+  for (auto _ : bench) {
+    machine.decode(opcode);
+  }
+  bench.SetItemsProcessed(bench.iterations());
+}
+BENCHMARK(BM_DrawSprite)
+    ->ArgNames({"x", "y", "rows"})
+    ->Args({0, 0, 1})
+    ->Args({0, 0, 5})
+    ->Args({0, 0, 15})
+    ->Args({8, 8, 5})
+    ->Args({13, 8, 5})
+    ->Args({13, 8, 15})
+    ->Args({60, 28, 5})
+    ->Args({60, 28, 15});
+
+void BM_ClearScreen(benchmark::State &bench) {
+  Emulator::Chip8Machine machine = create_machine();
+  for (auto _ : bench) {
+    machine.clear_screen();
+    benchmark::ClobberMemory();
+  }
+}
+BENCHMARK(BM_ClearScreen);
+
+// Snapshot and rollback, as done by MachineFarm and rewind features
+void BM_GetState(benchmark::State &bench) {
+  Emulator::Chip8Machine machine = create_machine();
+  for (auto _ : bench) {
+    Emulator::MachineState snapshot = machine.get_state();
+    benchmark::DoNotOptimize(snapshot);
+  }
+  bench.SetBytesProcessed(bench.iterations() * sizeof(Emulator::MachineState));
+}
+BENCHMARK(BM_GetState);
+
+void BM_SetState(benchmark::State &bench) {
+  Emulator::Chip8Machine machine = create_machine();
+  Emulator::MachineState snapshot = machine.get_state();
+  for (auto _ : bench) {
+    machine.set_state(snapshot);
+  }
+  bench.SetBytesProcessed(bench.iterations() * sizeof(Emulator::MachineState));
+}
+BENCHMARK(BM_SetState);
+
+void BM_HashState(benchmark::State &bench) {
+  Emulator::Chip8Machine machine = create_machine();
+  for (auto _ : bench) {
+    benchmark::DoNotOptimize(Emulator::hash_state(machine.get_state()));
+  }
+  bench.SetBytesProcessed(bench.iterations() * sizeof(Emulator::MachineState));
+}
+BENCHMARK(BM_HashState);
+}  // namespace
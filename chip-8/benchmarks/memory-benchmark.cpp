@@ -0,0 +1,40 @@
+#include "benchmark/benchmark.h"
+
+#include <vector>
+
+#include "chip8constants.hpp"
+#include "chip8machine.hpp"
+#include "memory.hpp"
+
+namespace {
+std::vector<Emulator::MEM_TYPE> create_rom(const size_t size) {
+  std::vector<Emulator::MEM_TYPE> rom(size);
+  for (size_t index = 0; index < size; index++) {
+    rom[index] = static_cast<Emulator::MEM_TYPE>(index * 0x9D);
+  }
+  return rom;
+}
+
+void BM_MemoryLoadRom(benchmark::State &bench) {
+  Emulator::Memory memory(Emulator::RAM_SIZE, Emulator::ROM_START_ADDRESS);
+  std::vector<Emulator::MEM_TYPE> rom = create_rom(bench.range(0));
+  for (auto _ : bench) {
+    memory.load_rom(rom);
+    benchmark::ClobberMemory();
+  }
+  bench.SetBytesProcessed(bench.iterations() * rom.size());
+}
+BENCHMARK(BM_MemoryLoadRom)->Arg(256)->Arg(3584);
+
+// Also invalidates the predecoded instructions of the loaded range
+void BM_MachineLoadRom(benchmark::State &bench) {
+  Emulator::Chip8Machine machine;
+  machine.reset();
+  std::vector<Emulator::MEM_TYPE> rom = create_rom(bench.range(0));
+  for (auto _ : bench) {
+    machine.load_rom(rom);
+  }
+  bench.SetBytesProcessed(bench.iterations() * rom.size());
+}
+BENCHMARK(BM_MachineLoadRom)->Arg(256)->Arg(3584);
+}  // namespace
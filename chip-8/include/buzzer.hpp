@@ -0,0 +1,53 @@
+/// \file buzzer.hpp
+/// \brief Audio rendering of the buzzer driven by the sound timer
+
+#ifndef CHIP_8_INCLUDE_BUZZER_HPP_
+#define CHIP_8_INCLUDE_BUZZER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Emulator {
+
+/// \enum Waveform
+/// \brief Shape of one period of the tone of the buzzer
+enum class Waveform {
+  SQUARE,
+  TRIANGLE,
+  SINE
+};
+
+/// \class Buzzer
+/// \brief Renders the tone of the buzzer one video frame at a time
+///
+/// One period of the tone is precomputed into a wavetable, which is read
+/// with a fixed-point phase accumulator, so that no sample is computed
+/// while running and the phase carries over from one frame to the next.
+/// Samples are stereo, interleaved, into a buffer allocated once.
+class Buzzer {
+ public:
+  explicit Buzzer(int = 44100, int = 60, double = 420.0,
+                  Waveform = Waveform::SQUARE, int16_t = 8192);
+
+  const int16_t *render_frame(bool);
+  size_t get_frames_per_video_frame() const;
+
+  /// \var sample_rate
+  /// \brief Number of audio frames (one sample per channel) per second
+  const int sample_rate;
+
+  /// \var frequency
+  /// \brief Frequency of the tone (in Hz)
+  const double frequency;
+
+ private:
+  std::vector<int16_t> wavetable;
+  std::vector<int16_t> samples;
+  uint32_t phase;
+  uint32_t phase_step;
+};
+
+}  // namespace Emulator
+
+#endif  // CHIP_8_INCLUDE_BUZZER_HPP_
@@ -4,6 +4,8 @@
 #ifndef CHIP_8_INCLUDE_CHIP8CONSTANTS_HPP_
 #define CHIP_8_INCLUDE_CHIP8CONSTANTS_HPP_
 
+#include <cstdint>
+
 namespace Emulator {
 
 /// \var INSTRUCTION_LENGTH
@@ -14,6 +16,14 @@ const int INSTRUCTION_LENGTH = 2;
 /// \brief Number of general-purpose registers
 const int NUM_V_REGS = 16;
 
+/// \var NUM_KEYS
+/// \brief Number of keys on the hexadecimal keypad
+const int NUM_KEYS = 16;
+
+/// \var STACK_DEPTH
+/// \brief Maximum number of nested subroutine calls
+const int STACK_DEPTH = 16;
+
 /// \var MAX_HEIGHT
 /// \brief Height of screen (in number of pixels)
 const int MAX_HEIGHT = 32;
@@ -22,6 +32,10 @@ const int MAX_HEIGHT = 32;
 /// \brief Width of screen (in number of pixels)
 const int MAX_WIDTH = 64;
 
+/// \var ALL_ROWS
+/// \brief Mask of rows covering the whole screen, bit y standing for row y
+const uint64_t ALL_ROWS = (uint64_t{1} << MAX_HEIGHT) - 1;
+
 /// \var RAM_SIZE
 /// \brief Total number of bytes in RAM
 const int RAM_SIZE = 0x1000;
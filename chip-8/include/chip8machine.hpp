@@ -4,32 +4,137 @@
 #ifndef CHIP_8_INCLUDE_CHIP8MACHINE_HPP_
 #define CHIP_8_INCLUDE_CHIP8MACHINE_HPP_
 
-#include <chrono>  // NOLINT
+#include <array>
+#include <bitset>
 #include <cstdint>
 #include <iomanip>
-#include <random>
-#include <stack>
+#include <memory>
 #include <stdexcept>
 #include <string>
-#include <thread>  // NOLINT
+#include <unordered_map>
 #include <vector>
 
 #include "chip8constants.hpp"
 #include "chip8types.hpp"
-#include "display.hpp"
-#include "memory.hpp"
-#include "programcounter.hpp"
-#include "register.hpp"
+#include "machinestate.hpp"
+#include "profiler.hpp"
+#include "quirks.hpp"
+#include "recompiler.hpp"
 
 /// \namespace Emulator
 /// \brief Contains all Emulator definitions
 namespace Emulator {
 
+/// \enum RunStatus
+/// \brief Reason for a batch of instructions to end
+enum class RunStatus {
+  /// Every requested instruction was executed
+  OK,
+  /// The program jumped to itself or ran off the end of RAM
+  HALTED,
+  /// The next instruction is not supported, and was not executed
+  UNSUPPORTED_OPCODE,
+  /// An FX0A instruction is waiting for a key to be pressed
+  WAITING_FOR_KEY,
+  /// An instruction faulted, see Chip8Machine::get_fault()
+  FAULTED
+};
+
+/// \enum TimingModel
+/// \brief How the length of a frame is measured by run_frame()
+enum class TimingModel {
+  /// A frame is a fixed number of instructions
+  INSTRUCTIONS,
+  /// A frame is 1/60 s of a COSMAC VIP, each instruction costing as many
+  /// machine cycles as on the original interpreter
+  COSMAC_VIP
+};
+
+/// \enum Fault
+/// \brief Error detected while executing instructions
+enum class Fault {
+  /// No error
+  NONE,
+  /// Instruction is not part of the instruction set
+  UNSUPPORTED_OPCODE,
+  /// Register number outside of V0-VF, passed to get_v() or set_v()
+  INVALID_REGISTER,
+  /// Return (00EE) with an empty call stack
+  STACK_UNDERFLOW,
+  /// Call (2NNN) with STACK_DEPTH calls already active
+  STACK_OVERFLOW
+};
+
+/// \struct FaultInfo
+/// \brief First error detected since the fault was last cleared
+struct FaultInfo {
+  /// \var code
+  /// \brief Kind of error, Fault::NONE if no error occurred
+  Fault code;
+
+  /// \var pc
+  /// \brief Address of the faulting instruction;  for
+  ///        Fault::INVALID_REGISTER, the program counter at the time of the
+  ///        call
+  ADDR_TYPE pc;
+
+  /// \var opcode
+  /// \brief Faulting instruction;  0 for Fault::INVALID_REGISTER, raised by
+  ///        register accessors outside of any instruction (instructions
+  ///        only name V0-VF)
+  OPCODE_TYPE opcode;
+};
+
 /// \class Chip8Machine
 /// \brief Main object for running CHIP-8 emulation
 class Chip8Machine {
  public:
   Chip8Machine();
+  explicit Chip8Machine(QuirksProfile);
+
+  struct DecodedInstruction;
+
+  /// \var OpcodeHandler
+  /// \brief Member function executing one family of instructions
+  typedef void (Chip8Machine::*OpcodeHandler)(const DecodedInstruction &);
+
+  /// \struct DecodedInstruction
+  /// \brief Instruction with its operand fields already extracted
+  struct DecodedInstruction {
+    explicit DecodedInstruction(OPCODE_TYPE = 0x0000);
+
+    /// \var handler
+    /// \brief Handler executing the instruction, nullptr if not resolved
+    OpcodeHandler handler;
+
+    /// \var opcode
+    /// \brief Raw instruction
+    OPCODE_TYPE opcode;
+
+    /// \var x
+    /// \brief Register number stored in the second nibble
+    uint8_t x;
+
+    /// \var y
+    /// \brief Register number stored in the third nibble
+    uint8_t y;
+
+    /// \var n
+    /// \brief Value stored in the lowest nibble
+    uint8_t n;
+
+    /// \var nn
+    /// \brief Value stored in the lowest byte
+    uint8_t nn;
+
+    /// \var nnn
+    /// \brief Address stored in the lowest three nibbles
+    uint16_t nnn;
+
+    /// \var handler_index
+    /// \brief Position of the handler in the threaded interpreter's table
+    uint8_t handler_index;
+  };
 
   friend class Chip8MachineTester;
   // Bad, but unavoidable for now
@@ -49,42 +154,175 @@ class Chip8Machine {
   /// \brief Total number of bytes in RAM
   const ADDR_TYPE memory_size;
 
-  const PIXEL_TYPE &get_pixel(int, int) const;
+  PIXEL_TYPE get_pixel(int, int) const;
+  const std::array<uint64_t, MAX_HEIGHT> &get_screen() const;
+  uint64_t get_dirty_rows() const;
+  bool is_frame_changed() const;
+  void clear_dirty_rows();
 
   void *get_pointer_to_ram_start() const;
 
   void clear_screen();
   void load_rom(const std::vector<MEM_TYPE> &);
   void decode(OPCODE_TYPE);
+  Fault execute(OPCODE_TYPE);
   void advance();
+  RunStatus run_cycles(int);
+  RunStatus run_frame(int);
+  void run(int);
+  bool set_recompiler(bool);
+  bool set_profiler(bool);
+  const Profiler *get_profiler() const;
+  QuirksProfile get_quirks_profile() const;
+  void set_quirks_profile(QuirksProfile);
+  TimingModel get_timing_model() const;
+  void set_timing_model(TimingModel);
   void reset();
   void trigger_delay_timer();
-  // Note:  the following two subroutines are not unit tested, since they deal
-  //        with threads
-  void start_timers();
-  void kill_timers();
+  void tick_60hz();
+  bool is_sound_playing() const;
   void set_seed(int);
+  void set_key(int, bool);
+
+  const MachineState &get_state() const;
+  void set_state(const MachineState &);
+  uint64_t get_elided_cycles() const;
+
+  const FaultInfo &get_fault() const;
+  void clear_fault();
 
   std::string display_str() const;
   explicit operator std::string() const;
 
-  bool kill_threads;
-  bool timers_started;
-
  private:
-  Display display;
-  Memory ram;
-  ProgramCounter pc;
-  Register i_register;
-  std::array<Register, NUM_V_REGS> v_register;
-  std::stack<ADDR_TYPE> call_stack;
-  unsigned char delay_timer;
-  std::vector<std::thread> threads;
-
-  std::mt19937 generator;
-  std::uniform_int_distribution<OPCODE_TYPE> distribution;
+  MachineState state;
+  std::bitset<NUM_KEYS> keys;
+  bool waiting_for_key;
+
+  // Mutable so that const accessors may report bad arguments
+  mutable FaultInfo fault;
+
+  uint64_t elided_cycles;
+
+  // Bit y is set once row y of the screen may have changed, until
+  // clear_dirty_rows()
+  uint64_t dirty_rows;
+
+  // Whether the sound timer was running when the timers last ticked
+  bool sound_playing;
+
+  void mark_rows_dirty(uint64_t);
+
+  void raise_fault(Fault, ADDR_TYPE, OPCODE_TYPE) const;
+  void throw_if_faulted();
+  void step();
+
+  std::array<DecodedInstruction, RAM_SIZE / INSTRUCTION_LENGTH>
+      instruction_cache;
+
+  /// \enum IdleLoop
+  /// \brief Busy-wait loop starting with a basic block, see skip_idle_loop()
+  enum class IdleLoop {
+    /// Not the start of a recognized loop
+    NONE,
+    /// FX07 then 3XNN or 4XNN on VX, followed by a jump back to the FX07
+    DELAY_TIMER,
+    /// EX9E or EXA1, followed by a jump back to it
+    KEY
+  };
+
+  /// \struct BasicBlock
+  /// \brief Straight-line run of instructions ending in a control transfer
+  struct BasicBlock {
+    /// \var start
+    /// \brief Address of the first instruction in the block
+    ADDR_TYPE start;
+
+    /// \var end
+    /// \brief Address one past the last byte of the block
+    ADDR_TYPE end;
+
+    /// \var instructions
+    /// \brief Predecoded instructions, in execution order
+    std::vector<DecodedInstruction> instructions;
+
+    /// \var executions
+    /// \brief Number of times the block was entered while not compiled
+    int executions;
+
+    /// \var native
+    /// \brief Compiled code for the first n_native instructions, if any
+    Recompiler::NativeBlock native;
+
+    /// \var n_native
+    /// \brief Number of instructions executed by the compiled code
+    int n_native;
+
+    /// \var idle_loop
+    /// \brief Kind of busy-wait loop the block may start
+    IdleLoop idle_loop;
+  };
+
+  std::unordered_map<ADDR_TYPE, BasicBlock> block_cache;
+  std::bitset<RAM_SIZE> block_code;
+
+  std::unique_ptr<Recompiler> recompiler;
+  std::unique_ptr<Profiler> profiler;
+
+  void execute_profiled(const DecodedInstruction &, ADDR_TYPE);
+  static std::vector<std::string> handler_names();
+
+  /// \struct HandlerTables
+  /// \brief Dispatch tables for one quirk policy
+  struct HandlerTables {
+    /// \var opcode
+    /// \brief Handlers indexed by the high nibble of the instruction
+    std::array<OpcodeHandler, 0x10> opcode;
+
+    /// \var arithmetic
+    /// \brief 8XYN handlers indexed by N
+    std::array<OpcodeHandler, 0x10> arithmetic;
+
+    /// \var key
+    /// \brief EXNN handlers indexed by NN
+    std::array<OpcodeHandler, 0x100> key;
+
+    /// \var misc
+    /// \brief FXNN handlers indexed by NN
+    std::array<OpcodeHandler, 0x100> misc;
+
+    /// \var resolved
+    /// \brief Every handler predecode() may return, in threaded dispatch order
+    std::vector<OpcodeHandler> resolved;
+
+    /// \var run_threaded
+    /// \brief Threaded interpreter instantiated for the same policy
+    void (Chip8Machine::*run_threaded)(int);
+
+    /// \var logic_resets_vf
+    /// \brief Whether 8XY1/8XY2/8XY3 reset VF, for the recompiler
+    bool logic_resets_vf;
+  };
+
+  QuirksProfile quirks_profile;
+  const HandlerTables *handlers;
+  TimingModel timing_model;
+
+  BasicBlock &find_block(ADDR_TYPE);
+  void compile_block(BasicBlock &);
+  void discard_native_code();
+  void invalidate_blocks(ADDR_TYPE, ADDR_TYPE);
+  static bool ends_block(const DecodedInstruction &);
+  RunStatus run_vip_frame();
+  int vip_cycles(const DecodedInstruction &) const;
+  static IdleLoop classify_idle_loop(const BasicBlock &);
+  int skip_idle_loop(const BasicBlock &, int);
+  template <class Quirks> void run_threaded(int);
 
   OPCODE_TYPE fetch_instruction() const;
+  void invalidate_instructions(ADDR_TYPE, ADDR_TYPE);
+  void invalidate_all_instructions();
+  REG_TYPE next_random_byte();
 
   std::vector<MEM_TYPE> get_ram(bool = true) const;
   MEM_TYPE get_memory_byte(ADDR_TYPE) const;
@@ -94,6 +332,7 @@ class Chip8Machine {
   ADDR_TYPE get_pc() const;
   ADDR_TYPE get_top_of_stack() const;
   REG_TYPE get_delay_timer() const;
+  REG_TYPE get_sound_timer() const;
 
   void set_pixel(int, int, PIXEL_TYPE);
   void set_memory_byte(ADDR_TYPE, MEM_TYPE);
@@ -103,6 +342,50 @@ class Chip8Machine {
   void set_pc(ADDR_TYPE);
   void add_to_stack(ADDR_TYPE);
   void set_delay_timer(REG_TYPE);
+  void set_sound_timer(REG_TYPE);
+
+  static const HandlerTables &handler_tables(QuirksProfile);
+  template <class Quirks> static HandlerTables build_handler_tables();
+  OpcodeHandler resolve_handler(OPCODE_TYPE) const;
+  DecodedInstruction predecode(OPCODE_TYPE) const;
+  uint8_t find_handler_index(OpcodeHandler) const;
+
+  void op_unsupported(const DecodedInstruction &);
+  void op_0NNN(const DecodedInstruction &);
+  void op_00E0(const DecodedInstruction &);
+  void op_00EE(const DecodedInstruction &);
+  void op_1NNN(const DecodedInstruction &);
+  void op_2NNN(const DecodedInstruction &);
+  void op_3XNN(const DecodedInstruction &);
+  void op_4XNN(const DecodedInstruction &);
+  void op_6XNN(const DecodedInstruction &);
+  void op_7XNN(const DecodedInstruction &);
+  void op_8XYN(const DecodedInstruction &);
+  void op_8XY0(const DecodedInstruction &);
+  template <class Quirks> void op_8XY1(const DecodedInstruction &);
+  template <class Quirks> void op_8XY2(const DecodedInstruction &);
+  template <class Quirks> void op_8XY3(const DecodedInstruction &);
+  void op_8XY4(const DecodedInstruction &);
+  void op_8XY5(const DecodedInstruction &);
+  template <class Quirks> void op_8XY6(const DecodedInstruction &);
+  void op_8XY7(const DecodedInstruction &);
+  template <class Quirks> void op_8XYE(const DecodedInstruction &);
+  void op_ANNN(const DecodedInstruction &);
+  template <class Quirks> void op_BNNN(const DecodedInstruction &);
+  void op_CXNN(const DecodedInstruction &);
+  template <class Quirks> void op_DXYN(const DecodedInstruction &);
+  void op_EXNN(const DecodedInstruction &);
+  void op_EX9E(const DecodedInstruction &);
+  void op_EXA1(const DecodedInstruction &);
+  void op_FXNN(const DecodedInstruction &);
+  void op_FX07(const DecodedInstruction &);
+  void op_FX0A(const DecodedInstruction &);
+  void op_FX15(const DecodedInstruction &);
+  void op_FX18(const DecodedInstruction &);
+  void op_FX29(const DecodedInstruction &);
+  void op_FX33(const DecodedInstruction &);
+  template <class Quirks> void op_FX55(const DecodedInstruction &);
+  template <class Quirks> void op_FX65(const DecodedInstruction &);
 };
 
 /// \class OpcodeNotSupported
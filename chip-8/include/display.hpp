@@ -4,6 +4,7 @@
 #ifndef CHIP_8_INCLUDE_DISPLAY_HPP_
 #define CHIP_8_INCLUDE_DISPLAY_HPP_
 
+#include <cstdint>
 #include <iomanip>
 #include <string>
 #include <vector>
@@ -12,30 +13,65 @@
 
 namespace Emulator {
 
+/// \var MAX_ROW_WIDTH
+/// \brief Width of the widest packed row (in number of pixels)
+const int MAX_ROW_WIDTH = 64;
+
+/// \brief Return the pixels covered by one row of a sprite
+///
+/// Rows are packed in a word, the leftmost pixel being the most significant
+/// bit.  Pixels past the right edge are clipped, or wrapped around to the
+/// left edge.
+///
+/// \param byte Row of the sprite, the leftmost pixel being the most
+///        significant bit
+/// \param x Column of the leftmost pixel of the sprite, less than width
+/// \param width Width of the row (in number of pixels)
+/// \param wrap Whether pixels past the right edge wrap around
+/// \return Mask of the pixels to flip
+inline uint64_t get_sprite_row_bits(const MEM_TYPE byte, const int x,
+                                    const int width, const bool wrap) {
+  uint64_t sprite = static_cast<uint64_t>(byte) << (MAX_ROW_WIDTH - 8);
+  uint64_t bits = sprite >> x;
+  if (wrap && x > width - 8) bits |= sprite << (width - x);
+  return bits & (~uint64_t{0} << (MAX_ROW_WIDTH - width));
+}
+
 /// \class Display
 /// \brief Representation of the display by the machine (no upscaling!)
+///
+/// Pixels are stored one bit each, one word per row, so that a row of a
+/// sprite is drawn with a single XOR (see draw_sprite_row()).
 class Display {
  public:
-  Display(int, int, PIXEL_TYPE = 0);
+  Display(int, int, PIXEL_TYPE = 0, PIXEL_TYPE = 1);
 
   /// \var width
-  /// \brief Width of screen (in number of pixels)
+  /// \brief Width of screen (in number of pixels), at most MAX_ROW_WIDTH
   const int width;
 
   /// \var height
-  /// \brief Width of display (in number of pixels)
+  /// \brief Height of display (in number of pixels)
   const int height;
 
   /// \var off_pixel
   /// \brief Value for pixel when "off"; all other values assumed "on"
   const PIXEL_TYPE off_pixel;
 
-  const PIXEL_TYPE &get_pixel(int, int) const;
+  /// \var on_pixel
+  /// \brief Value returned by get_pixel() for pixels which are "on"
+  const PIXEL_TYPE on_pixel;
+
+  PIXEL_TYPE get_pixel(int, int) const;
   void set_pixel(int, int, PIXEL_TYPE);
+  bool draw_sprite_row(int, int, MEM_TYPE, bool = false);
+  uint64_t get_row(int) const;
+  const std::vector<uint64_t> &get_rows() const;
+  void set_rows(const std::vector<uint64_t> &);
   void clear();
   explicit operator std::string() const;
  private:
-  std::vector<std::vector<PIXEL_TYPE> > screen;
+  std::vector<uint64_t> rows;
 };
 
 }  // namespace Emulator
@@ -0,0 +1,54 @@
+/// \file framebuffer.hpp
+/// \brief Double-buffered storage for upscaled frames
+
+#ifndef CHIP_8_INCLUDE_FRAMEBUFFER_HPP_
+#define CHIP_8_INCLUDE_FRAMEBUFFER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace Emulator {
+
+/// \var CACHE_LINE_SIZE
+/// \brief Alignment of the buffers and of each of their lines (in bytes)
+const size_t CACHE_LINE_SIZE = 64;
+
+/// \class FrameBuffer
+/// \brief Two upscaled frames, one being drawn while the other is presented
+///
+/// Frames are drawn into the back buffer, then present() makes it the front
+/// buffer, which stays untouched until the following present() so that the
+/// frontend may still read it.  Each buffer remembers the rows of the
+/// display changed since it was last drawn, so that only those are drawn
+/// again.  Both buffers start cache-line aligned, and so does every line.
+/// Memory is only allocated again when the geometry changes.
+class FrameBuffer {
+ public:
+  FrameBuffer();
+
+  bool set_geometry(int, int, int);
+  void mark_rows_changed(uint64_t);
+  uint64_t get_stale_rows() const;
+  void *get_back_buffer();
+  const void *get_front_buffer() const;
+  void present();
+
+  int get_width() const;
+  int get_height() const;
+  size_t get_pitch() const;
+
+ private:
+  int width;
+  int height;
+  int bytes_per_pixel;
+  size_t pitch;
+  std::unique_ptr<unsigned char[]> storage;
+  unsigned char *buffers[2];
+  uint64_t stale_rows[2];
+  int back;
+};
+
+}  // namespace Emulator
+
+#endif  // CHIP_8_INCLUDE_FRAMEBUFFER_HPP_
@@ -27,13 +27,18 @@
 #include <stddef.h>
 #include <limits.h>
 
+#include <algorithm>
 #include <cmath>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
-#include <random>
+#include <memory>
 
+#include "buzzer.hpp"
 #include "chip8machine.hpp"
+#include "framebuffer.hpp"
+#include "memory.hpp"
 #include "upscaler.hpp"
 
 #ifdef __cplusplus
@@ -3080,6 +3085,13 @@ RETRO_API void chip8machine_run(Chip8Machine &, bool = false);
 RETRO_API bool chip8machine_load_game(const struct retro_game_info *game, Chip8Machine &);
 RETRO_API void *chip8machine_get_memory_data(unsigned int, const Chip8Machine &);
 RETRO_API size_t chip8machine_get_memory_size(unsigned int, const Chip8Machine &);
+// The upscaler is shared by every machine;  retro_* calls configure it from
+// the core options
+RETRO_API const Upscaler &chip8machine_get_upscaler();
+RETRO_API void chip8machine_set_upscaler(const Upscaler &);
+// Instructions executed by each chip8machine_run(), before the timers tick
+RETRO_API int chip8machine_get_instructions_per_frame();
+RETRO_API void chip8machine_set_instructions_per_frame(int);
 
 }  // namespace Emulator
 
@@ -0,0 +1,121 @@
+/// \file machinebatch.hpp
+/// \brief Many CHIP-8 machines executed in lockstep, stored as arrays of
+///        registers
+
+#ifndef CHIP_8_INCLUDE_MACHINEBATCH_HPP_
+#define CHIP_8_INCLUDE_MACHINEBATCH_HPP_
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "chip8constants.hpp"
+#include "chip8machine.hpp"
+#include "chip8types.hpp"
+#include "machinestate.hpp"
+#include "quirks.hpp"
+
+namespace Emulator {
+
+/// \class MachineBatch
+/// \brief Many CHIP-8 machines running the same program in lockstep
+///
+/// The state of every machine is stored as a structure of arrays:  each
+/// register, timer, stack slot and screen row is an array holding its value
+/// for every machine.  At every step, machines about to execute the same
+/// instruction at the same address are grouped, and register-only
+/// instructions are executed for the whole group with vector instructions.
+/// Other instructions, and machines whose execution diverged from the rest,
+/// are executed one machine at a time.
+///
+/// Every machine behaves as a Chip8Machine stepped with run_cycles() and
+/// tick_60hz(), except that faults stop the faulting machine without
+/// throwing.  There is no buzzer:  sound timers only count down.
+class MachineBatch {
+ public:
+  MachineBatch(const Chip8Machine &, size_t);
+
+  static const char *get_vector_extension();
+
+  size_t size() const;
+
+  MachineState get_state(size_t) const;
+  void set_state(size_t, const MachineState &);
+  void set_seed(size_t, int);
+  void set_key(size_t, int, bool);
+  PIXEL_TYPE get_pixel(size_t, int, int) const;
+
+  uint64_t run(int);
+  void tick_60hz();
+
+  RunStatus get_status(size_t) const;
+  const FaultInfo &get_fault(size_t) const;
+
+  uint64_t get_vector_steps() const;
+  uint64_t get_scalar_steps() const;
+
+ private:
+  size_t n_machines;
+
+  // Arrays are padded to a whole number of vector blocks;  padding lanes
+  // are never running
+  size_t n_lanes;
+
+  // Register VX of machine m is v[X * n_lanes + m], and so on for the other
+  // arrays holding more than one value per machine
+  std::vector<uint8_t> v;
+  std::vector<uint16_t> i;
+  std::vector<uint16_t> pc;
+  std::vector<uint8_t> sp;
+  std::vector<uint8_t> delay_timer;
+  std::vector<uint8_t> sound_timer;
+  std::vector<uint32_t> rng;
+  std::vector<uint16_t> keys;
+  std::vector<uint16_t> stack;
+  std::vector<uint64_t> screen;
+
+  // RAM is too large to interleave;  machine m owns RAM_SIZE bytes from
+  // m * RAM_SIZE.  Instructions are fetched from a RAM image shared by every
+  // machine, unless the machine wrote to the 64-byte page holding them (bit
+  // p of dirty_pages[m] set for page p)
+  std::vector<MEM_TYPE> ram;
+  std::array<MEM_TYPE, RAM_SIZE> shared_ram;
+  std::vector<uint64_t> dirty_pages;
+
+  std::vector<RunStatus> status;
+  std::vector<FaultInfo> faults;
+
+  // Masks of the machines yet to execute the current step, and of the
+  // machines executing the current instruction:  0xFF if so, 0x00 if not
+  std::vector<uint8_t> pending;
+  std::vector<uint8_t> group;
+
+  // Immediate operands and skip results, one byte per machine
+  std::vector<uint8_t> scratch;
+
+  uint64_t vector_steps;
+  uint64_t scalar_steps;
+
+  uint64_t (MachineBatch::*run_policy)(int);
+
+  typedef Chip8Machine::DecodedInstruction DecodedInstruction;
+
+  template <class Quirks> uint64_t run_steps(int);
+  template <class Quirks> bool execute_group(const DecodedInstruction &,
+                                             size_t, size_t);
+  template <class Quirks> void execute_lane(size_t,
+                                            const DecodedInstruction &);
+  template <class Quirks> void draw_sprite(size_t,
+                                           const DecodedInstruction &);
+
+  OPCODE_TYPE fetch_instruction(size_t) const;
+  MEM_TYPE read_memory(size_t, ADDR_TYPE) const;
+  void write_memory(size_t, ADDR_TYPE, MEM_TYPE);
+  uint8_t next_random_byte(size_t);
+  void advance_group_pc(const uint8_t *, size_t, size_t);
+  void stop_lane(size_t, RunStatus, Fault, ADDR_TYPE, OPCODE_TYPE);
+};
+
+}  // namespace Emulator
+
+#endif  // CHIP_8_INCLUDE_MACHINEBATCH_HPP_
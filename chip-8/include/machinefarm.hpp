@@ -0,0 +1,193 @@
+/// \file machinefarm.hpp
+/// \brief Pool of worker threads running independent machines to completion
+
+#ifndef CHIP_8_INCLUDE_MACHINEFARM_HPP_
+#define CHIP_8_INCLUDE_MACHINEFARM_HPP_
+
+#include <array>
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "chip8constants.hpp"
+#include "chip8machine.hpp"
+#include "chip8types.hpp"
+#include "quirks.hpp"
+
+namespace Emulator {
+
+/// \struct KeyEvent
+/// \brief Key pressed or released at the start of a frame
+struct KeyEvent {
+  /// \var frame
+  /// \brief Frame before which the key changes, counting from zero
+  uint64_t frame;
+
+  /// \var key
+  /// \brief Key to update, from 0x0 to 0xF
+  int key;
+
+  /// \var pressed
+  /// \brief Whether the key is held down from this frame on
+  bool pressed;
+};
+
+/// \struct FarmJob
+/// \brief Program, input and budget of one machine
+struct FarmJob {
+  /// \var rom
+  /// \brief ROM loaded at ROM_START_ADDRESS
+  std::vector<MEM_TYPE> rom;
+
+  /// \var quirks
+  /// \brief Quirk policy of the machine
+  QuirksProfile quirks = QuirksProfile::DEFAULT;
+
+  /// \var inputs
+  /// \brief Input script, sorted by frame
+  std::vector<KeyEvent> inputs;
+
+  /// \var cycle_budget
+  /// \brief Number of instructions to run for, stopping earlier if the
+  ///        program halts or faults
+  uint64_t cycle_budget = 0;
+
+  /// \var instructions_per_frame
+  /// \brief Instructions between two timer ticks, see
+  ///        Chip8Machine::run_frame()
+  int instructions_per_frame = 10;
+
+  /// \var seed
+  /// \brief Seed of the random number generator
+  int seed = 0;
+};
+
+/// \struct FarmResult
+/// \brief Final state of the machine of one job
+struct FarmResult {
+  /// \var job
+  /// \brief Number returned by MachineFarm::submit()
+  size_t job;
+
+  /// \var status
+  /// \brief Why the last frame ended
+  RunStatus status;
+
+  /// \var fault
+  /// \brief Error which stopped the machine, if any
+  FaultInfo fault;
+
+  /// \var cycles
+  /// \brief Instructions budgeted to the frames run, including those
+  ///        skipped in idle loops;  the last frame may have stopped early
+  uint64_t cycles;
+
+  /// \var state_hash
+  /// \brief hash_state() of the final state
+  uint64_t state_hash;
+
+  /// \var screen
+  /// \brief Final framebuffer, one word per row as in MachineState
+  std::array<uint64_t, MAX_HEIGHT> screen;
+};
+
+/// \struct WorkerStats
+/// \brief Throughput counters of one worker thread
+struct WorkerStats {
+  /// \var jobs
+  /// \brief Number of jobs run
+  uint64_t jobs;
+
+  /// \var stolen
+  /// \brief Number of those jobs taken from another worker's queue
+  uint64_t stolen;
+
+  /// \var cycles
+  /// \brief Instructions run, all jobs included
+  uint64_t cycles;
+
+  /// \var busy_nanoseconds
+  /// \brief Time spent running jobs
+  uint64_t busy_nanoseconds;
+};
+
+/// \class MachineFarm
+/// \brief Pool of worker threads running independent machines to completion
+///
+/// Each worker owns a queue of jobs.  Submitted jobs are dealt to the queues
+/// in turn;  workers take the most recent job of their own queue, and steal
+/// the oldest job of another queue once theirs is empty.  Machines run at
+/// full speed:  timers tick once per frame of run_frame(), instead of being
+/// driven by a timer thread, so results do not depend on scheduling.
+///
+/// Jobs are submitted, and results collected, from a single thread.
+class MachineFarm {
+ public:
+  explicit MachineFarm(size_t = 0);
+  ~MachineFarm();
+
+  size_t get_n_workers() const;
+
+  size_t submit(FarmJob);
+  std::vector<FarmResult> wait();
+  std::vector<WorkerStats> get_worker_stats() const;
+
+  static FarmResult run_job(const FarmJob &);
+
+ private:
+  /// \struct Worker
+  /// \brief Queue and counters of one worker thread
+  struct Worker {
+    /// \var mutex
+    /// \brief Guards the queue, against thieves
+    std::mutex mutex;
+
+    /// \var queue
+    /// \brief Jobs not yet taken, with their numbers
+    std::deque<std::pair<size_t, FarmJob>> queue;
+
+    /// \var jobs
+    /// \brief See WorkerStats
+    std::atomic<uint64_t> jobs;
+
+    /// \var stolen
+    /// \brief See WorkerStats
+    std::atomic<uint64_t> stolen;
+
+    /// \var cycles
+    /// \brief See WorkerStats
+    std::atomic<uint64_t> cycles;
+
+    /// \var busy_nanoseconds
+    /// \brief See WorkerStats
+    std::atomic<uint64_t> busy_nanoseconds;
+  };
+
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::vector<std::thread> threads;
+
+  // Guards everything below, except n_queued which is also decremented by
+  // workers taking a job
+  std::mutex mutex;
+  std::condition_variable job_queued;
+  std::condition_variable jobs_finished;
+  std::atomic<size_t> n_queued;
+  size_t n_unfinished;
+  size_t first_job;
+  size_t next_worker;
+  std::vector<FarmResult> results;
+  bool stopping;
+
+  void work(size_t);
+  bool take_job(size_t, std::pair<size_t, FarmJob> *);
+};
+
+}  // namespace Emulator
+
+#endif  // CHIP_8_INCLUDE_MACHINEFARM_HPP_
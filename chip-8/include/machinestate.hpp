@@ -0,0 +1,79 @@
+/// \file machinestate.hpp
+/// \brief Complete architectural state of a CHIP-8 machine
+
+#ifndef CHIP_8_INCLUDE_MACHINESTATE_HPP_
+#define CHIP_8_INCLUDE_MACHINESTATE_HPP_
+
+#include <array>
+#include <cstdint>
+#include <type_traits>
+
+#include "chip8constants.hpp"
+#include "chip8types.hpp"
+
+namespace Emulator {
+
+/// \struct MachineState
+/// \brief Everything an instruction may read or write, as plain data
+///
+/// The state is trivially copyable, so that a snapshot is a single copy of a
+/// few kilobytes.  Fields used by nearly every instruction come first, to
+/// share cache lines.
+struct MachineState {
+  /// \var v
+  /// \brief General-purpose registers V0-VF
+  std::array<REG_TYPE, NUM_V_REGS> v;
+
+  /// \var i
+  /// \brief Address register
+  REG_TYPE i;
+
+  /// \var pc
+  /// \brief Address of the next instruction
+  uint16_t pc;
+
+  /// \var sp
+  /// \brief Number of return addresses on the stack
+  uint8_t sp;
+
+  /// \var delay_timer
+  /// \brief Delay timer, decremented at 60 Hz
+  uint8_t delay_timer;
+
+  /// \var sound_timer
+  /// \brief Sound timer, decremented at 60 Hz
+  uint8_t sound_timer;
+
+  /// \var rng
+  /// \brief State of the xorshift generator used by CXNN, never zero
+  uint32_t rng;
+
+  /// \var frame_cycles
+  /// \brief Machine cycles elapsed in the current frame, for timing models
+  ///        counting cycles
+  uint32_t frame_cycles;
+
+  /// \var stack
+  /// \brief Return addresses of the active subroutine calls
+  std::array<uint16_t, STACK_DEPTH> stack;
+
+  /// \var screen
+  /// \brief One word per row, the leftmost pixel in the most significant bit
+  std::array<uint64_t, MAX_HEIGHT> screen;
+
+  /// \var ram
+  /// \brief System RAM, including the interpreter area below the ROM
+  std::array<MEM_TYPE, RAM_SIZE> ram;
+};
+
+uint64_t hash_state(const MachineState &);
+
+static_assert(std::is_trivially_copyable<MachineState>::value,
+              "Snapshots copy the machine state as raw bytes");
+static_assert(MAX_WIDTH == 64, "Screen rows are stored as 64-bit words");
+static_assert((RAM_SIZE & (RAM_SIZE - 1)) == 0,
+              "Addresses wrap around RAM with a mask");
+
+}  // namespace Emulator
+
+#endif  // CHIP_8_INCLUDE_MACHINESTATE_HPP_
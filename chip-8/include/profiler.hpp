@@ -0,0 +1,106 @@
+/// \file profiler.hpp
+/// \brief Execution counts and host time per instruction and guest address
+
+#ifndef CHIP_8_INCLUDE_PROFILER_HPP_
+#define CHIP_8_INCLUDE_PROFILER_HPP_
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "chip8constants.hpp"
+#include "chip8types.hpp"
+
+namespace Emulator {
+
+/// \class Profiler
+/// \brief Execution counts and host time per instruction and guest address
+///
+/// Instructions are grouped into classes, one per handler of the machine
+/// (e.g. "8XY4").  Loops are recognized by jumps (1NNN/BNNN) to a lower
+/// address, and span from the jump target to the jump itself.
+///
+/// Chip8Machine only feeds the profiler in builds configured with
+/// CHIP8_ENABLE_PROFILER;  otherwise the hooks are compiled out entirely.
+class Profiler {
+ public:
+  /// \struct ClassStats
+  /// \brief Totals for one instruction class
+  struct ClassStats {
+    /// \var name
+    /// \brief Name of the class, e.g. "8XY4"
+    std::string name;
+
+    /// \var executions
+    /// \brief Number of instructions of the class executed
+    uint64_t executions;
+
+    /// \var nanoseconds
+    /// \brief Host time spent executing them
+    uint64_t nanoseconds;
+  };
+
+  /// \struct AddressStats
+  /// \brief Totals for one guest address
+  struct AddressStats {
+    /// \var address
+    /// \brief Address of the instruction
+    ADDR_TYPE address;
+
+    /// \var executions
+    /// \brief Number of times the instruction was executed
+    uint64_t executions;
+  };
+
+  /// \struct LoopStats
+  /// \brief Totals for one backward jump and the code it repeats
+  struct LoopStats {
+    /// \var start
+    /// \brief Target of the jump, first address of the loop
+    ADDR_TYPE start;
+
+    /// \var end
+    /// \brief Address of the jump, last instruction of the loop
+    ADDR_TYPE end;
+
+    /// \var iterations
+    /// \brief Number of times the jump was taken
+    uint64_t iterations;
+
+    /// \var executions
+    /// \brief Number of instructions executed between start and end
+    uint64_t executions;
+  };
+
+  explicit Profiler(const std::vector<std::string> &);
+
+  static bool is_enabled();
+
+  void record(uint8_t, ADDR_TYPE, uint64_t);
+  void clear();
+
+  uint64_t get_total_executions() const;
+  std::vector<ClassStats> get_classes() const;
+  std::vector<AddressStats> get_hottest_addresses(size_t) const;
+  std::vector<LoopStats> get_hottest_loops(size_t) const;
+
+  void write_report(std::ostream &, size_t = 10) const;
+  void write_json(std::ostream &) const;
+
+ private:
+  std::vector<std::string> class_names;
+  std::vector<bool> is_jump;
+  std::vector<uint64_t> class_executions;
+  std::vector<uint64_t> class_nanoseconds;
+  std::array<uint64_t, RAM_SIZE> address_executions;
+  std::unordered_map<uint32_t, uint64_t> backward_jumps;
+  ADDR_TYPE previous_address;
+  bool previous_is_jump;
+};
+
+}  // namespace Emulator
+
+#endif  // CHIP_8_INCLUDE_PROFILER_HPP_
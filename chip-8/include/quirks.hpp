@@ -0,0 +1,79 @@
+/// \file quirks.hpp
+/// \brief Compile-time policies for instructions whose behavior differs
+///        between CHIP-8 interpreters
+
+#ifndef CHIP_8_INCLUDE_QUIRKS_HPP_
+#define CHIP_8_INCLUDE_QUIRKS_HPP_
+
+#include <vector>
+
+#include "chip8types.hpp"
+
+namespace Emulator {
+
+// Each policy is a set of compile-time constants;  handlers are instantiated
+// once per policy, so the branches on these constants are folded away and
+// no quirk is ever tested while a ROM runs.
+//
+//   SHIFT_USES_VY          8XY6/8XYE shift VY into VX, instead of VX in place
+//   LOAD_STORE_INCREMENTS_I FX55/FX65 leave I pointing past the last register
+//   WRAP_SPRITES           DXYN wraps sprites around the screen edges,
+//                          instead of clipping them
+//   LOGIC_RESETS_VF        8XY1/8XY2/8XY3 set VF to zero
+//   JUMP_USES_VX           BNNN jumps to NNN + VX (X being the high nibble of
+//                          NNN), instead of NNN + V0
+
+/// \struct DefaultQuirks
+/// \brief Behavior of this emulator before quirks were configurable
+struct DefaultQuirks {
+  static constexpr bool SHIFT_USES_VY = false;
+  static constexpr bool LOAD_STORE_INCREMENTS_I = false;
+  static constexpr bool WRAP_SPRITES = false;
+  static constexpr bool LOGIC_RESETS_VF = false;
+  static constexpr bool JUMP_USES_VX = false;
+};
+
+/// \struct CosmacVipQuirks
+/// \brief Original interpreter for the COSMAC VIP
+struct CosmacVipQuirks {
+  static constexpr bool SHIFT_USES_VY = true;
+  static constexpr bool LOAD_STORE_INCREMENTS_I = true;
+  static constexpr bool WRAP_SPRITES = false;
+  static constexpr bool LOGIC_RESETS_VF = true;
+  static constexpr bool JUMP_USES_VX = false;
+};
+
+/// \struct SuperChipQuirks
+/// \brief SUPER-CHIP 1.1 for HP48 calculators
+struct SuperChipQuirks {
+  static constexpr bool SHIFT_USES_VY = false;
+  static constexpr bool LOAD_STORE_INCREMENTS_I = false;
+  static constexpr bool WRAP_SPRITES = false;
+  static constexpr bool LOGIC_RESETS_VF = false;
+  static constexpr bool JUMP_USES_VX = true;
+};
+
+/// \struct XoChipQuirks
+/// \brief XO-CHIP, as implemented by Octo
+struct XoChipQuirks {
+  static constexpr bool SHIFT_USES_VY = true;
+  static constexpr bool LOAD_STORE_INCREMENTS_I = true;
+  static constexpr bool WRAP_SPRITES = true;
+  static constexpr bool LOGIC_RESETS_VF = false;
+  static constexpr bool JUMP_USES_VX = false;
+};
+
+/// \enum QuirksProfile
+/// \brief Runtime selector for one of the quirk policies
+enum class QuirksProfile {
+  DEFAULT,
+  COSMAC_VIP,
+  SUPER_CHIP,
+  XO_CHIP
+};
+
+QuirksProfile detect_quirks_profile(const std::vector<MEM_TYPE> &);
+
+}  // namespace Emulator
+
+#endif  // CHIP_8_INCLUDE_QUIRKS_HPP_
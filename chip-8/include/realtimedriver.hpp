@@ -0,0 +1,44 @@
+/// \file realtimedriver.hpp
+/// \brief Paces the timers of a machine with the wall clock
+
+#ifndef CHIP_8_INCLUDE_REALTIMEDRIVER_HPP_
+#define CHIP_8_INCLUDE_REALTIMEDRIVER_HPP_
+
+#include <chrono>  // NOLINT
+#include <cstdint>
+
+#include "chip8machine.hpp"
+
+namespace Emulator {
+
+/// \class RealTimeDriver
+/// \brief Ticks the timers of a machine at 60 Hz of wall-clock time
+///
+/// The driver owns no thread:  the thread running the machine calls sync()
+/// between instructions, which calls Chip8Machine::tick_60hz() once for every
+/// sixtieth of a second elapsed since start().  Ticks are counted from
+/// start() rather than from the previous sync(), so late calls do not make
+/// the timers drift.
+class RealTimeDriver {
+ public:
+  /// \brief Clock used to measure elapsed time
+  using Clock = std::chrono::steady_clock;
+
+  explicit RealTimeDriver(Chip8Machine &);
+
+  void start();
+  void start(Clock::time_point);
+  int sync();
+  int sync(Clock::time_point);
+
+  uint64_t get_ticks() const;
+
+ private:
+  Chip8Machine *machine;
+  Clock::time_point origin;
+  uint64_t ticks;
+};
+
+}  // namespace Emulator
+
+#endif  // CHIP_8_INCLUDE_REALTIMEDRIVER_HPP_
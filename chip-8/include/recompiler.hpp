@@ -0,0 +1,56 @@
+/// \file recompiler.hpp
+/// \brief Translation of CHIP-8 basic blocks into native x86-64 code
+
+#ifndef CHIP_8_INCLUDE_RECOMPILER_HPP_
+#define CHIP_8_INCLUDE_RECOMPILER_HPP_
+
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+#include "chip8types.hpp"
+
+namespace Emulator {
+
+/// \class Recompiler
+/// \brief Translation of CHIP-8 basic blocks into native x86-64 code
+///
+/// Only instructions that touch nothing but the V and I registers (and the
+/// jumps/skips ending a block) are translated;  a block is compiled up to its
+/// first untranslatable instruction, and the caller interprets the rest.
+/// Compiled code never embeds the address of the machine state, so it stays
+/// valid when the owning machine is moved.  Quirks affecting translated
+/// instructions are fixed at construction.
+class Recompiler {
+ public:
+  /// \var NativeBlock
+  /// \brief Compiled code, returning the address of the next instruction
+  typedef uint32_t (*NativeBlock)(REG_TYPE *v_registers, REG_TYPE *i_register);
+
+  explicit Recompiler(bool = false);
+  ~Recompiler();
+  Recompiler(const Recompiler &) = delete;
+  Recompiler &operator=(const Recompiler &) = delete;
+
+  static bool is_supported();
+
+  NativeBlock compile(const std::vector<OPCODE_TYPE> &, ADDR_TYPE, int *);
+  bool is_exhausted() const;
+  void flush();
+
+ private:
+  void emit(std::initializer_list<uint8_t>);
+  void emit_imm32(uint32_t);
+  bool emit_instruction(OPCODE_TYPE, ADDR_TYPE);
+
+  uint8_t *code;
+  size_t code_size;
+  size_t code_used;
+  bool exhausted;
+  bool logic_resets_vf;
+  std::vector<uint8_t> buffer;
+};
+
+}  // namespace Emulator
+
+#endif  // CHIP_8_INCLUDE_RECOMPILER_HPP_
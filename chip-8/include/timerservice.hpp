@@ -0,0 +1,102 @@
+/// \file timerservice.hpp
+/// \brief One thread ticking the timers of many machines at 60 Hz
+
+#ifndef CHIP_8_INCLUDE_TIMERSERVICE_HPP_
+#define CHIP_8_INCLUDE_TIMERSERVICE_HPP_
+
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <condition_variable>  // NOLINT
+#include <cstdint>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "chip8machine.hpp"
+
+namespace Emulator {
+
+class TimerService;
+
+/// \class TimerSubscription
+/// \brief Ticks owed by a TimerService to one machine
+///
+/// The service only increments an atomic counter of pending ticks;  the
+/// thread running the machine hands them to Chip8Machine::tick_60hz() with
+/// apply(), so that machine state is never touched by two threads.
+/// Subscriptions unsubscribe when destroyed, and must not outlive their
+/// service.
+class TimerSubscription {
+ public:
+  ~TimerSubscription();
+
+  int apply();
+  uint32_t get_pending() const;
+
+ private:
+  friend class TimerService;
+  TimerSubscription(TimerService *, Chip8Machine *);
+
+  TimerService *service;
+  Chip8Machine *machine;
+  std::atomic<uint32_t> pending;
+};
+
+/// \class TimerService
+/// \brief Single thread ticking every subscribed machine on a fixed schedule
+///
+/// Deadlines are computed from the time the first machine subscribed, not
+/// from the previous wake-up, so that scheduling delays do not accumulate.
+/// When the thread wakes up after more than one deadline has passed, the
+/// ticks due are delivered at once and counted as missed;  after a stall of
+/// more than a second, the excess ticks are dropped.  The thread sleeps
+/// while no machine is subscribed.
+///
+/// A service may also be created without a thread, in which case ticks are
+/// only delivered by sync(), at times chosen by the caller.
+class TimerService {
+ public:
+  /// \brief Clock used to schedule ticks
+  using Clock = std::chrono::steady_clock;
+
+  explicit TimerService(int = 60, bool = true);
+  ~TimerService();
+
+  static TimerService &get_instance();
+
+  std::unique_ptr<TimerSubscription> subscribe(Chip8Machine &);
+  size_t get_n_subscribers() const;
+  int get_ticks_per_second() const;
+  uint64_t get_ticks() const;
+  uint64_t get_missed_ticks() const;
+
+  void start(Clock::time_point);
+  uint32_t sync(Clock::time_point);
+
+ private:
+  friend class TimerSubscription;
+
+  const int ticks_per_second;
+
+  // Guards everything below, except the counters
+  mutable std::mutex mutex;
+  std::condition_variable changed;
+  std::vector<TimerSubscription *> subscribers;
+  bool stopping;
+  Clock::time_point origin;
+  uint64_t n_scheduled;
+
+  std::atomic<uint64_t> ticks;
+  std::atomic<uint64_t> missed_ticks;
+  std::thread thread;
+
+  void unsubscribe(TimerSubscription *);
+  void run();
+  uint32_t deliver_due_ticks(Clock::time_point);
+  Clock::duration get_deadline(uint64_t) const;
+};
+
+}  // namespace Emulator
+
+#endif  // CHIP_8_INCLUDE_TIMERSERVICE_HPP_
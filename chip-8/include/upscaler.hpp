@@ -4,17 +4,49 @@
 #ifndef CHIP_8_INCLUDE_UPSCALER_HPP_
 #define CHIP_8_INCLUDE_UPSCALER_HPP_
 
+#include <cstdint>
+#include <vector>
+
+#include "chip8constants.hpp"
 #include "chip8machine.hpp"
 
 namespace Emulator {
 
+/// \enum PixelFormat
+/// \brief Layout of the pixels of an upscaled frame
+enum class PixelFormat {
+  /// 16 bits per pixel:  5 bits of red, 6 of green, 5 of blue
+  RGB565,
+  /// 32 bits per pixel:  8 unused bits, then 8 bits each of red, green, blue
+  XRGB8888
+};
+
+/// \struct Palette
+/// \brief Colors of the pixels which are "off" and "on", as 0xRRGGBB
+struct Palette {
+  uint32_t off_color;
+  uint32_t on_color;
+};
+
+/// \var DEFAULT_PALETTE
+/// \brief White pixels on a black background
+const Palette DEFAULT_PALETTE = {0x000000, 0xFFFFFF};
+
 /// \class Upscaler
 /// \brief Upscaler to convert machine display to user-specified resolution
+///
+/// Every configuration precomputes the upscaled span of each of the 256
+/// possible groups of 8 pixels.  A row of the display is upscaled by copying
+/// the span of each of its bytes into one line, then the line is copied
+/// y_scale times.
 class Upscaler {
  public:
-  Upscaler();
+  explicit Upscaler(int = 8, int = 8, PixelFormat = PixelFormat::RGB565,
+                    Palette = DEFAULT_PALETTE);
 
-  void upscale(unsigned short *, int, const Chip8Machine &) const;
+  void upscale(void *, int, const Chip8Machine &, uint64_t = ALL_ROWS) const;
+  int get_bytes_per_pixel() const;
+  static uint32_t convert_color(uint32_t, PixelFormat);
 
   /// \var x_scale
   /// \brief Scaling factor for width of display
@@ -24,8 +56,24 @@ class Upscaler {
   /// \brief Scaling factor for height of display
   const int y_scale;
 
+  /// \var format
+  /// \brief Layout of the pixels of the upscaled frame
+  const PixelFormat format;
+
+  /// \var palette
+  /// \brief Colors of the pixels, before conversion to format
+  const Palette palette;
+
  private:
-  const int pixel_color;
+  /// \var span_bytes
+  /// \brief Size of the upscaled span of 8 pixels
+  const int span_bytes;
+
+  /// \var spans
+  /// \brief Upscaled span of every group of 8 pixels, indexed by the group
+  ///        packed in a byte, the leftmost pixel being the most significant
+  ///        bit
+  std::vector<unsigned char> spans;
 };
 
 }  // namespace Emulator
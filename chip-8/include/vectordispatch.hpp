@@ -0,0 +1,50 @@
+/// \file vectordispatch.hpp
+/// \brief Compiler support for vector kernels, and run-time choice between
+///        their baseline and AVX2 builds
+
+#ifndef CHIP_8_INCLUDE_VECTORDISPATCH_HPP_
+#define CHIP_8_INCLUDE_VECTORDISPATCH_HPP_
+
+#if defined(__GNUC__)
+// Vector extensions (GCC, also supported by Clang):  arithmetic on a 32-byte
+// vector compiles to one AVX2 instruction or two SSE2 instructions on
+// x86-64, and to NEON on ARM
+#define CHIP8_VECTORS
+#define CHIP8_VECTOR_INLINE inline __attribute__((always_inline))
+#if defined(__x86_64__) || defined(__i386__)
+// Kernels are also compiled for AVX2, and picked at run time
+#define CHIP8_VECTOR_AVX2
+#endif
+#else
+#define CHIP8_VECTOR_INLINE inline
+#endif
+
+namespace Emulator {
+
+#ifdef CHIP8_VECTOR_AVX2
+/// \brief Return whether the host supports AVX2
+/// \return Whether kernels compiled for AVX2 may run
+inline bool has_avx2() {
+  static const bool supported = __builtin_cpu_supports("avx2");
+  return supported;
+}
+#endif
+
+/// \brief Name the vector instructions used by vector kernels
+/// \return "AVX2", "SSE2", "NEON", or "none" if kernels are scalar
+inline const char *get_vector_extension() {
+#ifdef CHIP8_VECTOR_AVX2
+  if (has_avx2()) return "AVX2";
+#endif
+#if defined(CHIP8_VECTORS) && defined(__SSE2__)
+  return "SSE2";
+#elif defined(CHIP8_VECTORS) && defined(__ARM_NEON)
+  return "NEON";
+#else
+  return "none";
+#endif
+}
+
+}  // namespace Emulator
+
+#endif  // CHIP_8_INCLUDE_VECTORDISPATCH_HPP_
@@ -0,0 +1,132 @@
+#include <chrono>  // NOLINT [build/c++11]
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "chip8machine.hpp"
+#include "machinebatch.hpp"
+#include "memory.hpp"
+
+const long DEFAULT_N_MACHINES = 4096;
+const long DEFAULT_N_STEPS = 10000;
+
+// Register arithmetic on a random byte, in the style of an agent scoring its
+// state, with a rare random branch making a few machines diverge before the
+// jump back to the start of the ROM brings them back in step
+const std::vector<Emulator::MEM_TYPE> BUILTIN_ROM = {
+    0xC0, 0xFF,  // 0x200: V0 = random
+    0x61, 0x0A,  // 0x202: V1 = 0x0A
+    0x82, 0x00,  // 0x204: V2 = V0
+    0x82, 0x14,  // 0x206: V2 += V1, VF = carry
+    0x83, 0x25,  // 0x208: V3 -= V2, VF = !borrow
+    0x84, 0x46,  // 0x20A: V4 >>= 1, VF = bit shifted out
+    0x85, 0x43,  // 0x20C: V5 ^= V4
+    0x86, 0x52,  // 0x20E: V6 &= V5
+    0x87, 0x61,  // 0x210: V7 |= V6
+    0x77, 0x01,  // 0x212: V7 += 0x01
+    0x88, 0x8E,  // 0x214: V8 <<= 1, VF = bit shifted out
+    0x89, 0x87,  // 0x216: V9 = V8 - V9, VF = !borrow
+    0x30, 0x00,  // 0x218: skip if V0 == 0x00
+    0x12, 0x1E,  // 0x21A: jump to 0x21E
+    0x7A, 0x01,  // 0x21C: VA += 0x01 (1 machine in 256)
+    0xAB, 0xCD,  // 0x21E: I = 0xBCD
+    0x12, 0x00   // 0x220: jump to 0x200
+};
+
+std::vector<Emulator::MEM_TYPE> load_rom(const std::string &filename) {
+  if (filename.empty()) return BUILTIN_ROM;
+
+  void *data;
+  size_t size;
+  std::tie(data, size) = Emulator::Memory::get_bytestream_from_file(filename);
+  std::vector<Emulator::MEM_TYPE> rom =
+      Emulator::Memory::convert_bytestream_to_vector(data, size);
+  delete[] static_cast<char *>(data);
+  return rom;
+}
+
+void report(const std::string &engine, long n_machines, uint64_t n_executed,
+            double seconds) {
+  std::cout << "Engine:                " << engine << std::endl;
+  std::cout << "Machines:              " << n_machines << std::endl;
+  std::cout << "Instructions executed: " << n_executed << std::endl;
+  std::cout << "Elapsed time (s):      " << seconds << std::endl;
+  std::cout << "Instances/sec:         " << n_machines / seconds << std::endl;
+  std::cout << "Steps/sec:             " << n_executed / seconds << std::endl;
+}
+
+// Every machine is seeded differently, as in a fuzzing or training run
+Emulator::Chip8Machine create_prototype(
+    const std::vector<Emulator::MEM_TYPE> &rom) {
+  Emulator::Chip8Machine machine(Emulator::detect_quirks_profile(rom));
+  machine.reset();
+  machine.load_rom(rom);
+  return machine;
+}
+
+void run_batch(const std::vector<Emulator::MEM_TYPE> &rom, long n_machines,
+               long n_steps) {
+  Emulator::MachineBatch batch(create_prototype(rom), n_machines);
+  for (long machine = 0; machine < n_machines; machine++) {
+    batch.set_seed(machine, machine);
+  }
+
+  // Batches are fed in chunks of a frame, as a training loop would
+  const int chunk = 10;
+  uint64_t n_executed = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (long step = 0; step < n_steps; step += chunk) {
+    n_executed += batch.run(chunk);
+    batch.tick_60hz();
+  }
+  auto stop = std::chrono::steady_clock::now();
+
+  report(std::string("lockstep batch (")
+             + Emulator::MachineBatch::get_vector_extension() + ")",
+         n_machines, n_executed,
+         std::chrono::duration<double>(stop - start).count());
+  uint64_t n_vector = batch.get_vector_steps();
+  uint64_t n_total = n_vector + batch.get_scalar_steps();
+  std::cout << "Vectorized steps (%):  "
+            << (n_total == 0 ? 0.0 : 100.0 * n_vector / n_total) << std::endl;
+}
+
+void run_machines(const std::vector<Emulator::MEM_TYPE> &rom,
+                  long n_machines, long n_steps) {
+  Emulator::Chip8Machine prototype = create_prototype(rom);
+  uint64_t n_executed = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (long index = 0; index < n_machines; index++) {
+    Emulator::Chip8Machine machine(prototype.get_quirks_profile());
+    machine.set_state(prototype.get_state());
+    machine.set_seed(index);
+    for (long step = 0; step < n_steps; step++) {
+      machine.advance();
+    }
+    n_executed += n_steps;
+  }
+  auto stop = std::chrono::steady_clock::now();
+
+  report("one Chip8Machine at a time", n_machines, n_executed,
+         std::chrono::duration<double>(stop - start).count());
+}
+
+int main(int argc, char **argv) {
+  std::string filename;
+  long n_machines = DEFAULT_N_MACHINES;
+  long n_steps = DEFAULT_N_STEPS;
+  if (argc > 1) filename = argv[1];
+  if (argc > 2) n_machines = std::stol(argv[2]);
+  if (argc > 3) n_steps = std::stol(argv[3]);
+  if (filename == "-") filename.clear();
+
+  std::vector<Emulator::MEM_TYPE> rom = load_rom(filename);
+  try {
+    run_batch(rom, n_machines, n_steps);
+    std::cout << std::endl;
+    run_machines(rom, n_machines, n_steps);
+  }
+  catch (const Emulator::OpcodeNotSupported &err) {
+    std::cout << "Stopped early: " << err.what() << std::endl;
+  }
+}
@@ -0,0 +1,322 @@
+#include "chip8machine.hpp"
+
+namespace Emulator {
+
+namespace {
+// Bounds the work lost when a long block is invalidated
+const int MAX_BLOCK_LENGTH = 64;
+
+// Blocks entered fewer times than this are not worth compiling
+const int RECOMPILE_THRESHOLD = 8;
+}  // namespace
+
+/// \brief Execute a fixed number of instructions
+///
+/// Straight-line runs of code are decoded once into basic blocks, which are
+/// then executed as a whole on subsequent visits.  Observable behavior is
+/// identical to calling advance() the same number of times, except that the
+/// batch ends early, without throwing, when the program cannot go on.
+/// Nothing is executed while a fault is pending (see clear_fault()).
+///
+/// Busy-wait loops, which cannot make progress before the next timer tick or
+/// key press, are skipped over instead of being executed (see
+/// get_elided_cycles()).  This includes the cycles left after a jump to self,
+/// after running off the end of RAM, or during an FX0A waiting for a key.
+///
+/// \param n_cycles Number of instructions to execute
+/// \return Why execution stopped
+RunStatus Chip8Machine::run_cycles(int n_cycles) {
+  while (n_cycles > 0) {
+    if (fault.code != Fault::NONE) return RunStatus::FAULTED;
+    BasicBlock &block = find_block(state.pc);
+    int n_instructions = static_cast<int>(block.instructions.size());
+    if (n_instructions == 0) {
+      elided_cycles += n_cycles;
+      return RunStatus::HALTED;
+    }
+    if (block.idle_loop != IdleLoop::NONE) {
+      n_cycles -= skip_idle_loop(block, n_cycles);
+    }
+
+    // Blocks may be invalidated by their own last instruction (see
+    // ends_block()), so nothing may touch the block once that instruction
+    // has started executing
+    const DecodedInstruction &last = block.instructions.back();
+    bool unsupported = last.handler == &Chip8Machine::op_unsupported;
+    bool jumps_to_self = last.handler == &Chip8Machine::op_1NNN
+        && last.nnn == block.end - INSTRUCTION_LENGTH;
+    OPCODE_TYPE last_opcode = last.opcode;
+    if (unsupported) n_instructions -= 1;
+
+    int first = 0;
+    bool use_native = static_cast<bool>(recompiler);
+#ifdef CHIP8_ENABLE_PROFILER
+    // Compiled code cannot be timed instruction by instruction
+    use_native = use_native && !profiler;
+#endif
+    if (use_native) {
+      if (block.native == nullptr
+          && ++block.executions == RECOMPILE_THRESHOLD) {
+        compile_block(block);
+      }
+      if (block.native != nullptr && block.n_native <= n_cycles) {
+        state.pc = block.native(state.v.data(), &state.i);
+        first = block.n_native;
+        n_cycles -= first;
+        if (first == n_instructions && jumps_to_self) {
+          elided_cycles += n_cycles;
+          return RunStatus::HALTED;
+        }
+        if (first == n_instructions) continue;
+      }
+    }
+
+    const DecodedInstruction *instructions = block.instructions.data();
+    int n_to_execute = n_instructions - first;
+    // Reaching an unsupported opcode takes a cycle, as executing it would
+    bool finishes_block = n_to_execute + (unsupported ? 1 : 0) <= n_cycles;
+    if (n_to_execute > n_cycles) n_to_execute = n_cycles;
+    for (int i = first; i < first + n_to_execute; i++) {
+      state.pc += INSTRUCTION_LENGTH;
+#ifdef CHIP8_ENABLE_PROFILER
+      if (profiler) {
+        execute_profiled(instructions[i], state.pc - INSTRUCTION_LENGTH);
+        continue;
+      }
+#endif
+      (this->*instructions[i].handler)(instructions[i]);
+    }
+    n_cycles -= n_to_execute;
+
+    if (!finishes_block) break;
+    if (unsupported) {
+      raise_fault(Fault::UNSUPPORTED_OPCODE, state.pc, last_opcode);
+      return RunStatus::UNSUPPORTED_OPCODE;
+    }
+    if (fault.code != Fault::NONE) return RunStatus::FAULTED;
+    if (jumps_to_self) {
+      elided_cycles += n_cycles;
+      return RunStatus::HALTED;
+    }
+    if (waiting_for_key) {
+      elided_cycles += n_cycles;
+      return RunStatus::WAITING_FOR_KEY;
+    }
+  }
+  return RunStatus::OK;
+}
+
+/// \brief Return the number of cycles skipped over instead of executed
+///
+/// Counts cycles spent in busy-wait loops, after jumps to self or running
+/// off the end of RAM, and while waiting for a key, since the machine was
+/// created
+///
+/// \return Number of cycles run_cycles() did not have to execute
+uint64_t Chip8Machine::get_elided_cycles() const {
+  return elided_cycles;
+}
+
+/// \brief Skip the iterations of a busy-wait loop which cannot exit
+///
+/// Such loops read the delay timer or the keypad until it changes, which
+/// cannot happen during a batch of instructions:  all iterations but the
+/// first leave the machine unchanged.  Only whole iterations are skipped,
+/// so that the instructions left over reach the same state as executing
+/// every iteration would.
+///
+/// \param block First block of the loop, at the current program counter
+/// \param n_cycles Number of instructions left in the batch
+/// \return Number of instructions skipped
+int Chip8Machine::skip_idle_loop(const BasicBlock &block, const int n_cycles) {
+  // The jump back follows the block, so it may have changed since decoding
+  ADDR_TYPE jump = block.end;
+  if (jump + 1 >= memory_size) return 0;
+  OPCODE_TYPE jump_opcode = (state.ram[jump] << 8) + state.ram[jump + 1];
+  if (jump_opcode != (0x1000 | block.start)) return 0;
+
+  const DecodedInstruction &test = block.instructions.back();
+  bool exits;
+  if (block.idle_loop == IdleLoop::DELAY_TIMER) {
+    bool equal = state.delay_timer == test.nn;
+    exits = equal == ((test.opcode >> 12) == 0x3);
+  } else {
+    bool pressed = keys.test(state.v[test.x] & 0xF);
+    exits = pressed == (test.nn == 0x9E);
+  }
+  if (exits) return 0;
+
+  int loop_length = static_cast<int>(block.instructions.size()) + 1;
+  int n_skipped = (n_cycles / loop_length) * loop_length;
+  if (n_skipped == 0) return 0;
+  if (block.idle_loop == IdleLoop::DELAY_TIMER) {
+    state.v[test.x] = state.delay_timer;
+  }
+  elided_cycles += n_skipped;
+  return n_skipped;
+}
+
+/// \brief Recognize the first block of a busy-wait loop
+///
+/// Only the block itself is inspected, the jump back is checked by
+/// skip_idle_loop() every time
+///
+/// \param block Block to classify
+/// \return Kind of loop the block may start
+Chip8Machine::IdleLoop Chip8Machine::classify_idle_loop(
+    const BasicBlock &block) {
+  const std::vector<DecodedInstruction> &instructions = block.instructions;
+  if (instructions.size() == 1
+      && (instructions[0].handler == &Chip8Machine::op_EX9E
+          || instructions[0].handler == &Chip8Machine::op_EXA1)) {
+    return IdleLoop::KEY;
+  }
+  if (instructions.size() == 2
+      && instructions[0].handler == &Chip8Machine::op_FX07
+      && (instructions[1].handler == &Chip8Machine::op_3XNN
+          || instructions[1].handler == &Chip8Machine::op_4XNN)
+      && instructions[0].x == instructions[1].x) {
+    return IdleLoop::DELAY_TIMER;
+  }
+  return IdleLoop::NONE;
+}
+
+/// \brief Execute one video frame worth of instructions
+///
+/// Timers are ticked once at the end of the frame, in emulated time, even if
+/// the frame was cut short.  With the COSMAC_VIP timing model, the frame
+/// lasts a fixed number of machine cycles instead (see run_vip_frame()), and
+/// instructions_per_frame is ignored.
+///
+/// \param instructions_per_frame Number of instructions to execute
+/// \return Why execution stopped
+RunStatus Chip8Machine::run_frame(const int instructions_per_frame) {
+  if (timing_model == TimingModel::COSMAC_VIP) return run_vip_frame();
+  RunStatus status = run_cycles(instructions_per_frame);
+  tick_60hz();
+  return status;
+}
+
+/// \brief Select whether run_cycles() executes hot blocks as native code
+///
+/// The recompiler is only available on x86-64 builds configured with
+/// CHIP8_ENABLE_RECOMPILER;  elsewhere, the interpreter is always used.
+///
+/// \param enabled Whether to use the recompiler
+/// \return Whether the recompiler is now in use
+bool Chip8Machine::set_recompiler(const bool enabled) {
+  discard_native_code();
+  recompiler.reset();
+  if (enabled && Recompiler::is_supported()) {
+    recompiler.reset(new Recompiler(handlers->logic_resets_vf));
+  }
+  return static_cast<bool>(recompiler);
+}
+
+/// \brief Compile a basic block into native code, if possible
+/// \param block Block to compile
+void Chip8Machine::compile_block(BasicBlock &block) {
+  std::vector<OPCODE_TYPE> opcodes;
+  for (const DecodedInstruction &instruction : block.instructions) {
+    opcodes.push_back(instruction.opcode);
+  }
+  block.native = recompiler->compile(opcodes, block.start, &block.n_native);
+  if (block.native != nullptr || !recompiler->is_exhausted()) return;
+
+  // Out of space for code:  start over, recompiling blocks as they get hot
+  discard_native_code();
+  recompiler->flush();
+  block.native = recompiler->compile(opcodes, block.start, &block.n_native);
+}
+
+/// \brief Forget the compiled code of every basic block
+void Chip8Machine::discard_native_code() {
+  for (auto &entry : block_cache) {
+    entry.second.executions = 0;
+    entry.second.native = nullptr;
+    entry.second.n_native = 0;
+  }
+}
+
+/// \brief Whether an instruction must be the last one in its basic block
+///
+/// Besides control transfers, instructions writing RAM end a block, as they
+/// may overwrite the code that follows them
+///
+/// \param instruction Instruction to classify
+/// \return True if no instruction may follow it in the same block
+bool Chip8Machine::ends_block(const DecodedInstruction &instruction) {
+  OpcodeHandler handler = instruction.handler;
+  if (handler == &Chip8Machine::op_00EE
+      || handler == &Chip8Machine::op_1NNN
+      || handler == &Chip8Machine::op_2NNN
+      || handler == &Chip8Machine::op_3XNN
+      || handler == &Chip8Machine::op_4XNN
+      || handler == &Chip8Machine::op_EX9E
+      || handler == &Chip8Machine::op_EXA1
+      || handler == &Chip8Machine::op_FX0A
+      || handler == &Chip8Machine::op_FX33
+      || handler == &Chip8Machine::op_unsupported) {
+    return true;
+  }
+  // Quirk-dependent handlers have one instantiation per policy, so BNNN and
+  // FX55 are recognized by their opcode instead
+  OPCODE_TYPE opcode = instruction.opcode;
+  return (opcode >> 12) == 0xB || (opcode & 0xF0FF) == 0xF055;
+}
+
+/// \brief Return the basic block starting at an address, decoding it if needed
+/// \param start Address of the first instruction in the block
+/// \return Basic block starting at the address
+Chip8Machine::BasicBlock &Chip8Machine::find_block(const ADDR_TYPE start) {
+  auto cached = block_cache.find(start);
+  if (cached != block_cache.end()) return cached->second;
+
+  BasicBlock block;
+  block.start = start;
+  block.executions = 0;
+  block.native = nullptr;
+  block.n_native = 0;
+  ADDR_TYPE address = start;
+  while (address + 1 < memory_size
+      && block.instructions.size() < MAX_BLOCK_LENGTH) {
+    OPCODE_TYPE opcode = (state.ram[address] << 8) + state.ram[address + 1];
+    block.instructions.push_back(predecode(opcode));
+    address += INSTRUCTION_LENGTH;
+    if (ends_block(block.instructions.back())) break;
+  }
+  block.end = address;
+  block.idle_loop = classify_idle_loop(block);
+
+  for (ADDR_TYPE byte = block.start; byte < block.end; byte++) {
+    block_code.set(byte);
+  }
+  return block_cache.emplace(start, std::move(block)).first->second;
+}
+
+/// \brief Discard basic blocks overlapping an address range
+/// \param first First address written
+/// \param last One past the last address written
+void Chip8Machine::invalidate_blocks(const ADDR_TYPE first,
+                                     const ADDR_TYPE last) {
+  bool overlaps_code = false;
+  for (ADDR_TYPE byte = first; byte < last && byte < memory_size; byte++) {
+    overlaps_code = overlaps_code || block_code.test(byte);
+  }
+  if (!overlaps_code) return;
+
+  block_code.reset();
+  for (auto it = block_cache.begin(); it != block_cache.end();) {
+    const BasicBlock &block = it->second;
+    if (block.start < last && first < block.end) {
+      it = block_cache.erase(it);
+      continue;
+    }
+    for (ADDR_TYPE byte = block.start; byte < block.end; byte++) {
+      block_code.set(byte);
+    }
+    ++it;
+  }
+}
+
+}  // namespace Emulator
@@ -0,0 +1,88 @@
+#include "buzzer.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Emulator {
+
+namespace {
+// Entries of the wavetable, indexed by the top bits of the phase
+const int WAVETABLE_BITS = 8;
+const int WAVETABLE_SIZE = 1 << WAVETABLE_BITS;
+
+const int N_CHANNELS = 2;
+
+const double PI = 3.14159265358979323846;
+
+int16_t get_waveform_sample(const Waveform waveform, const int index,
+                            const int16_t amplitude) {
+  double position = static_cast<double>(index) / WAVETABLE_SIZE;
+  double value;
+  switch (waveform) {
+    case Waveform::TRIANGLE:
+      // Rises from -1 to 1 over the first half, then falls back
+      value = position < 0.5 ? 4.0 * position - 1.0 : 3.0 - 4.0 * position;
+      break;
+    case Waveform::SINE:
+      value = std::sin(2.0 * PI * position);
+      break;
+    default:
+      value = position < 0.5 ? 1.0 : -1.0;
+      break;
+  }
+  return static_cast<int16_t>(std::lround(value * amplitude));
+}
+}  // namespace
+
+/// \brief Create a buzzer and precompute its wavetable
+/// \param sample_rate_ Number of audio frames per second
+/// \param frames_per_second Number of video frames per second, that is of
+///        calls to render_frame() per second
+/// \param frequency_ Frequency of the tone (in Hz)
+/// \param waveform Shape of one period of the tone
+/// \param amplitude Peak value of the samples
+Buzzer::Buzzer(int sample_rate_, int frames_per_second, double frequency_,
+               Waveform waveform, int16_t amplitude)
+    : sample_rate(sample_rate_), frequency(frequency_),
+      wavetable(WAVETABLE_SIZE),
+      samples(N_CHANNELS * ((sample_rate_ + frames_per_second / 2)
+                            / frames_per_second)),
+      phase(0),
+      phase_step(static_cast<uint32_t>(
+          std::llround(frequency_ * 4294967296.0 / sample_rate_))) {
+  for (int index = 0; index < WAVETABLE_SIZE; index++) {
+    wavetable[index] = get_waveform_sample(waveform, index, amplitude);
+  }
+}
+
+/// \brief Render one video frame of audio
+///
+/// While the buzzer plays, the tone continues from where the previous frame
+/// left it;  a silent frame restarts it at the beginning of a period.
+///
+/// \param playing Whether the buzzer sounds during this frame, see
+///        Chip8Machine::is_sound_playing()
+/// \return get_frames_per_video_frame() stereo frames, interleaved, valid
+///         until the next call
+const int16_t *Buzzer::render_frame(const bool playing) {
+  if (!playing) {
+    std::fill(samples.begin(), samples.end(), 0);
+    phase = 0;
+    return samples.data();
+  }
+  for (size_t sample = 0; sample < samples.size(); sample += N_CHANNELS) {
+    int16_t value = wavetable[phase >> (32 - WAVETABLE_BITS)];
+    samples[sample] = value;
+    samples[sample + 1] = value;
+    phase += phase_step;
+  }
+  return samples.data();
+}
+
+/// \brief Return the length of a video frame of audio
+/// \return Number of stereo frames rendered by render_frame()
+size_t Buzzer::get_frames_per_video_frame() const {
+  return samples.size() / N_CHANNELS;
+}
+
+}  // namespace Emulator
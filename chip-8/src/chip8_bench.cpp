@@ -0,0 +1,267 @@
+#include <dirent.h>
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>  // NOLINT [build/c++11]
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "chip8machine.hpp"
+#include "memory.hpp"
+#include "upscaler.hpp"
+
+// One minute of emulated time
+const int DEFAULT_N_FRAMES = 3600;
+
+// Roughly the speed of the original interpreter, at 60 frames per second
+const int INSTRUCTIONS_PER_FRAME = 10;
+
+const char DEFAULT_JSON_PATH[] = "chip8-bench.json";
+
+// Results for one ROM;  phases are in seconds
+struct RomResult {
+  std::string name;
+  std::string status;
+  long n_frames;
+  long n_instructions;
+  double load_seconds;
+  double decode_seconds;
+  double draw_seconds;
+  double upscale_seconds;
+};
+
+using Clock = std::chrono::steady_clock;
+
+double seconds_since(const Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Peak resident set size of the whole process so far
+long get_peak_rss_kb() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+// Regular files of a directory, skipping hidden ones, in name order
+std::vector<std::string> list_roms(const std::string &directory) {
+  std::vector<std::string> names;
+  DIR *handle = opendir(directory.c_str());
+  if (handle == nullptr) return names;
+  while (struct dirent *entry = readdir(handle)) {
+    std::string name(entry->d_name);
+    if (name.empty() || name[0] == '.') continue;
+    if (entry->d_type != DT_REG && entry->d_type != DT_UNKNOWN) continue;
+    names.push_back(name);
+  }
+  closedir(handle);
+  std::sort(names.begin(), names.end());
+  return names;
+}
+
+std::vector<Emulator::MEM_TYPE> load_rom(const std::string &path) {
+  void *data;
+  size_t size;
+  std::tie(data, size) = Emulator::Memory::get_bytestream_from_file(path);
+  std::vector<Emulator::MEM_TYPE> rom =
+      Emulator::Memory::convert_bytestream_to_vector(data, size);
+  delete[] static_cast<char *>(data);
+  return rom;
+}
+
+// Host time spent in the drawing instructions, as seen by the profiler
+double get_draw_seconds(const Emulator::Chip8Machine &machine) {
+  const Emulator::Profiler *profiler = machine.get_profiler();
+  if (profiler == nullptr) return 0.0;
+  uint64_t nanoseconds = 0;
+  for (const Emulator::Profiler::ClassStats &current :
+       profiler->get_classes()) {
+    if (current.name == "DXYN" || current.name == "00E0") {
+      nanoseconds += current.nanoseconds;
+    }
+  }
+  return nanoseconds * 1e-9;
+}
+
+// Runs the ROM as the libretro core would, without input, video or audio
+// output:  emulate a frame, then upscale the rows of the display it changed
+RomResult run_rom(const std::string &directory, const std::string &name,
+                  const int n_frames, const bool recompiler) {
+  RomResult result = {name, "ok", 0, 0, 0.0, 0.0, 0.0, 0.0};
+
+  Clock::time_point start = Clock::now();
+  std::vector<Emulator::MEM_TYPE> rom = load_rom(directory + "/" + name);
+  Emulator::Chip8Machine machine(Emulator::detect_quirks_profile(rom));
+  machine.reset();
+  machine.load_rom(rom);
+  machine.set_recompiler(recompiler);
+  machine.set_profiler(Emulator::Profiler::is_enabled());
+  Emulator::Upscaler upscaler;
+  int width = upscaler.x_scale * machine.display_width;
+  int height = upscaler.y_scale * machine.display_height;
+  std::vector<unsigned short> frame_buffer(width * height);
+  result.load_seconds = seconds_since(start);
+
+  for (int frame = 0; frame < n_frames; frame++) {
+    uint64_t elided_cycles = machine.get_elided_cycles();
+    start = Clock::now();
+    Emulator::RunStatus status = machine.run_frame(INSTRUCTIONS_PER_FRAME);
+    result.decode_seconds += seconds_since(start);
+    if (status == Emulator::RunStatus::UNSUPPORTED_OPCODE
+        || status == Emulator::RunStatus::FAULTED) {
+      result.status = "fault";
+      break;
+    }
+    result.n_frames += 1;
+    // Cycles skipped in busy-wait loops or after a halt were not executed
+    result.n_instructions += INSTRUCTIONS_PER_FRAME
+        - static_cast<long>(machine.get_elided_cycles() - elided_cycles);
+
+    start = Clock::now();
+    upscaler.upscale(frame_buffer.data(), width, machine,
+                     machine.get_dirty_rows());
+    machine.clear_dirty_rows();
+    result.upscale_seconds += seconds_since(start);
+    if (status == Emulator::RunStatus::HALTED) {
+      result.status = "halt";
+      break;
+    }
+  }
+
+  result.draw_seconds = get_draw_seconds(machine);
+  result.decode_seconds -= result.draw_seconds;
+  return result;
+}
+
+double get_total_seconds(const RomResult &result) {
+  return result.load_seconds + result.decode_seconds + result.draw_seconds
+      + result.upscale_seconds;
+}
+
+double per_second(const long count, const double seconds) {
+  return seconds > 0.0 ? count / seconds : 0.0;
+}
+
+void write_table(std::ostream &stream, const std::vector<RomResult> &results) {
+  stream << std::left << std::setw(28) << "ROM" << std::right
+         << std::setw(7) << "status" << std::setw(14) << "instr/s"
+         << std::setw(12) << "frames/s" << std::setw(11) << "load ms"
+         << std::setw(11) << "decode ms" << std::setw(11) << "draw ms"
+         << std::setw(11) << "upscale ms" << std::endl;
+  stream << std::fixed;
+  for (const RomResult &result : results) {
+    double seconds = get_total_seconds(result);
+    stream << std::left << std::setw(28) << result.name.substr(0, 27)
+           << std::right << std::setw(7) << result.status
+           << std::setprecision(0)
+           << std::setw(14) << per_second(result.n_instructions, seconds)
+           << std::setw(12) << per_second(result.n_frames, seconds)
+           << std::setprecision(2)
+           << std::setw(11) << result.load_seconds * 1e3
+           << std::setw(11) << result.decode_seconds * 1e3
+           << std::setw(11) << result.draw_seconds * 1e3
+           << std::setw(11) << result.upscale_seconds * 1e3 << std::endl;
+  }
+  stream << std::defaultfloat;
+  // The high-water mark covers every ROM run so far, not one in particular
+  stream << "Peak RSS of the whole run: " << get_peak_rss_kb() << " KiB"
+         << std::endl;
+}
+
+// Quote a string as a JSON string literal
+std::string quote_json(const std::string &text) {
+  std::ostringstream quoted;
+  quoted << '"';
+  for (const char character : text) {
+    unsigned char code = static_cast<unsigned char>(character);
+    if (character == '"' || character == '\\') {
+      quoted << '\\' << character;
+    } else if (code < 0x20) {
+      quoted << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+             << static_cast<int>(code) << std::dec << std::setfill(' ');
+    } else {
+      quoted << character;
+    }
+  }
+  quoted << '"';
+  return quoted.str();
+}
+
+void write_json(std::ostream &stream, const std::vector<RomResult> &results,
+                const int n_frames, const bool recompiler) {
+  stream << "{\n  \"frames\": " << n_frames
+         << ",\n  \"instructions_per_frame\": " << INSTRUCTIONS_PER_FRAME
+         << ",\n  \"recompiler\": " << (recompiler ? "true" : "false")
+         << ",\n  \"draw_profiled\": "
+         << (Emulator::Profiler::is_enabled() ? "true" : "false")
+         << ",\n  \"peak_rss_kb\": " << get_peak_rss_kb() << ",\n";
+
+  stream << "  \"roms\": [";
+  const char *separator = "\n";
+  for (const RomResult &result : results) {
+    double seconds = get_total_seconds(result);
+    stream << separator << "    {\"rom\": " << quote_json(result.name)
+           << ", \"status\": \"" << result.status
+           << "\", \"frames\": " << result.n_frames
+           << ", \"instructions\": " << result.n_instructions
+           << ", \"instructions_per_second\": "
+           << per_second(result.n_instructions, seconds)
+           << ", \"frames_per_second\": " << per_second(result.n_frames, seconds)
+           << ", \"load_seconds\": " << result.load_seconds
+           << ", \"decode_seconds\": " << result.decode_seconds
+           << ", \"draw_seconds\": " << result.draw_seconds
+           << ", \"upscale_seconds\": " << result.upscale_seconds << "}";
+    separator = ",\n";
+  }
+  stream << "\n  ]\n}\n";
+}
+
+int main(int argc, char **argv) {
+  int n_frames = DEFAULT_N_FRAMES;
+  std::string json_path = DEFAULT_JSON_PATH;
+  bool recompiler = false;
+  std::string directory;
+  for (int arg = 1; arg < argc; arg++) {
+    std::string option(argv[arg]);
+    if (option.compare(0, 9, "--frames=") == 0) {
+      n_frames = std::stoi(option.substr(9));
+    } else if (option.compare(0, 7, "--json=") == 0) {
+      json_path = option.substr(7);
+    } else if (option == "--recompiler") {
+      recompiler = true;
+    } else {
+      directory = option;
+    }
+  }
+  if (directory.empty()) {
+    std::cout << "Usage: " << argv[0]
+              << " [--frames=N] [--json=FILE.json] [--recompiler] DIRECTORY"
+              << std::endl;
+    return 1;
+  }
+
+  std::vector<std::string> names = list_roms(directory);
+  if (names.empty()) {
+    std::cout << "No ROM found in " << directory << std::endl;
+    return 1;
+  }
+
+  // Nothing is printed until every ROM has run
+  std::vector<RomResult> results;
+  for (const std::string &name : names) {
+    results.push_back(run_rom(directory, name, n_frames, recompiler));
+  }
+
+  write_table(std::cout, results);
+  if (!Emulator::Profiler::is_enabled()) {
+    std::cout << "Draw time is included in decode time, reconfigure with "
+              << "-DCHIP8_ENABLE_PROFILER=ON to separate it" << std::endl;
+  }
+  std::ofstream json(json_path);
+  write_json(json, results, n_frames, recompiler);
+  std::cout << "Results written to " << json_path << std::endl;
+}
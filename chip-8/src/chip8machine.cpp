@@ -1,32 +1,81 @@
 #include "chip8machine.hpp"
 
+#include <algorithm>
+#include <sstream>
+
 namespace Emulator {
 
-Chip8Machine::Chip8Machine()
+Chip8Machine::Chip8Machine() : Chip8Machine(QuirksProfile::DEFAULT) {}
+
+/// \brief Create a machine emulating a specific CHIP-8 interpreter
+/// \param profile Quirk policy to use for ambiguous instructions
+Chip8Machine::Chip8Machine(const QuirksProfile profile)
     : display_height(MAX_HEIGHT),
       display_width(MAX_WIDTH), memory_size(RAM_SIZE),
-      ram(RAM_SIZE, ROM_START_ADDRESS), display(MAX_HEIGHT, MAX_WIDTH),
-      kill_threads(false), timers_started(false), delay_timer(0),
-      distribution(0, MAX_RANDOM_NUMBER) {}
+      state(),
+      waiting_for_key(false), fault{Fault::NONE, 0, 0}, elided_cycles(0),
+      dirty_rows(ALL_ROWS), sound_playing(false),
+      quirks_profile(profile),
+      handlers(&handler_tables(profile)), timing_model(TimingModel::INSTRUCTIONS) {
+  set_seed(0);
+}
+
+/// \brief Return the quirk policy used for ambiguous instructions
+/// \return Current quirk policy
+QuirksProfile Chip8Machine::get_quirks_profile() const {
+  return quirks_profile;
+}
+
+/// \brief Switch to the handlers instantiated for another quirk policy
+///
+/// Every predecoded instruction and compiled block is discarded, since they
+/// refer to the handlers of the previous policy
+///
+/// \param profile Quirk policy to use for ambiguous instructions
+void Chip8Machine::set_quirks_profile(const QuirksProfile profile) {
+  quirks_profile = profile;
+  handlers = &handler_tables(profile);
+  invalidate_all_instructions();
+  set_recompiler(static_cast<bool>(recompiler));
+}
 
 /// \brief Return the value of the pixel located at (x, y) position
 /// \param x Horizontal position of pixel, where 0 corresponds to left edge
 /// \param y Vertical position of pixel, where 0 corresponds to upper edge
 /// \return the value of the pixel
-const PIXEL_TYPE &Chip8Machine::get_pixel(const int x, const int y) const {
-  return display.get_pixel(x, y);
+PIXEL_TYPE Chip8Machine::get_pixel(const int x, const int y) const {
+  return (state.screen[y] >> (MAX_WIDTH - 1 - x)) & 0x1;
+}
+
+/// \brief Return every row of the screen
+///
+/// Each row is a word, the leftmost pixel being the most significant bit
+///
+/// \return Rows of pixels, from top to bottom
+const std::array<uint64_t, MAX_HEIGHT> &Chip8Machine::get_screen() const {
+  return state.screen;
 }
 
 void Chip8Machine::set_pixel(const int x, const int y, const PIXEL_TYPE value) {
-  display.set_pixel(x, y, value);
+  mark_rows_dirty(uint64_t{1} << y);
+  uint64_t mask = uint64_t{1} << (MAX_WIDTH - 1 - x);
+  if (value == 0) {
+    state.screen[y] &= ~mask;
+  } else {
+    state.screen[y] |= mask;
+  }
 }
 
 ADDR_TYPE Chip8Machine::get_pc() const {
-  return pc.get();
+  return state.pc;
 }
 
 std::vector<MEM_TYPE> Chip8Machine::get_ram(bool include_start) const {
-  return ram.get_ram(include_start);
+  auto first = state.ram.begin();
+  if (!include_start) {
+    first += ROM_START_ADDRESS;
+  }
+  return std::vector<MEM_TYPE>(first, state.ram.end());
 }
 
 /// \brief Return pointer to first address in system RAM
@@ -35,84 +84,271 @@ std::vector<MEM_TYPE> Chip8Machine::get_ram(bool include_start) const {
 ///
 /// \return Pointer to first address in system RAM
 void *Chip8Machine::get_pointer_to_ram_start() const {
-  return ram.get_pointer_to_ram_start();
+  return const_cast<MEM_TYPE *>(state.ram.data());
 }
 
 void Chip8Machine::set_pc(const ADDR_TYPE new_pc) {
-  pc.set(new_pc);
+  state.pc = new_pc;
 }
 
 /// \brief Reset the screen to its default state
 void Chip8Machine::clear_screen() {
-  display.clear();
+  for (int y = 0; y < MAX_HEIGHT; y++) {
+    if (state.screen[y] != 0) mark_rows_dirty(uint64_t{1} << y);
+  }
+  state.screen.fill(0);
+}
+
+/// \brief Return the rows of the screen changed since clear_dirty_rows()
+///
+/// Rows are flagged by DXYN, 00E0 and set_state();  a flagged row may end up
+/// unchanged, e.g. when a sprite is drawn twice.  Every row starts flagged.
+///
+/// \return Mask of the changed rows, bit y standing for row y
+uint64_t Chip8Machine::get_dirty_rows() const {
+  return dirty_rows;
+}
+
+/// \brief Return whether any row of the screen changed since
+///        clear_dirty_rows()
+/// \return Whether a new frame needs to be presented
+bool Chip8Machine::is_frame_changed() const {
+  return dirty_rows != 0;
 }
 
+/// \brief Mark every row of the screen as presented
+void Chip8Machine::clear_dirty_rows() {
+  dirty_rows = 0;
+}
+
+void Chip8Machine::mark_rows_dirty(const uint64_t rows) {
+  dirty_rows |= rows;
+}
+
+/// \brief Write a byte of RAM
+///
+/// Addresses wrap around the end of RAM, as the address bus is only 12 bits
+/// wide
+///
+/// \param address Memory address to change
+/// \param value New value for contents of memory address
 void Chip8Machine::set_memory_byte(ADDR_TYPE address, MEM_TYPE value) {
-  ram.set_byte(address, value);
+  address &= RAM_SIZE - 1;
+  state.ram[address] = value;
+  invalidate_instructions(address, address + 1);
 }
 
 MEM_TYPE Chip8Machine::get_memory_byte(ADDR_TYPE address) const {
-  return ram.get_byte(address);
+  return state.ram[address & (RAM_SIZE - 1)];
 }
 
 /// \brief Load ROM into system RAM
+///
+/// Bytes which do not fit in RAM are ignored
+///
 /// \param rom ROM to load into system RAM
 void Chip8Machine::load_rom(const std::vector<MEM_TYPE> &rom) {
-  ram.load_rom(rom);
+  size_t size = std::min<size_t>(rom.size(), RAM_SIZE - ROM_START_ADDRESS);
+  std::copy(rom.begin(), rom.begin() + size,
+            state.ram.begin() + ROM_START_ADDRESS);
+  invalidate_instructions(ROM_START_ADDRESS, ROM_START_ADDRESS + size);
+}
+
+/// \brief Return the complete state of the machine
+///
+/// The state is plain data, so a snapshot is a copy of the returned value
+///
+/// \return Registers, stack, timers, screen and RAM of the machine
+const MachineState &Chip8Machine::get_state() const {
+  return state;
+}
+
+/// \brief Restore the complete state of the machine, e.g. from a snapshot
+///
+/// Every predecoded instruction is discarded, since RAM may have changed
+///
+/// \param new_state State to restore
+void Chip8Machine::set_state(const MachineState &new_state) {
+  state = new_state;
+  waiting_for_key = false;
+  mark_rows_dirty(ALL_ROWS);
+  invalidate_all_instructions();
+}
+
+/// \brief Discard predecoded instructions overlapping an address range
+///
+/// Must be called whenever RAM is written, so that self-modifying code
+/// executes the new instructions
+///
+/// \param first First address written
+/// \param last One past the last address written
+void Chip8Machine::invalidate_instructions(const ADDR_TYPE first,
+                                           const ADDR_TYPE last) {
+  ADDR_TYPE last_slot = (last + 1) / INSTRUCTION_LENGTH;
+  if (last_slot > instruction_cache.size()) {
+    last_slot = instruction_cache.size();
+  }
+  for (ADDR_TYPE slot = first / INSTRUCTION_LENGTH; slot < last_slot; slot++) {
+    instruction_cache[slot].handler = nullptr;
+  }
+  invalidate_blocks(first, last);
+}
+
+/// \brief Discard every predecoded instruction and basic block
+void Chip8Machine::invalidate_all_instructions() {
+  for (DecodedInstruction &instruction : instruction_cache) {
+    instruction.handler = nullptr;
+  }
+  block_cache.clear();
+  block_code.reset();
 }
 
 OPCODE_TYPE Chip8Machine::fetch_instruction() const {
-  ADDR_TYPE pc_ = pc.get();
-  MEM_TYPE byte_one = ram.get_byte(pc_);
-  MEM_TYPE byte_two = ram.get_byte(pc_ + 1);
+  MEM_TYPE byte_one = get_memory_byte(state.pc);
+  MEM_TYPE byte_two = get_memory_byte(state.pc + 1);
   return (byte_one << 8) + byte_two;
 }
 
 /// \brief Perform one iteration of the instruction cycle
+/// \throw OpcodeNotSupported if the instruction is not supported
 void Chip8Machine::advance() {
-  OPCODE_TYPE opcode = fetch_instruction();
-  pc.add(INSTRUCTION_LENGTH);
-  decode(opcode);
+  step();
+  throw_if_faulted();
+}
+
+/// \brief Perform one iteration of the instruction cycle, without throwing
+///
+/// Instructions at even addresses are decoded on first execution and cached,
+/// the (rare) instructions at odd addresses are decoded every time
+void Chip8Machine::step() {
+  ADDR_TYPE address = state.pc;
+  if ((address % INSTRUCTION_LENGTH) != 0 || address + 1 >= memory_size) {
+    OPCODE_TYPE opcode = fetch_instruction();
+    state.pc += INSTRUCTION_LENGTH;
+#ifdef CHIP8_ENABLE_PROFILER
+    if (profiler) {
+      execute_profiled(predecode(opcode), address);
+      return;
+    }
+#endif
+    execute(opcode);
+    return;
+  }
+
+  DecodedInstruction &instruction =
+      instruction_cache[address / INSTRUCTION_LENGTH];
+  if (instruction.handler == nullptr) {
+    instruction = predecode(fetch_instruction());
+  }
+  state.pc += INSTRUCTION_LENGTH;
+  // Self-modifying code may invalidate this very slot while it executes;
+  // invalidation only clears the handler, so the operands remain readable
+#ifdef CHIP8_ENABLE_PROFILER
+  if (profiler) {
+    execute_profiled(instruction, address);
+    return;
+  }
+#endif
+  (this->*instruction.handler)(instruction);
 }
 
-REG_TYPE Chip8Machine::get_i() const { return i_register.get(); }
+REG_TYPE Chip8Machine::get_i() const { return state.i; }
 
+// Instructions only name V0-VF, so an invalid register number comes from a
+// caller outside of any instruction:  the fault carries no opcode
 REG_TYPE Chip8Machine::get_v(const int reg_num) const {
-  if (reg_num < v_register.size()) return v_register[reg_num].get();
-  throw std::runtime_error(
-      "Invalid register V" + std::to_string(reg_num) + " specified.");
+  if (reg_num >= 0 && static_cast<size_t>(reg_num) < state.v.size()) {
+    return state.v[reg_num];
+  }
+  raise_fault(Fault::INVALID_REGISTER, state.pc, 0);
+  return 0;
 }
-REG_TYPE Chip8Machine::get_flag() const { return v_register[0xF].get(); }
+REG_TYPE Chip8Machine::get_flag() const { return state.v[0xF]; }
 
 ADDR_TYPE Chip8Machine::get_top_of_stack() const {
-  return call_stack.top();
+  if (state.sp == 0) return 0;
+  return state.stack[state.sp - 1];
 }
 
 REG_TYPE Chip8Machine::get_delay_timer() const {
-  return delay_timer;
+  return state.delay_timer;
+}
+
+REG_TYPE Chip8Machine::get_sound_timer() const {
+  return state.sound_timer;
 }
 
 void Chip8Machine::set_i(const REG_TYPE new_value) {
-  i_register.set(new_value);
+  state.i = new_value;
 }
 void Chip8Machine::set_v(const int reg_num, const REG_TYPE new_value) {
-  if (reg_num < v_register.size()) {
-    v_register[reg_num].set(new_value);
+  if (reg_num >= 0 && static_cast<size_t>(reg_num) < state.v.size()) {
+    state.v[reg_num] = new_value;
     return;
   }
-  throw std::runtime_error(
-      "Invalid register V" + std::to_string(reg_num) + " specified.");
+  raise_fault(Fault::INVALID_REGISTER, state.pc, 0);
 }
 void Chip8Machine::set_flag(const REG_TYPE new_value) {
-  set_v(0xF, new_value);
+  state.v[0xF] = new_value;
+}
+
+/// \brief Return the first error detected since the last clear_fault()
+/// \return Fault status, whose code is Fault::NONE if no error occurred
+const FaultInfo &Chip8Machine::get_fault() const {
+  return fault;
+}
+
+/// \brief Forget the current fault, allowing execution to resume
+void Chip8Machine::clear_fault() {
+  fault = FaultInfo{Fault::NONE, 0, 0};
+}
+
+/// \brief Record an error, unless an earlier one is still pending
+/// \param code Kind of error
+/// \param address Address of the faulting instruction
+/// \param opcode Faulting instruction
+void Chip8Machine::raise_fault(const Fault code, const ADDR_TYPE address,
+                               const OPCODE_TYPE opcode) const {
+  if (fault.code != Fault::NONE) return;
+  fault = FaultInfo{code, address, opcode};
+}
+
+/// \brief Turn a pending fault into an exception, for the throwing API
+///
+/// The fault is cleared, as the exception reports it to the caller
+void Chip8Machine::throw_if_faulted() {
+  if (fault.code == Fault::NONE) return;
+  FaultInfo raised = fault;
+  clear_fault();
+  switch (raised.code) {
+    case Fault::UNSUPPORTED_OPCODE:
+      throw OpcodeNotSupported(raised.opcode);
+    case Fault::INVALID_REGISTER:
+      throw std::runtime_error("Invalid register specified.");
+    case Fault::STACK_OVERFLOW:
+      throw std::runtime_error("Call with full call stack at "
+                               + std::to_string(raised.pc));
+    default:
+      throw std::runtime_error("Return with empty call stack at "
+                               + std::to_string(raised.pc));
+  }
 }
 
 void Chip8Machine::add_to_stack(const ADDR_TYPE new_top) {
-  call_stack.push(new_top);
+  if (state.sp == STACK_DEPTH) {
+    raise_fault(Fault::STACK_OVERFLOW, state.pc, 0);
+    return;
+  }
+  state.stack[state.sp] = new_top;
+  state.sp += 1;
 }
 
 void Chip8Machine::set_delay_timer(const REG_TYPE new_delay) {
-  delay_timer = new_delay;
+  state.delay_timer = new_delay;
+}
+
+void Chip8Machine::set_sound_timer(const REG_TYPE new_sound) {
+  state.sound_timer = new_sound;
 }
 
 static std::string opcode_to_hex_str(const OPCODE_TYPE value) {
@@ -126,14 +362,14 @@ static std::string opcode_to_hex_str(const OPCODE_TYPE value) {
 Chip8Machine::operator std::string() const {
   std::stringstream stream;
   stream << "Current status of Chip8Machine:" << std::endl;
-  stream << "- PC: " << opcode_to_hex_str(pc.get()) << " , ";
-  stream << "I: " << opcode_to_hex_str(i_register.get()) << " , ";
+  stream << "- PC: " << opcode_to_hex_str(state.pc) << " , ";
+  stream << "I: " << opcode_to_hex_str(state.i) << " , ";
   stream << "Flag: " << opcode_to_hex_str(get_flag()) << " , ";
   stream << "Opcode: " << opcode_to_hex_str(fetch_instruction()) << std::endl;
-  stream << "- V[0]: " << opcode_to_hex_str(v_register[0].get());
+  stream << "- V[0]: " << opcode_to_hex_str(state.v[0]);
   for (int n = 1; n < NUM_V_REGS - 1; n++) {
     stream << " , V[" << n << "]: "
-           << opcode_to_hex_str(v_register[n].get());
+           << opcode_to_hex_str(state.v[n]);
   }
   return stream.str();
 }
@@ -143,52 +379,54 @@ Chip8Machine::operator std::string() const {
 /// Does not unload the currently-loaded ROM, may have unintended consequences
 /// for self-modifying code.
 void Chip8Machine::reset() {
-  pc.set(ROM_START_ADDRESS);
+  state.pc = ROM_START_ADDRESS;
+  waiting_for_key = false;
+}
+
+/// \brief Update the state of a key on the hexadecimal keypad
+/// \param key Key to update, from 0x0 to 0xF
+/// \param pressed Whether the key is held down
+void Chip8Machine::set_key(const int key, const bool pressed) {
+  keys.set(key, pressed);
 }
 
 /// \brief Trigger the delay timer, decrementing it if it's greater than zero
 void Chip8Machine::trigger_delay_timer() {
-  if (delay_timer == 0) return;
-  delay_timer -= 1;
-}
-
-namespace {
-  void delay_timer_coroutine(Chip8Machine* machine) {
-    while (!machine->kill_threads) {
-      std::this_thread::sleep_for(std::chrono::microseconds(16667) );
-//      std::this_thread::sleep_for(
-//          std::chrono::duration<int, std::ratio<60, 1>>
-//      );
-      machine->trigger_delay_timer();
-    }
-  }
-}  // namespace
-
-void Chip8Machine::start_timers() {
-  kill_threads = false;
-  threads.emplace_back(delay_timer_coroutine, this);
-  timers_started = true;
+  if (state.delay_timer == 0) return;
+  state.delay_timer -= 1;
 }
 
-void Chip8Machine::kill_timers() {
-  if (!timers_started) return;
-
-  kill_threads = true;
-  for (auto &thread : threads) {
-    thread.join();
-  }
-  kill_threads = false;
-  timers_started = false;
+/// \brief Restart the random number generator used by CXNN
+/// \param seed Seed for the generator, any value is valid
+void Chip8Machine::set_seed(int seed) {
+  // xorshift gets stuck at zero, which the constant keeps seed 0 away from
+  state.rng = static_cast<uint32_t>(seed) ^ 0x9E3779B9u;
+  if (state.rng == 0) state.rng = 0x9E3779B9u;
 }
 
-void Chip8Machine::set_seed(int seed) {
-  generator.seed(seed);
+/// \brief Advance the xorshift32 generator
+/// \return Random value between 0 and MAX_RANDOM_NUMBER
+REG_TYPE Chip8Machine::next_random_byte() {
+  uint32_t value = state.rng;
+  value ^= value << 13;
+  value ^= value >> 17;
+  value ^= value << 5;
+  state.rng = value;
+  // The high bits of xorshift are the most random ones
+  return (value >> 24) & MAX_RANDOM_NUMBER;
 }
 
 /// \brief Return the contents of the display as an ASCII representation
 /// \return Contents of the display as an ASCII representation
 std::string Chip8Machine::display_str() const {
-  return std::string(display);
+  std::stringstream stream;
+  for (int y = 0; y < display_height; y++) {
+    for (int x = 0; x < display_width; x++) {
+      stream << (get_pixel(x, y) == 0 ? " " : "X");
+    }
+    stream << std::endl;
+  }
+  return stream.str();
 }
 
 /// \brief Report that an unimplemented opcode was parsed
@@ -0,0 +1,158 @@
+#include <chrono>  // NOLINT [build/c++11]
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "chip8machine.hpp"
+#include "memory.hpp"
+
+const long DEFAULT_N_INSTRUCTIONS = 20000000;
+
+// Busy loop touching the common instruction families (loads, ALU, skips,
+// BCD, register loads from memory and sprite drawing), ending in a jump back
+// to the start of the ROM
+const std::vector<Emulator::MEM_TYPE> BUILTIN_ROM = {
+    0x60, 0x05,  // 0x200: V0 = 0x05
+    0x61, 0x0A,  // 0x202: V1 = 0x0A
+    0x70, 0x01,  // 0x204: V0 += 0x01
+    0x80, 0x14,  // 0x206: V0 += V1, VF = carry
+    0x82, 0x02,  // 0x208: V2 &= V0
+    0x81, 0x05,  // 0x20A: V1 -= V0, VF = !borrow
+    0x30, 0x00,  // 0x20C: skip if V0 == 0x00
+    0x40, 0x00,  // 0x20E: skip if V0 != 0x00
+    0xA3, 0x00,  // 0x210: I = 0x300
+    0xF0, 0x33,  // 0x212: BCD of V0 at I
+    0xF2, 0x65,  // 0x214: V0-V2 = memory at I
+    0xD0, 0x15,  // 0x216: draw 5 rows at (V0, V1)
+    0xF0, 0x15,  // 0x218: delay timer = V0
+    0xF3, 0x07,  // 0x21A: V3 = delay timer
+    0x12, 0x00   // 0x21C: jump to 0x200
+};
+
+std::vector<Emulator::MEM_TYPE> load_rom(int argc, char **argv) {
+  if (argc < 2) return BUILTIN_ROM;
+
+  void *data;
+  size_t size;
+  std::tie(data, size) =
+      Emulator::Memory::get_bytestream_from_file(std::string(argv[1]));
+  std::vector<Emulator::MEM_TYPE> rom =
+      Emulator::Memory::convert_bytestream_to_vector(data, size);
+  delete[] static_cast<char *>(data);
+  return rom;
+}
+
+void report(const std::string &engine, long n_executed, double seconds) {
+  std::cout << "Engine:                " << engine << std::endl;
+  std::cout << "Instructions executed: " << n_executed << std::endl;
+  std::cout << "Elapsed time (s):      " << seconds << std::endl;
+  std::cout << "Instructions/sec:      " << n_executed / seconds << std::endl;
+}
+
+const char *describe_status(const Emulator::RunStatus status) {
+  switch (status) {
+    case Emulator::RunStatus::HALTED: return "program halted";
+    case Emulator::RunStatus::UNSUPPORTED_OPCODE:
+      return "unsupported instruction";
+    case Emulator::RunStatus::WAITING_FOR_KEY: return "waiting for a key";
+    default: return "program faulted";
+  }
+}
+
+// Every engine starts from the same state, so that runs are identical
+Emulator::Chip8Machine create_machine(
+    const std::vector<Emulator::MEM_TYPE> &rom) {
+  Emulator::Chip8Machine machine;
+  machine.reset();
+  machine.load_rom(rom);
+  machine.set_seed(0);
+  return machine;
+}
+
+// Instructions executed by a chunk cut short by a fault, found by replaying
+// the run on a fresh machine, one instruction at a time over the last chunk
+long count_faulted_chunk(const std::vector<Emulator::MEM_TYPE> &rom,
+                         const long n_before, const int chunk) {
+  Emulator::Chip8Machine machine = create_machine(rom);
+  for (long n_executed = 0; n_executed < n_before; n_executed += chunk) {
+    machine.run_cycles(chunk);
+  }
+  long n_executed = 0;
+  while (n_executed < chunk
+         && machine.run_cycles(1) == Emulator::RunStatus::OK) {
+    n_executed++;
+  }
+  return n_executed;
+}
+
+// Every engine is run for the same number of instructions on a fresh machine
+void run_engine(const std::string &engine,
+                const std::vector<Emulator::MEM_TYPE> &rom,
+                long n_instructions) {
+  Emulator::Chip8Machine machine = create_machine(rom);
+  if (engine == "recompiler" && !machine.set_recompiler(true)) {
+    std::cout << "Recompiler not supported on this build" << std::endl;
+    return;
+  }
+
+  // Batched engines are fed in chunks so the loop overhead is negligible
+  const int chunk = 1000;
+  long n_executed = 0;
+  Emulator::RunStatus status = Emulator::RunStatus::OK;
+  bool faulted = false;
+  auto start = std::chrono::steady_clock::now();
+  if (engine == "advance" || engine == "threaded") {
+    try {
+      if (engine == "advance") {
+        for (; n_executed < n_instructions; n_executed++) {
+          machine.advance();
+        }
+      } else {
+        for (; n_executed < n_instructions; n_executed += chunk) {
+          machine.run(chunk);
+        }
+      }
+    }
+    catch (const Emulator::OpcodeNotSupported &err) {
+      std::cout << "Stopped early: " << err.what() << std::endl;
+      // advance() counts instructions one by one, run() whole chunks
+      faulted = engine == "threaded";
+    }
+  } else {
+    for (; n_executed < n_instructions; n_executed += chunk) {
+      uint64_t elided_cycles = machine.get_elided_cycles();
+      status = machine.run_cycles(chunk);
+      if (status == Emulator::RunStatus::OK) continue;
+      std::cout << "Stopped early: " << describe_status(status) << std::endl;
+      // Halts and key waits account for the cycles they did not execute
+      if (status == Emulator::RunStatus::HALTED
+          || status == Emulator::RunStatus::WAITING_FOR_KEY) {
+        n_executed += chunk
+            - static_cast<long>(machine.get_elided_cycles() - elided_cycles);
+      } else {
+        faulted = true;
+      }
+      break;
+    }
+  }
+  auto stop = std::chrono::steady_clock::now();
+
+  if (faulted) n_executed += count_faulted_chunk(rom, n_executed, chunk);
+
+  report(engine, n_executed,
+         std::chrono::duration<double>(stop - start).count());
+}
+
+int main(int argc, char **argv) {
+  std::vector<Emulator::MEM_TYPE> rom = load_rom(argc, argv);
+  long n_instructions = DEFAULT_N_INSTRUCTIONS;
+  if (argc > 2) n_instructions = std::stol(argv[2]);
+
+  run_engine("advance", rom, n_instructions);
+  std::cout << std::endl;
+  run_engine("threaded", rom, n_instructions);
+  std::cout << std::endl;
+  run_engine("run_cycles", rom, n_instructions);
+  std::cout << std::endl;
+  run_engine("recompiler", rom, n_instructions);
+}
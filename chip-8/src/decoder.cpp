@@ -1,7 +1,213 @@
 #include "chip8machine.hpp"
 
+#include <chrono>  // NOLINT
+
+#include "display.hpp"
+
+#if defined(__GNUC__)
+// Labels as values (GCC extension, also supported by Clang)
+#define CHIP8_THREADED_INTERPRETER
+#endif
+
+// Every handler predecode() may resolve to, in the order used by the
+// threaded interpreter.  Q marks handlers instantiated per quirk policy
+#define CHIP8_RESOLVED_HANDLERS(X, Q) \
+  X(unsupported) X(00E0) X(00EE) X(1NNN) X(2NNN) X(3XNN) X(4XNN) X(6XNN) \
+  X(7XNN) X(8XY0) Q(8XY1) Q(8XY2) Q(8XY3) X(8XY4) X(8XY5) Q(8XY6) X(8XY7) \
+  Q(8XYE) X(ANNN) Q(BNNN) X(CXNN) Q(DXYN) X(EX9E) X(EXA1) X(FX07) X(FX0A) \
+  X(FX15) X(FX18) X(FX29) X(FX33) Q(FX55) Q(FX65)
+
 namespace Emulator {
 
+// Instructions are classified by their high nibble into the opcode table;
+// the families whose meaning depends on further bits (8XYN, EXNN, FXNN) are
+// dispatched a second time on their low nibble/byte, so that every
+// instruction costs at most two indexed jumps instead of a chain of masked
+// comparisons.
+//
+// Handlers whose behavior differs between interpreters are templates on a
+// quirk policy (see quirks.hpp), and every policy gets its own set of tables
+
+template <class Quirks>
+Chip8Machine::HandlerTables Chip8Machine::build_handler_tables() {
+  HandlerTables tables;
+  tables.opcode.fill(&Chip8Machine::op_unsupported);
+  tables.opcode[0x0] = &Chip8Machine::op_0NNN;
+  tables.opcode[0x1] = &Chip8Machine::op_1NNN;
+  tables.opcode[0x2] = &Chip8Machine::op_2NNN;
+  tables.opcode[0x3] = &Chip8Machine::op_3XNN;
+  tables.opcode[0x4] = &Chip8Machine::op_4XNN;
+  tables.opcode[0x6] = &Chip8Machine::op_6XNN;
+  tables.opcode[0x7] = &Chip8Machine::op_7XNN;
+  tables.opcode[0x8] = &Chip8Machine::op_8XYN;
+  tables.opcode[0xA] = &Chip8Machine::op_ANNN;
+  tables.opcode[0xB] = &Chip8Machine::op_BNNN<Quirks>;
+  tables.opcode[0xC] = &Chip8Machine::op_CXNN;
+  tables.opcode[0xD] = &Chip8Machine::op_DXYN<Quirks>;
+  tables.opcode[0xE] = &Chip8Machine::op_EXNN;
+  tables.opcode[0xF] = &Chip8Machine::op_FXNN;
+
+  tables.arithmetic.fill(&Chip8Machine::op_unsupported);
+  tables.arithmetic[0x0] = &Chip8Machine::op_8XY0;
+  tables.arithmetic[0x1] = &Chip8Machine::op_8XY1<Quirks>;
+  tables.arithmetic[0x2] = &Chip8Machine::op_8XY2<Quirks>;
+  tables.arithmetic[0x3] = &Chip8Machine::op_8XY3<Quirks>;
+  tables.arithmetic[0x4] = &Chip8Machine::op_8XY4;
+  tables.arithmetic[0x5] = &Chip8Machine::op_8XY5;
+  tables.arithmetic[0x6] = &Chip8Machine::op_8XY6<Quirks>;
+  tables.arithmetic[0x7] = &Chip8Machine::op_8XY7;
+  tables.arithmetic[0xE] = &Chip8Machine::op_8XYE<Quirks>;
+
+  tables.key.fill(&Chip8Machine::op_unsupported);
+  tables.key[0x9E] = &Chip8Machine::op_EX9E;
+  tables.key[0xA1] = &Chip8Machine::op_EXA1;
+
+  tables.misc.fill(&Chip8Machine::op_unsupported);
+  tables.misc[0x07] = &Chip8Machine::op_FX07;
+  tables.misc[0x0A] = &Chip8Machine::op_FX0A;
+  tables.misc[0x15] = &Chip8Machine::op_FX15;
+  tables.misc[0x18] = &Chip8Machine::op_FX18;
+  tables.misc[0x29] = &Chip8Machine::op_FX29;
+  tables.misc[0x33] = &Chip8Machine::op_FX33;
+  tables.misc[0x55] = &Chip8Machine::op_FX55<Quirks>;
+  tables.misc[0x65] = &Chip8Machine::op_FX65<Quirks>;
+
+#define CHIP8_HANDLER_ADDRESS(name) &Chip8Machine::op_##name,
+#define CHIP8_QUIRK_HANDLER_ADDRESS(name) &Chip8Machine::op_##name<Quirks>,
+  tables.resolved = {
+      CHIP8_RESOLVED_HANDLERS(CHIP8_HANDLER_ADDRESS,
+                              CHIP8_QUIRK_HANDLER_ADDRESS)
+  };
+#undef CHIP8_QUIRK_HANDLER_ADDRESS
+#undef CHIP8_HANDLER_ADDRESS
+
+  tables.run_threaded = &Chip8Machine::run_threaded<Quirks>;
+  tables.logic_resets_vf = Quirks::LOGIC_RESETS_VF;
+  return tables;
+}
+
+/// \brief Return the dispatch tables instantiated for a quirk policy
+/// \param profile Quirk policy to look up
+/// \return Dispatch tables for the policy
+const Chip8Machine::HandlerTables &Chip8Machine::handler_tables(
+    const QuirksProfile profile) {
+  static const HandlerTables default_tables =
+      build_handler_tables<DefaultQuirks>();
+  static const HandlerTables cosmac_vip_tables =
+      build_handler_tables<CosmacVipQuirks>();
+  static const HandlerTables super_chip_tables =
+      build_handler_tables<SuperChipQuirks>();
+  static const HandlerTables xo_chip_tables =
+      build_handler_tables<XoChipQuirks>();
+  switch (profile) {
+    case QuirksProfile::COSMAC_VIP:
+      return cosmac_vip_tables;
+    case QuirksProfile::SUPER_CHIP:
+      return super_chip_tables;
+    case QuirksProfile::XO_CHIP:
+      return xo_chip_tables;
+    default:
+      return default_tables;
+  }
+}
+
+/// \brief Split an instruction into its operand fields
+/// \param opcode_ Instruction to split
+Chip8Machine::DecodedInstruction::DecodedInstruction(const OPCODE_TYPE opcode_)
+    : handler(nullptr), opcode(opcode_), x((opcode_ & 0x0F00) >> 8),
+      y((opcode_ & 0x00F0) >> 4), n(opcode_ & 0x000F), nn(opcode_ & 0x00FF),
+      nnn(opcode_ & 0x0FFF), handler_index(0) {}
+
+/// \brief Find the handler which executes an instruction
+///
+/// Unlike the handlers stored in the opcode table, the handler returned never
+/// dispatches a second time, so it is suitable for caching
+///
+/// \param opcode Instruction to resolve
+/// \return Handler executing the instruction
+Chip8Machine::OpcodeHandler Chip8Machine::resolve_handler(
+    const OPCODE_TYPE opcode) const {
+  OpcodeHandler handler = handlers->opcode[opcode >> 12];
+  if (handler == &Chip8Machine::op_0NNN) {
+    if (opcode == 0x00E0) return &Chip8Machine::op_00E0;
+    if (opcode == 0x00EE) return &Chip8Machine::op_00EE;
+    return &Chip8Machine::op_unsupported;
+  }
+  if (handler == &Chip8Machine::op_8XYN) {
+    return handlers->arithmetic[opcode & 0x000F];
+  }
+  if (handler == &Chip8Machine::op_EXNN) return handlers->key[opcode & 0x00FF];
+  if (handler == &Chip8Machine::op_FXNN) return handlers->misc[opcode & 0x00FF];
+  return handler;
+}
+
+/// \brief Decode an instruction once, so that it may be executed many times
+/// \param opcode Instruction to decode
+/// \return Instruction with its fields extracted and its handler resolved
+Chip8Machine::DecodedInstruction Chip8Machine::predecode(
+    const OPCODE_TYPE opcode) const {
+  DecodedInstruction instruction(opcode);
+  instruction.handler = resolve_handler(opcode);
+  instruction.handler_index = find_handler_index(instruction.handler);
+  return instruction;
+}
+
+/// \brief Find the position of a resolved handler in CHIP8_RESOLVED_HANDLERS
+/// \param handler Handler returned by resolve_handler()
+/// \return Position of the handler
+uint8_t Chip8Machine::find_handler_index(const OpcodeHandler handler) const {
+  uint8_t index = 0;
+  for (OpcodeHandler current : handlers->resolved) {
+    if (current == handler) return index;
+    index += 1;
+  }
+  return 0;
+}
+
+/// \brief Return the name of every handler predecode() may resolve to
+/// \return Handler names, indexed by DecodedInstruction::handler_index
+std::vector<std::string> Chip8Machine::handler_names() {
+#define CHIP8_HANDLER_NAME(name) #name,
+  return {CHIP8_RESOLVED_HANDLERS(CHIP8_HANDLER_NAME, CHIP8_HANDLER_NAME)};
+#undef CHIP8_HANDLER_NAME
+}
+
+/// \brief Select whether executed instructions are recorded in a profile
+///
+/// Profiling is only available in builds configured with
+/// CHIP8_ENABLE_PROFILER.  While profiling, run() and run_cycles() execute
+/// every instruction through the interpreter, so that it can be timed.
+/// Enabling the profiler again starts a new profile.
+///
+/// \param enabled Whether to profile
+/// \return Whether instructions are now being profiled
+bool Chip8Machine::set_profiler(const bool enabled) {
+  profiler.reset();
+  if (enabled && Profiler::is_enabled()) {
+    profiler.reset(new Profiler(handler_names()));
+  }
+  return static_cast<bool>(profiler);
+}
+
+/// \brief Return the profile being recorded
+/// \return Current profile, nullptr if not profiling
+const Profiler *Chip8Machine::get_profiler() const {
+  return profiler.get();
+}
+
+/// \brief Execute a predecoded instruction, recording it in the profile
+/// \param instruction Instruction to execute
+/// \param address Address of the instruction
+void Chip8Machine::execute_profiled(const DecodedInstruction &instruction,
+                                    const ADDR_TYPE address) {
+  auto start = std::chrono::steady_clock::now();
+  (this->*instruction.handler)(instruction);
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  profiler->record(instruction.handler_index, address,
+                   std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       elapsed).count());
+}
+
 /// \brief Executes an instruction for the current machine state
 ///
 /// This subroutine assumes the program counter has already been incremented
@@ -9,181 +215,357 @@ namespace Emulator {
 /// decoding instructions that modify the program counter!
 ///
 /// \param opcode Instruction to execute
+/// \throw OpcodeNotSupported if the instruction is not supported
 void Chip8Machine::decode(const OPCODE_TYPE opcode) {
+  execute(opcode);
+  throw_if_faulted();
+}
+
+/// \brief Executes an instruction, reporting errors through the fault status
+///
+/// Same as decode(), without throwing
+///
+/// \param opcode Instruction to execute
+/// \return Current fault, which may predate this instruction
+Fault Chip8Machine::execute(const OPCODE_TYPE opcode) {
   // Are ya coding, son?
-  if (opcode == 0x00E0) {
-    display.clear();
-    return;
-  }
-  if (opcode == 0x00EE) {
-    ADDR_TYPE new_addr = call_stack.top();
-    call_stack.pop();
-    pc.set(new_addr);
-    return;
-  }
-  if ((opcode & 0xF000) == 0x1000) {
-    int value = opcode & 0x0FFF;
-    pc.set(value);
-    return;
-  }
-  if ((opcode & 0xF000) == 0x2000) {
-    int value = opcode & 0x0FFF;
-    call_stack.push(get_pc());
-    pc.set(value);
+  DecodedInstruction instruction(opcode);
+  (this->*handlers->opcode[opcode >> 12])(instruction);
+  return fault.code;
+}
+
+void Chip8Machine::op_unsupported(const DecodedInstruction &instruction) {
+  raise_fault(Fault::UNSUPPORTED_OPCODE, state.pc - INSTRUCTION_LENGTH,
+              instruction.opcode);
+}
+
+void Chip8Machine::op_0NNN(const DecodedInstruction &instruction) {
+  if (instruction.opcode == 0x00E0) {
+    op_00E0(instruction);
     return;
   }
-  if ((opcode & 0xF000) == 0x3000) {
-    int reg_num = (opcode & 0x0F00) >> 8;
-    int value = opcode & 0x00FF;
-    if (get_v(reg_num) == value) {
-      pc.add(INSTRUCTION_LENGTH);
-    }
+  if (instruction.opcode == 0x00EE) {
+    op_00EE(instruction);
     return;
   }
-  if ((opcode & 0xF000) == 0x4000) {
-    int reg_num = (opcode & 0x0F00) >> 8;
-    int value = opcode & 0x00FF;
-    if (get_v(reg_num) != value) {
-      pc.add(INSTRUCTION_LENGTH);
-    }
+  op_unsupported(instruction);
+}
+
+void Chip8Machine::op_00E0(const DecodedInstruction &) {
+  clear_screen();
+}
+
+void Chip8Machine::op_00EE(const DecodedInstruction &instruction) {
+  if (state.sp == 0) {
+    raise_fault(Fault::STACK_UNDERFLOW, state.pc - INSTRUCTION_LENGTH,
+                instruction.opcode);
     return;
   }
-  if ((opcode & 0xF000) == 0x6000) {
-    int reg_num = (opcode & 0x0F00) >> 8;
-    // In principle, the else condition should never trigger, since there
-    // If invalid register specified, should be considered a bad opcode
-    if (reg_num < v_register.size()) {
-      v_register[reg_num].set(opcode & 0x00FF);
-      return;
-    }
-  }
-  if ((opcode & 0xF000) == 0x7000) {
-    int reg_num = (opcode & 0x0F00) >> 8;
-    if (reg_num < v_register.size()) {
-      int value = opcode & 0x00FF;
-      value += v_register[reg_num].get();
-      v_register[reg_num].set(value & 0xFF);
-      return;
-    }
-  }
-  if ((opcode & 0xF000) == 0x8000) {
-    int reg_num_x = (opcode & 0x0F00) >> 8;
-    int reg_num_y = (opcode & 0x00F0) >> 4;
-    int value_x = v_register[reg_num_x].get();
-    int value_y = v_register[reg_num_y].get();
-    if ((opcode & 0x000F) == 0) {
-      v_register[reg_num_x].set(value_y);
-      return;
-    }
-    if ((opcode & 0x000F) == 2) {
-      v_register[reg_num_x].set(value_x & value_y);
-      return;
-    }
-    if ((opcode & 0x000F) == 4) {
-      REG_TYPE flag = 0;
-      if (value_x + value_y > 0xFF)  flag = 1;
-      REG_TYPE result = (value_x + value_y) & 0xFF;
-      v_register[reg_num_x].set(result);
-      v_register[0xF].set(flag);
-      return;
-    }
-    if ((opcode & 0x000F) == 5) {
-      REG_TYPE flag = 0;
-      if (value_x > value_y)  flag = 1;
-      REG_TYPE result = (value_x - value_y) & 0xFF;
-      v_register[reg_num_x].set(result);
-      v_register[0xF].set(flag);
-      return;
-    }
-  }
-  if ((opcode & 0xF000) == 0xA000) {
-    i_register.set(opcode & 0x0FFF);
+  state.sp -= 1;
+  state.pc = state.stack[state.sp];
+}
+
+void Chip8Machine::op_1NNN(const DecodedInstruction &instruction) {
+  state.pc = instruction.nnn;
+}
+
+void Chip8Machine::op_2NNN(const DecodedInstruction &instruction) {
+  if (state.sp == STACK_DEPTH) {
+    raise_fault(Fault::STACK_OVERFLOW, state.pc - INSTRUCTION_LENGTH,
+                instruction.opcode);
     return;
   }
-  if ((opcode & 0xF000) == 0xC000) {
-    int reg_num = (opcode & 0x0F00) >> 8;
-    int mask = opcode & 0x00FF;
-    int random_number = distribution(generator) & mask;
-    v_register[reg_num].set(random_number);
-    return;
+  state.stack[state.sp] = state.pc;
+  state.sp += 1;
+  state.pc = instruction.nnn;
+}
+
+void Chip8Machine::op_3XNN(const DecodedInstruction &instruction) {
+  if (state.v[instruction.x] == instruction.nn) {
+    state.pc += INSTRUCTION_LENGTH;
   }
-  if ((opcode & 0xF000) == 0xD000) {
-    int x_reg = (opcode & 0x0F00) >> 8;
-    int y_reg = (opcode & 0x00F0) >> 4;
-    int n_rows = opcode & 0x000F;
-    int x_offset = v_register[x_reg].get() % display_width;
-    int y_offset = v_register[y_reg].get() % display_height;
-    int address = i_register.get();
-    for (int y = y_offset; y < y_offset + n_rows; y++) {
-      if (y >= display_height) break;
-      MEM_TYPE byte_to_draw = ram.get_byte(address);
-      for (int x = 0; x < 8; x++) {
-        if (x + x_offset >= display_width) break;
-        PIXEL_TYPE current = display.get_pixel(x + x_offset, y);
-        PIXEL_TYPE bit_to_draw = (byte_to_draw >> (7 - x)) & 0x1;
-        PIXEL_TYPE new_value = current ^bit_to_draw;
-        display.set_pixel(x + x_offset, y, new_value);
-        if (current != 0x0 && new_value == 0x0) set_flag(0x1);
-      }
-      address += 1;
-    }
-    return;
+}
+
+void Chip8Machine::op_4XNN(const DecodedInstruction &instruction) {
+  if (state.v[instruction.x] != instruction.nn) {
+    state.pc += INSTRUCTION_LENGTH;
   }
-  if ((opcode & 0xF0FF) == 0xE0A1) {
-    std::cout << "Opcode 0xEXA1 not yet implemented!  Assuming button not pressed!" << std::endl;
-    // TODO(WPH):  Even this is not tested yet!
-    pc.add(INSTRUCTION_LENGTH);
-    return;
+}
+
+void Chip8Machine::op_6XNN(const DecodedInstruction &instruction) {
+  state.v[instruction.x] = instruction.nn;
+}
+
+void Chip8Machine::op_7XNN(const DecodedInstruction &instruction) {
+  int value = instruction.nn + state.v[instruction.x];
+  state.v[instruction.x] = value & 0xFF;
+}
+
+void Chip8Machine::op_8XYN(const DecodedInstruction &instruction) {
+  (this->*handlers->arithmetic[instruction.n])(instruction);
+}
+
+void Chip8Machine::op_8XY0(const DecodedInstruction &instruction) {
+  state.v[instruction.x] = state.v[instruction.y];
+}
+
+template <class Quirks>
+void Chip8Machine::op_8XY1(const DecodedInstruction &instruction) {
+  int value_x = state.v[instruction.x];
+  int value_y = state.v[instruction.y];
+  state.v[instruction.x] = value_x | value_y;
+  if (Quirks::LOGIC_RESETS_VF) state.v[0xF] = 0;
+}
+
+template <class Quirks>
+void Chip8Machine::op_8XY2(const DecodedInstruction &instruction) {
+  int value_x = state.v[instruction.x];
+  int value_y = state.v[instruction.y];
+  state.v[instruction.x] = value_x & value_y;
+  if (Quirks::LOGIC_RESETS_VF) state.v[0xF] = 0;
+}
+
+template <class Quirks>
+void Chip8Machine::op_8XY3(const DecodedInstruction &instruction) {
+  int value_x = state.v[instruction.x];
+  int value_y = state.v[instruction.y];
+  state.v[instruction.x] = value_x ^ value_y;
+  if (Quirks::LOGIC_RESETS_VF) state.v[0xF] = 0;
+}
+
+void Chip8Machine::op_8XY4(const DecodedInstruction &instruction) {
+  int value_x = state.v[instruction.x];
+  int value_y = state.v[instruction.y];
+  REG_TYPE flag = 0;
+  if (value_x + value_y > 0xFF)  flag = 1;
+  REG_TYPE result = (value_x + value_y) & 0xFF;
+  state.v[instruction.x] = result;
+  state.v[0xF] = flag;
+}
+
+void Chip8Machine::op_8XY5(const DecodedInstruction &instruction) {
+  int value_x = state.v[instruction.x];
+  int value_y = state.v[instruction.y];
+  REG_TYPE flag = 0;
+  if (value_x > value_y)  flag = 1;
+  REG_TYPE result = (value_x - value_y) & 0xFF;
+  state.v[instruction.x] = result;
+  state.v[0xF] = flag;
+}
+
+template <class Quirks>
+void Chip8Machine::op_8XY6(const DecodedInstruction &instruction) {
+  int source = Quirks::SHIFT_USES_VY ? instruction.y : instruction.x;
+  int value = state.v[source];
+  state.v[instruction.x] = (value >> 1) & 0xFF;
+  state.v[0xF] = value & 0x1;
+}
+
+void Chip8Machine::op_8XY7(const DecodedInstruction &instruction) {
+  int value_x = state.v[instruction.x];
+  int value_y = state.v[instruction.y];
+  REG_TYPE flag = 0;
+  if (value_y > value_x)  flag = 1;
+  REG_TYPE result = (value_y - value_x) & 0xFF;
+  state.v[instruction.x] = result;
+  state.v[0xF] = flag;
+}
+
+template <class Quirks>
+void Chip8Machine::op_8XYE(const DecodedInstruction &instruction) {
+  int source = Quirks::SHIFT_USES_VY ? instruction.y : instruction.x;
+  int value = state.v[source];
+  state.v[instruction.x] = (value << 1) & 0xFF;
+  state.v[0xF] = (value >> 7) & 0x1;
+}
+
+void Chip8Machine::op_ANNN(const DecodedInstruction &instruction) {
+  state.i = instruction.nnn;
+}
+
+template <class Quirks>
+void Chip8Machine::op_BNNN(const DecodedInstruction &instruction) {
+  int offset_reg = Quirks::JUMP_USES_VX ? instruction.x : 0x0;
+  state.pc = instruction.nnn + state.v[offset_reg];
+}
+
+void Chip8Machine::op_CXNN(const DecodedInstruction &instruction) {
+  int random_number = next_random_byte() & instruction.nn;
+  state.v[instruction.x] = random_number;
+}
+
+template <class Quirks>
+void Chip8Machine::op_DXYN(const DecodedInstruction &instruction) {
+  int n_rows = instruction.n;
+  int x_offset = state.v[instruction.x] % display_width;
+  int y_offset = state.v[instruction.y] % display_height;
+  int address = state.i;
+  for (int row = y_offset; row < y_offset + n_rows; row++) {
+    if (row >= display_height && !Quirks::WRAP_SPRITES) break;
+    uint64_t &line = state.screen[row % display_height];
+    uint64_t bits = get_sprite_row_bits(get_memory_byte(address), x_offset,
+                                        display_width, Quirks::WRAP_SPRITES);
+    if ((line & bits) != 0) state.v[0xF] = 0x1;
+    if (bits != 0) mark_rows_dirty(uint64_t{1} << (row % display_height));
+    line ^= bits;
+    address += 1;
   }
-  if ((opcode & 0xF0FF) == 0xF015) {
-    int reg_num = (opcode & 0x0F00) >> 8;
-    set_delay_timer(get_v(reg_num));
-    return;
+}
+
+void Chip8Machine::op_EXNN(const DecodedInstruction &instruction) {
+  (this->*handlers->key[instruction.nn])(instruction);
+}
+
+void Chip8Machine::op_EX9E(const DecodedInstruction &instruction) {
+  if (keys.test(state.v[instruction.x] & 0xF)) {
+    state.pc += INSTRUCTION_LENGTH;
   }
-  if ((opcode & 0xF0FF) == 0xF018) {
-    std::cout << "Opcode 0xFX18 not yet implemented!  Leaving sound timer untouched!" << std::endl;
-    return;
+}
+
+void Chip8Machine::op_EXA1(const DecodedInstruction &instruction) {
+  if (!keys.test(state.v[instruction.x] & 0xF)) {
+    state.pc += INSTRUCTION_LENGTH;
   }
-  if ((opcode & 0xF0FF) == 0xF007) {
-    int reg_num = (opcode & 0x0F00) >> 8;
-    set_v(reg_num, get_delay_timer());
+}
+
+void Chip8Machine::op_FXNN(const DecodedInstruction &instruction) {
+  (this->*handlers->misc[instruction.nn])(instruction);
+}
+
+void Chip8Machine::op_FX07(const DecodedInstruction &instruction) {
+  state.v[instruction.x] = get_delay_timer();
+}
+
+void Chip8Machine::op_FX0A(const DecodedInstruction &instruction) {
+  waiting_for_key = keys.none();
+  if (waiting_for_key) {
+    // Execute this instruction again until a key is pressed
+    state.pc -= INSTRUCTION_LENGTH;
     return;
   }
-  if ((opcode & 0xF0FF) == 0xF029) {
-    // TODO(WPH):  Based on my reading of this instruction and my
-    //             hand disassembly of the PONG2 ROM, this
-    //             instruction should just be "load contents of VX
-    //             into I register"
-    //             The way that all the online sources reference it,
-    //             though, I'm not sure if I'm doing something wrong...
-    int reg_num = (opcode & 0x0F00) >> 8;
-    set_i(get_v(reg_num));
-    return;
+  int key = 0;
+  while (!keys.test(key)) key++;
+  state.v[instruction.x] = key;
+}
+
+void Chip8Machine::op_FX15(const DecodedInstruction &instruction) {
+  set_delay_timer(state.v[instruction.x]);
+}
+
+void Chip8Machine::op_FX18(const DecodedInstruction &instruction) {
+  set_sound_timer(state.v[instruction.x]);
+}
+
+void Chip8Machine::op_FX29(const DecodedInstruction &instruction) {
+  // TODO(WPH):  Based on my reading of this instruction and my
+  //             hand disassembly of the PONG2 ROM, this
+  //             instruction should just be "load contents of VX
+  //             into I register"
+  //             The way that all the online sources reference it,
+  //             though, I'm not sure if I'm doing something wrong...
+  set_i(state.v[instruction.x]);
+}
+
+void Chip8Machine::op_FX33(const DecodedInstruction &instruction) {
+  int value = state.v[instruction.x];
+  int decimal_one = value % 10;
+  int decimal_ten = (value / 10) % 10;
+  int decimal_hundred = (value / 100) % 10;
+
+  ADDR_TYPE addr = get_i();
+  set_memory_byte(addr, decimal_hundred);
+  set_memory_byte(addr+1, decimal_ten);
+  set_memory_byte(addr+2, decimal_one);
+}
+
+template <class Quirks>
+void Chip8Machine::op_FX55(const DecodedInstruction &instruction) {
+  ADDR_TYPE addr = get_i();
+  for (int i = 0; i <= instruction.x; i++) {
+    set_memory_byte(addr + i, state.v[i]);
   }
-  if ((opcode & 0xF0FF) == 0xF033) {
-    int reg_num = (opcode & 0x0F00) >> 8;
-    int value = get_v(reg_num);
-    int decimal_one = value % 10;
-    int decimal_ten = (value / 10) % 10;
-    int decimal_hundred = (value / 100) % 10;
-
-    ADDR_TYPE addr = get_i();
-    set_memory_byte(addr, decimal_hundred);
-    set_memory_byte(addr+1, decimal_ten);
-    set_memory_byte(addr+2, decimal_one);
-    return;
+  if (Quirks::LOAD_STORE_INCREMENTS_I) set_i(addr + instruction.x + 1);
+}
+
+template <class Quirks>
+void Chip8Machine::op_FX65(const DecodedInstruction &instruction) {
+  ADDR_TYPE addr = get_i();
+  for (int i = 0; i <= instruction.x; i++) {
+    state.v[i] = get_memory_byte(addr + i);
   }
-  if ((opcode & 0xF0FF) == 0xF065) {
-    // TODO(WPH):  The behavior where the I register is left alone is
-    //             implemented, add support for incrementing I register
-    int reg_num = (opcode & 0x0F00) >> 8;
-    ADDR_TYPE addr = get_i();
-    for (int i = 0; i <= reg_num; i++) {
-      set_v(i, get_memory_byte(addr + i));
+  if (Quirks::LOAD_STORE_INCREMENTS_I) set_i(addr + instruction.x + 1);
+}
+
+/// \brief Execute a fixed number of instructions with a threaded interpreter
+///
+/// Each handler jumps straight to the handler of the next instruction instead
+/// of returning to a dispatch loop.  Requires labels as values;  with other
+/// compilers, this is equivalent to calling advance() repeatedly.
+///
+/// \param n_instructions Number of instructions to execute
+/// \throw OpcodeNotSupported if an unsupported instruction is reached
+void Chip8Machine::run(const int n_instructions) {
+#ifdef CHIP8_ENABLE_PROFILER
+  if (profiler) {
+    for (int i = 0; i < n_instructions && fault.code == Fault::NONE; i++) {
+      step();
     }
+    throw_if_faulted();
     return;
   }
-  throw OpcodeNotSupported(opcode);
+#endif
+  (this->*handlers->run_threaded)(n_instructions);
+  throw_if_faulted();
+}
+
+template <class Quirks>
+void Chip8Machine::run_threaded(int n_instructions) {
+#ifdef CHIP8_THREADED_INTERPRETER
+#define CHIP8_HANDLER_LABEL(name) &&execute_##name,
+  static void *const labels[] = {
+      CHIP8_RESOLVED_HANDLERS(CHIP8_HANDLER_LABEL, CHIP8_HANDLER_LABEL)
+  };
+#undef CHIP8_HANDLER_LABEL
+
+  DecodedInstruction *instruction;
+  ADDR_TYPE address;
+
+  // Instructions at odd addresses are not cached, see advance()
+#define CHIP8_DISPATCH() \
+  if (--n_instructions < 0 || fault.code != Fault::NONE) return; \
+  address = state.pc; \
+  if ((address % INSTRUCTION_LENGTH) != 0 || address + 1 >= memory_size) { \
+    step(); \
+    goto dispatch; \
+  } \
+  instruction = &instruction_cache[address / INSTRUCTION_LENGTH]; \
+  if (instruction->handler == nullptr) { \
+    *instruction = predecode(fetch_instruction()); \
+  } \
+  state.pc += INSTRUCTION_LENGTH; \
+  goto *labels[instruction->handler_index]
+
+dispatch:
+  CHIP8_DISPATCH();
+
+#define CHIP8_HANDLER_BODY(name) \
+  execute_##name: \
+  op_##name(*instruction); \
+  CHIP8_DISPATCH();
+#define CHIP8_QUIRK_HANDLER_BODY(name) \
+  execute_##name: \
+  op_##name<Quirks>(*instruction); \
+  CHIP8_DISPATCH();
+
+  CHIP8_RESOLVED_HANDLERS(CHIP8_HANDLER_BODY, CHIP8_QUIRK_HANDLER_BODY)
+#undef CHIP8_QUIRK_HANDLER_BODY
+#undef CHIP8_HANDLER_BODY
+#undef CHIP8_DISPATCH
+#else
+  for (int i = 0; i < n_instructions && fault.code == Fault::NONE; i++) {
+    step();
+  }
+#endif
 }
 
 }  // namespace Emulator
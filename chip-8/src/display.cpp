@@ -1,25 +1,36 @@
 #include "display.hpp"
 
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
 namespace Emulator {
 
 /// \brief Create screen with fixed height and width
 /// \param height_ Height of screen (in number of pixels)
-/// \param width_ Width of screen (in number of pixels)
+/// \param width_ Width of screen (in number of pixels), at most
+///        MAX_ROW_WIDTH
 /// \param off_pixel_ Default value for pixels
-Display::Display(int height_, int width_, PIXEL_TYPE off_pixel_)
-    : height(height_), width(width_), off_pixel(off_pixel_) {
-  screen = std::vector<std::vector<PIXEL_TYPE> >(
-      height,
-      std::vector<PIXEL_TYPE>(width));
-  clear();
+/// \param on_pixel_ Value of pixels which are "on"
+/// \throw std::invalid_argument if the screen is too wide
+Display::Display(int height_, int width_, PIXEL_TYPE off_pixel_,
+                 PIXEL_TYPE on_pixel_)
+    : height(height_), width(width_), off_pixel(off_pixel_),
+      on_pixel(on_pixel_), rows(height_, 0) {
+  if (width > MAX_ROW_WIDTH) {
+    throw std::invalid_argument("Display wider than "
+                                + std::to_string(MAX_ROW_WIDTH)
+                                + " pixels");
+  }
 }
 
 /// \brief Get the value of the pixel located at (x, y) position
 /// \param x Horizontal position of pixel, where 0 corresponds to left edge
 /// \param y Vertical position of pixel, where 0 corresponds to upper edge
 /// \return Value of the pixel located at (x,y) position
-const PIXEL_TYPE &Display::get_pixel(const int x, const int y) const {
-  return screen[y][x];
+PIXEL_TYPE Display::get_pixel(const int x, const int y) const {
+  bool on = (rows[y] >> (MAX_ROW_WIDTH - 1 - x)) & 0x1;
+  return on ? on_pixel : off_pixel;
 }
 
 /// \brief Set the value of the pixel located at (x, y) position
@@ -27,25 +38,67 @@ const PIXEL_TYPE &Display::get_pixel(const int x, const int y) const {
 /// \param y Vertical position of pixel, where 0 corresponds to upper edge
 /// \param value Value to change pixel to
 void Display::set_pixel(const int x, const int y, const PIXEL_TYPE value) {
-  screen[y][x] = value;
+  uint64_t mask = uint64_t{1} << (MAX_ROW_WIDTH - 1 - x);
+  if (value == off_pixel) {
+    rows[y] &= ~mask;
+  } else {
+    rows[y] |= mask;
+  }
+}
+
+/// \brief Flip the pixels of a row set in one row of a sprite
+/// \param x Column of the leftmost pixel of the sprite, less than width
+/// \param y Row to draw on
+/// \param byte Row of the sprite, the leftmost pixel being the most
+///        significant bit
+/// \param wrap Whether pixels past the right edge wrap around to the left
+///        edge, instead of being clipped
+/// \return Whether a pixel was turned off
+bool Display::draw_sprite_row(const int x, const int y, const MEM_TYPE byte,
+                              const bool wrap) {
+  uint64_t bits = get_sprite_row_bits(byte, x, width, wrap);
+  bool collision = (rows[y] & bits) != 0;
+  rows[y] ^= bits;
+  return collision;
+}
+
+/// \brief Return a row of pixels, packed as by get_rows()
+/// \param y Row to return, where 0 corresponds to upper edge
+/// \return Pixels of the row, the leftmost being the most significant bit
+uint64_t Display::get_row(const int y) const {
+  return rows[y];
+}
+
+/// \brief Return every row of pixels
+///
+/// Each row is a word, the leftmost pixel being the most significant bit.
+/// Bits past the width of the display are always zero.
+///
+/// \return Rows of pixels, from top to bottom
+const std::vector<uint64_t> &Display::get_rows() const {
+  return rows;
+}
+
+/// \brief Replace every row of pixels
+/// \param new_rows Rows of pixels, packed as by get_rows();  pixels past the
+///        width of the display are ignored
+void Display::set_rows(const std::vector<uint64_t> &new_rows) {
+  uint64_t mask = ~uint64_t{0} << (MAX_ROW_WIDTH - width);
+  for (int y = 0; y < height; y++) rows[y] = new_rows[y] & mask;
 }
 
 /// \brief Reset the display to its default state
 void Display::clear() {
-  for (auto &row : screen) {
-    for (PIXEL_TYPE &pixel : row) {
-      pixel = off_pixel;
-    }
-  }
+  std::fill(rows.begin(), rows.end(), 0);
 }
 
 /// \brief Return the contents of the display as an ASCII representation
 /// \return Contents of the display as an ASCII representation
 Display::operator std::string() const {
   std::stringstream stream;
-  for (auto &row : screen) {
-    for (const PIXEL_TYPE &pixel : row) {
-      if (pixel == off_pixel) {
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      if (get_pixel(x, y) == off_pixel) {
         stream << " ";
       } else {
         stream << "X";
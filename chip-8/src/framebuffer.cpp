@@ -0,0 +1,98 @@
+#include "framebuffer.hpp"
+
+namespace Emulator {
+
+namespace {
+size_t round_up_to_cache_line(const size_t size) {
+  return (size + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+}
+}  // namespace
+
+/// \brief Create an empty frame buffer, see set_geometry()
+FrameBuffer::FrameBuffer()
+    : width(0), height(0), bytes_per_pixel(0), pitch(0),
+      buffers{nullptr, nullptr}, stale_rows{0, 0}, back(0) {}
+
+/// \brief Size both buffers for frames of the given geometry
+///
+/// Nothing is done when the geometry is unchanged.  Otherwise, both buffers
+/// are allocated again, cleared, and every row is marked changed.
+///
+/// \param new_width Width of a frame (in number of pixels)
+/// \param new_height Height of a frame (in number of lines)
+/// \param new_bytes_per_pixel Size of a pixel
+/// \return Whether the buffers were allocated again
+bool FrameBuffer::set_geometry(const int new_width, const int new_height,
+                               const int new_bytes_per_pixel) {
+  if (storage && new_width == width && new_height == height
+      && new_bytes_per_pixel == bytes_per_pixel) {
+    return false;
+  }
+  width = new_width;
+  height = new_height;
+  bytes_per_pixel = new_bytes_per_pixel;
+  pitch = round_up_to_cache_line(width * bytes_per_pixel);
+  size_t buffer_size = pitch * height;
+  // new[] only guarantees the alignment of fundamental types
+  storage.reset(new unsigned char[2 * buffer_size + CACHE_LINE_SIZE]());
+  uintptr_t address = reinterpret_cast<uintptr_t>(storage.get());
+  unsigned char *aligned = storage.get()
+      + (round_up_to_cache_line(address) - address);
+  buffers[0] = aligned;
+  buffers[1] = aligned + buffer_size;
+  back = 0;
+  mark_rows_changed(~uint64_t{0});
+  return true;
+}
+
+/// \brief Mark rows of the display as changed, in both buffers
+/// \param rows Changed rows, bit y standing for row y
+void FrameBuffer::mark_rows_changed(const uint64_t rows) {
+  stale_rows[0] |= rows;
+  stale_rows[1] |= rows;
+}
+
+/// \brief Return the rows of the display to draw again into the back buffer
+/// \return Rows changed since the back buffer was last presented, bit y
+///         standing for row y
+uint64_t FrameBuffer::get_stale_rows() const {
+  return stale_rows[back];
+}
+
+/// \brief Return the buffer to draw the next frame into
+/// \return Back buffer, of get_height() lines of get_pitch() bytes
+void *FrameBuffer::get_back_buffer() {
+  return buffers[back];
+}
+
+/// \brief Return the last frame presented
+/// \return Front buffer, of get_height() lines of get_pitch() bytes
+const void *FrameBuffer::get_front_buffer() const {
+  return buffers[1 - back];
+}
+
+/// \brief Make the back buffer, now up to date, the front buffer
+void FrameBuffer::present() {
+  stale_rows[back] = 0;
+  back = 1 - back;
+}
+
+/// \brief Return the width of a frame
+/// \return Width of a frame (in number of pixels)
+int FrameBuffer::get_width() const {
+  return width;
+}
+
+/// \brief Return the height of a frame
+/// \return Height of a frame (in number of lines)
+int FrameBuffer::get_height() const {
+  return height;
+}
+
+/// \brief Return the distance between the starts of two lines
+/// \return Pitch (in bytes), a multiple of CACHE_LINE_SIZE
+size_t FrameBuffer::get_pitch() const {
+  return pitch;
+}
+
+}  // namespace Emulator
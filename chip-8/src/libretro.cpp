@@ -3,9 +3,12 @@
 #pragma clang diagnostic push
 #pragma ide diagnostic ignored "UnusedParameter"
 #pragma ide diagnostic ignored "OCUnusedGlobalDeclarationInspection"
-static const short MAX_AUDIO_VALUE = 32767;
 static retro_video_refresh_t video_cb;
 static retro_audio_sample_t audio_cb;
+static retro_audio_sample_batch_t audio_batch_cb;
+static retro_environment_t environ_cb;
+// Whether video_cb accepts a NULL frame, to present the previous one again
+static bool can_dupe = false;
 
 // Creation of a singleton for libretro purposes, but allowing for a
 // backend that's TDD friendly
@@ -17,7 +20,6 @@ static Emulator::Chip8Machine &get_instance() {
 RETRO_API void retro_init(void) {
   Emulator::Chip8Machine *instance = &get_instance();
   chip8machine_init(*instance);
-  instance->start_timers();
 }
 
 RETRO_API void retro_deinit(void) {
@@ -41,7 +43,91 @@ RETRO_API void retro_get_system_av_info(struct retro_system_av_info *info) {
   chip8machine_get_system_av_info(info, *instance);
 }
 
-RETRO_API void retro_set_environment(retro_environment_t environment) {}
+// Core options;  the first value of each is the default
+static const char SCALE_OPTION[] = "chip8_scale";
+static const char PIXEL_FORMAT_OPTION[] = "chip8_pixel_format";
+static const char PALETTE_OPTION[] = "chip8_palette";
+static const char INSTRUCTIONS_OPTION[] = "chip8_instructions_per_frame";
+static const struct retro_variable CORE_OPTIONS[] = {
+    {SCALE_OPTION, "Scale; 8|1|2|3|4|5|6|7|9|10"},
+    {PIXEL_FORMAT_OPTION, "Pixel format (restart); RGB565|XRGB8888"},
+    {PALETTE_OPTION,
+     "Palette; white on black|black on white|green on black|amber on black"},
+    {INSTRUCTIONS_OPTION,
+     "Instructions per frame; 10|5|8|12|15|20|30|50|100|200|500|1000"},
+    {nullptr, nullptr}};
+
+struct NamedPalette {
+  const char *name;
+  Emulator::Palette palette;
+};
+
+static const NamedPalette PALETTES[] = {
+    {"white on black", Emulator::DEFAULT_PALETTE},
+    {"black on white", {0xFFFFFF, 0x000000}},
+    {"green on black", {0x000000, 0x33FF66}},
+    {"amber on black", {0x000000, 0xFFB000}}};
+
+// Value of a core option, or nullptr if the frontend has none
+static const char *get_core_option(const char *key) {
+  struct retro_variable variable = {key, nullptr};
+  if (!environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &variable)) return nullptr;
+  return variable.value;
+}
+
+// Configure the upscaler and the speed of the machine from the core
+// options.  The pixel format is only read when a game is loaded, as the
+// frontend may only change it then.
+static void apply_core_options(bool read_pixel_format) {
+  const Emulator::Upscaler &current = Emulator::chip8machine_get_upscaler();
+  int scale = current.x_scale;
+  Emulator::PixelFormat format = current.format;
+  Emulator::Palette palette = current.palette;
+
+  const char *value = get_core_option(SCALE_OPTION);
+  if (value != nullptr && std::atoi(value) > 0) scale = std::atoi(value);
+  value = get_core_option(PIXEL_FORMAT_OPTION);
+  if (read_pixel_format && value != nullptr) {
+    format = std::strcmp(value, "XRGB8888") == 0
+        ? Emulator::PixelFormat::XRGB8888 : Emulator::PixelFormat::RGB565;
+  }
+  value = get_core_option(PALETTE_OPTION);
+  for (const NamedPalette &named : PALETTES) {
+    if (value != nullptr && std::strcmp(value, named.name) == 0) {
+      palette = named.palette;
+    }
+  }
+  Emulator::chip8machine_set_upscaler(
+      Emulator::Upscaler(scale, scale, format, palette));
+
+  value = get_core_option(INSTRUCTIONS_OPTION);
+  if (value != nullptr && std::atoi(value) > 0) {
+    Emulator::chip8machine_set_instructions_per_frame(std::atoi(value));
+  }
+}
+
+// Ask the frontend for the pixel format of the upscaler, falling back to
+// XRGB8888 when it is refused
+static void negotiate_pixel_format() {
+  const Emulator::Upscaler &current = Emulator::chip8machine_get_upscaler();
+  enum retro_pixel_format format =
+      current.format == Emulator::PixelFormat::RGB565
+      ? RETRO_PIXEL_FORMAT_RGB565 : RETRO_PIXEL_FORMAT_XRGB8888;
+  if (environ_cb(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &format)) return;
+  Emulator::chip8machine_set_upscaler(
+      Emulator::Upscaler(current.x_scale, current.y_scale,
+                         Emulator::PixelFormat::XRGB8888, current.palette));
+  format = RETRO_PIXEL_FORMAT_XRGB8888;
+  environ_cb(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &format);
+}
+
+RETRO_API void retro_set_environment(retro_environment_t environment) {
+  environ_cb = environment;
+  environment(RETRO_ENVIRONMENT_SET_VARIABLES,
+              const_cast<retro_variable *>(CORE_OPTIONS));
+  bool dupe = false;
+  can_dupe = environment(RETRO_ENVIRONMENT_GET_CAN_DUPE, &dupe) && dupe;
+}
 RETRO_API void retro_set_video_refresh(retro_video_refresh_t videoRefresh) {
   video_cb = videoRefresh;
 }
@@ -54,101 +140,36 @@ RETRO_API void retro_set_audio_sample(retro_audio_sample_t audioSample) {
 #pragma clang diagnostic pop
 
 RETRO_API void retro_set_audio_sample_batch(
-    retro_audio_sample_batch_t audioSampleBatch) {}
+    retro_audio_sample_batch_t audioSampleBatch) {
+  audio_batch_cb = audioSampleBatch;
+}
 RETRO_API void retro_set_input_poll(retro_input_poll_t inputPoll) {}
 RETRO_API void retro_set_input_state(retro_input_state_t inputState) {}
 RETRO_API void retro_set_controller_port_device(
     unsigned port, unsigned device) {}
 
-void random_noise(retro_audio_sample_t my_audio_cb) {
-  // Shameless copy-paste from Google
-  // If this subroutine actually gets used, generator creation should be
-  // moved out of this subroutine
-  std::random_device rd;
-  std::mt19937 gen(rd());
-  std::uniform_int_distribution<short> distribution(0, MAX_AUDIO_VALUE);
-
-  // 735 iterations to reach 44.100 kHz sampling @ 60 fps
-  const int n_iterations = 735;
-  for (int j = 0; j < n_iterations; j++) {
-    my_audio_cb(distribution(gen), distribution(gen));
-  }
-}
-
-void square_wave(retro_audio_sample_t my_audio_cb) {
-  // 420 Hz Triangle wave (7 cycles per frame, 60 frames per second)
-  const int n_cycles_per_frame = 7;
-  // 105 iterations per cycle to reach 44.100 kHz sampling @ 60 fps
-  // @ 7 cycles per frame
-  const int n_iterations_per_cycle = 105;
-  // Corresponds to duty cycle of 50%
-  const int n_high_per_cycle = 52;
-
-  int n_low_per_cycle = n_iterations_per_cycle - n_high_per_cycle;
-  for (int j = 0; j < n_cycles_per_frame; j++) {
-    for (int i = 0; i < n_high_per_cycle; i++)
-      my_audio_cb(
-          MAX_AUDIO_VALUE, MAX_AUDIO_VALUE);
-    for (int i = 0; i < n_low_per_cycle; i++) my_audio_cb(0, 0);
-  }
-}
-
-#pragma clang diagnostic push
-#pragma ide diagnostic ignored "cppcoreguidelines-narrowing-conversions"
-void triangle_wave(retro_audio_sample_t my_audio_cb) {
-  // 420 Hz Triangle wave (7 cycles per frame, 60 frames per second)
-  const int n_cycles_per_frame = 7;
-  // 105 iterations per cycle to reach 44.100 kHz sampling @ 60 fps
-  // @ 7 cycles per frame
-  const int n_iterations_per_cycle = 105;
-  // Corresponds to duty cycle of 50%
-  const int n_rising_per_cycle = 52;
-  // For a max value of 32767, the closest
-  const short rising_increment = 630;
-  const short falling_increment = 628;
-
-  short n_falling_per_cycle = n_iterations_per_cycle - n_rising_per_cycle;
-  for (int j = 0; j < n_cycles_per_frame; j++) {
-    // 735 iterations per frame to reach 44.100 kHz sampling @ 60 fps
-    for (int i = 0; i < n_rising_per_cycle; i++)
-      my_audio_cb(
-          i * rising_increment, i * rising_increment);
-    for (int i = 0; i < n_falling_per_cycle; i++)
-      my_audio_cb(
-          MAX_AUDIO_VALUE - i * falling_increment,
-          MAX_AUDIO_VALUE - i * falling_increment);
-  }
-}
-#pragma clang diagnostic pop
-
-void sine_wave(retro_audio_sample_t my_audio_cb) {
-  // 420 Hz Triangle wave (7 cycles per frame, 60 frames per second)
-  const int n_cycles_per_frame = 7;
-  // 105 iterations per cycle to reach 44.100 kHz sampling @ 60 fps
-  // @ 7 cycles per frame
-  const int n_iterations_per_cycle = 105;
-
-  short signal;
-  double phase;
-  for (int j = 0; j < n_cycles_per_frame; j++) {
-    for (int i = 0; i < n_iterations_per_cycle; i++) {
-      phase = 2.0 * M_PI * i / n_iterations_per_cycle;
-      signal = static_cast<short>(
-          (1.0 * MAX_AUDIO_VALUE) * sin(phase) / 2.0);
-      my_audio_cb(signal, signal);
-      std::cout << signal << std::endl;
-    }
-  }
-}
-
 RETRO_API void retro_reset(void) {
   Emulator::Chip8Machine *instance = &get_instance();
   chip8machine_reset(*instance);
-  instance->kill_timers();
 }
 
 RETRO_API void retro_run(void) {
   Emulator::Chip8Machine *instance = &get_instance();
+  bool updated = false;
+  if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE_UPDATE, &updated)
+      && updated) {
+    int x_scale = Emulator::chip8machine_get_upscaler().x_scale;
+    int y_scale = Emulator::chip8machine_get_upscaler().y_scale;
+    apply_core_options(false);
+    // Only the scale changes the size of frames;  palette and speed changes
+    // need nothing from the frontend
+    const Emulator::Upscaler &changed = Emulator::chip8machine_get_upscaler();
+    if (changed.x_scale != x_scale || changed.y_scale != y_scale) {
+      struct retro_system_av_info info;
+      chip8machine_get_system_av_info(&info, *instance);
+      environ_cb(RETRO_ENVIRONMENT_SET_GEOMETRY, &info.geometry);
+    }
+  }
   chip8machine_run(*instance);
 }
 
@@ -168,6 +189,8 @@ RETRO_API void retro_cheat_set(unsigned index, bool enabled, const char *code) {
 
 RETRO_API bool retro_load_game(const struct retro_game_info *game) {
   Emulator::Chip8Machine *instance = &get_instance();
+  apply_core_options(true);
+  negotiate_pixel_format();
   return chip8machine_load_game(game, *instance);
 }
 RETRO_API bool retro_load_game_special(unsigned game_type,
@@ -191,6 +214,47 @@ RETRO_API size_t retro_get_memory_size(unsigned int id) {
 
 namespace Emulator {
 
+namespace {
+std::unique_ptr<Upscaler> upscaler(new Upscaler());
+// Changed along with the upscaler, so that frames are upscaled from scratch
+int upscaler_version = 0;
+
+Buzzer buzzer;
+
+// 600 instructions per second at 60 frames per second, roughly the speed of
+// the original interpreter
+const int DEFAULT_INSTRUCTIONS_PER_FRAME = 10;
+int instructions_per_frame = DEFAULT_INSTRUCTIONS_PER_FRAME;
+
+// Largest value of the chip8_scale core option:  frames may grow up to that
+// size without the frontend reinitializing its video driver
+const int MAX_SCALE = 10;
+
+// About three seconds at 60 frames per second
+const unsigned FAULT_MESSAGE_FRAMES = 180;
+
+const char *describe_fault(const Fault code) {
+  switch (code) {
+    case Fault::UNSUPPORTED_OPCODE: return "unsupported instruction";
+    case Fault::INVALID_REGISTER: return "invalid register";
+    case Fault::STACK_UNDERFLOW: return "return with an empty stack";
+    case Fault::STACK_OVERFLOW: return "call stack overflow";
+    default: return "no error";
+  }
+}
+
+// Tell the frontend why the game stopped, since the screen just freezes
+void report_fault(const FaultInfo &fault) {
+  if (fault.code == Fault::NONE || environ_cb == nullptr) return;
+  static char text[96];
+  snprintf(text, sizeof(text), "CHIP-8 stopped: %s %04X at %03X",
+           describe_fault(fault.code), static_cast<unsigned>(fault.opcode),
+           static_cast<unsigned>(fault.pc));
+  struct retro_message message = {text, FAULT_MESSAGE_FRAMES};
+  environ_cb(RETRO_ENVIRONMENT_SET_MESSAGE, &message);
+}
+}  // namespace
+
 RETRO_API void chip8machine_init(Chip8Machine &my_machine) {
   my_machine.reset();
 }
@@ -205,40 +269,92 @@ RETRO_API void chip8machine_get_system_av_info(
   memset(info, 0, sizeof(*info));
   int height = my_machine.display_height;
   int width = my_machine.display_width;
-  Upscaler upscaler;
+  const Upscaler &upscaler = chip8machine_get_upscaler();
   int x_scale = upscaler.x_scale;
   int y_scale = upscaler.y_scale;
 
   info->geometry.aspect_ratio = -1.0;  // Use default
   info->geometry.base_height = y_scale * height;
   info->geometry.base_width = x_scale * width;
-  info->geometry.max_height = y_scale * height;
-  info->geometry.max_width = x_scale * width;
+  info->geometry.max_height = std::max(y_scale, MAX_SCALE) * height;
+  info->geometry.max_width = std::max(x_scale, MAX_SCALE) * width;
   info->timing.fps = 60.0;
-  info->timing.sample_rate = 44100;
+  info->timing.sample_rate = buzzer.sample_rate;
 }
 
 RETRO_API void chip8machine_reset(Chip8Machine &my_machine) {
   my_machine.reset();
+  my_machine.clear_fault();
 }
 
 RETRO_API void chip8machine_run(Chip8Machine &my_machine, bool run_silent) {
-  // TODO(WPH):  Strong suspicion this will break the moment users try
-  //  to resize screen
-  Upscaler upscaler;
+  const Upscaler &upscaler = chip8machine_get_upscaler();
   int width = upscaler.x_scale * my_machine.display_width;
   int height = upscaler.y_scale * my_machine.display_height;
+  int bytes_per_pixel = upscaler.get_bytes_per_pixel();
+
+  // Frames are kept between calls, so that only the rows changed since a
+  // buffer was last drawn are upscaled again
+  static FrameBuffer frame_buffer;
+  static const Chip8Machine *rendered_machine = nullptr;
+  static int rendered_upscaler = -1;
+  uint64_t rows = 0;
+  if (frame_buffer.set_geometry(width, height, bytes_per_pixel)
+      || rendered_machine != &my_machine
+      || rendered_upscaler != upscaler_version) {
+    rendered_machine = &my_machine;
+    rendered_upscaler = upscaler_version;
+    rows = ALL_ROWS;
+  }
 
-  // TODO(WPH):  For now, each frame is one instruction
-  my_machine.advance();
+  // A frame is 1/60 s of emulated time:  the timers tick once at its end,
+  // however fast the frontend calls retro_run().  A fault stops the machine
+  // until it is reset or another game is loaded, so it is reported once.
+  bool was_faulted = my_machine.get_fault().code != Fault::NONE;
+  my_machine.run_frame(instructions_per_frame);
+  if (!run_silent && !was_faulted) report_fault(my_machine.get_fault());
+
+  if (!run_silent && audio_batch_cb != nullptr) {
+    const int16_t *samples =
+        buzzer.render_frame(my_machine.is_sound_playing());
+    audio_batch_cb(samples, buzzer.get_frames_per_video_frame());
+  }
 
-  unsigned short frame_buffer[height * width];
+  rows |= my_machine.get_dirty_rows();
+  my_machine.clear_dirty_rows();
+  frame_buffer.mark_rows_changed(rows);
 
-  upscaler.upscale(frame_buffer, width, my_machine);
+  if (!run_silent && rows == 0 && can_dupe) {
+    video_cb(nullptr, width, height, frame_buffer.get_pitch());
+    return;
+  }
 
+  // Frontend memory has unspecified contents, so every row is drawn into it
+  if (!run_silent && environ_cb != nullptr) {
+    struct retro_framebuffer frontend_buffer = {};
+    frontend_buffer.width = width;
+    frontend_buffer.height = height;
+    frontend_buffer.access_flags = RETRO_MEMORY_ACCESS_WRITE;
+    enum retro_pixel_format format = upscaler.format == PixelFormat::RGB565
+        ? RETRO_PIXEL_FORMAT_RGB565 : RETRO_PIXEL_FORMAT_XRGB8888;
+    if (environ_cb(RETRO_ENVIRONMENT_GET_CURRENT_SOFTWARE_FRAMEBUFFER,
+                   &frontend_buffer)
+        && frontend_buffer.data != nullptr
+        && frontend_buffer.format == format
+        && frontend_buffer.pitch % bytes_per_pixel == 0) {
+      upscaler.upscale(frontend_buffer.data,
+                       frontend_buffer.pitch / bytes_per_pixel, my_machine);
+      video_cb(frontend_buffer.data, width, height, frontend_buffer.pitch);
+      return;
+    }
+  }
+
+  int pitch = frame_buffer.get_pitch();
+  upscaler.upscale(frame_buffer.get_back_buffer(), pitch / bytes_per_pixel,
+                   my_machine, frame_buffer.get_stale_rows());
+  frame_buffer.present();
   if (!run_silent) {
-    video_cb(frame_buffer, width, height, sizeof(unsigned short) * width);
-    // sine_wave(audio_cb);
+    video_cb(frame_buffer.get_front_buffer(), width, height, pitch);
   }
 }
 
@@ -248,7 +364,9 @@ RETRO_API bool chip8machine_load_game(const struct retro_game_info *game,
   if (game->data == nullptr) return false;
   std::vector<unsigned char> rom =
       Memory::convert_bytestream_to_vector(game->data, game->size);
+  my_machine.set_quirks_profile(detect_quirks_profile(rom));
   my_machine.load_rom(rom);
+  my_machine.clear_fault();
   return true;
 }
 
@@ -263,6 +381,23 @@ RETRO_API size_t chip8machine_get_memory_size(unsigned int id,
   // return my_machine.memory_size;
 }
 
+RETRO_API const Upscaler &chip8machine_get_upscaler() {
+  return *upscaler;
+}
+
+RETRO_API void chip8machine_set_upscaler(const Upscaler &new_upscaler) {
+  upscaler.reset(new Upscaler(new_upscaler));
+  upscaler_version++;
+}
+
+RETRO_API int chip8machine_get_instructions_per_frame() {
+  return instructions_per_frame;
+}
+
+RETRO_API void chip8machine_set_instructions_per_frame(const int n) {
+  instructions_per_frame = n;
+}
+
 }  // namespace Emulator
 
 // CLion has a long-standing bug (3 years old...) about this being incorrectly
@@ -0,0 +1,894 @@
+#include "machinebatch.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "display.hpp"
+#include "vectordispatch.hpp"
+
+#ifdef CHIP8_VECTORS
+// Vectors are only passed between kernels inlined into each other, so the
+// calling convention of AVX vectors does not matter
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+namespace Emulator {
+
+namespace {
+// Machines are padded to a whole number of blocks, so that vector kernels
+// never handle partial blocks
+const size_t LANE_BLOCK = 32;
+
+// Instructions are fetched from the shared RAM image, unless the machine
+// wrote to the page holding them
+const int PAGE_SHIFT = 6;
+static_assert((RAM_SIZE >> PAGE_SHIFT) == 64,
+              "Dirty pages of a machine are tracked in one 64-bit word");
+
+// Vector kernels process every block between the first and last machine of
+// a group;  below this density, executing the group one machine at a time
+// is cheaper
+const size_t VECTOR_DENSITY = 16;
+
+// Groups formed per step before executing the remaining machines one at a
+// time, which bounds the cost of grouping when every machine diverged
+const int MAX_GROUPS_PER_STEP = 8;
+
+#ifdef CHIP8_VECTORS
+typedef uint8_t ByteBlock __attribute__((vector_size(LANE_BLOCK)));
+#else
+typedef uint8_t ByteBlock;
+#endif
+
+/// \enum ByteOp
+/// \brief Register-only operation applied to one byte of every machine
+enum class ByteOp {
+  LOAD,       // a = b
+  ADD,        // a + b
+  OR,         // a | b
+  AND,        // a & b
+  XOR,        // a ^ b
+  EQUAL,      // 1 if a == b, 0 otherwise
+  NOT_EQUAL,  // 1 if a != b, 0 otherwise
+  // Operations below also set a flag, as 8XYN sets VF
+  ADD_CARRY,  // a + b, flag set on carry
+  SUB,        // a - b, flag set if a > b
+  SUBN,       // b - a, flag set if b > a
+  SHR,        // a >> 1, flag set to the bit shifted out
+  SHL         // a << 1, flag set to the bit shifted out
+};
+
+constexpr bool sets_flag(const ByteOp op) { return op >= ByteOp::ADD_CARRY; }
+
+template <class Bytes>
+CHIP8_VECTOR_INLINE Bytes load_bytes(const uint8_t *source) {
+  Bytes bytes;
+  std::memcpy(&bytes, source, sizeof(bytes));
+  return bytes;
+}
+
+template <class Bytes>
+CHIP8_VECTOR_INLINE void store_bytes(uint8_t *destination, const Bytes bytes) {
+  std::memcpy(destination, &bytes, sizeof(bytes));
+}
+
+// Comparisons yield 0xFF/0x00 on vectors and true/false on scalars;  both
+// are reduced to 1/0
+template <ByteOp OP, class Bytes>
+CHIP8_VECTOR_INLINE Bytes byte_result(const Bytes a, const Bytes b) {
+  switch (OP) {
+    case ByteOp::LOAD:
+      return b;
+    case ByteOp::ADD:
+    case ByteOp::ADD_CARRY:
+      return a + b;
+    case ByteOp::OR:
+      return a | b;
+    case ByteOp::AND:
+      return a & b;
+    case ByteOp::XOR:
+      return a ^ b;
+    case ByteOp::EQUAL:
+      return (Bytes)(a == b) & 1;  // NOLINT(readability/casting)
+    case ByteOp::NOT_EQUAL:
+      return (Bytes)(a != b) & 1;  // NOLINT(readability/casting)
+    case ByteOp::SUB:
+      return a - b;
+    case ByteOp::SUBN:
+      return b - a;
+    case ByteOp::SHR:
+      return a >> 1;
+    case ByteOp::SHL:
+      return a << 1;
+  }
+  return a;
+}
+
+template <ByteOp OP, class Bytes>
+CHIP8_VECTOR_INLINE Bytes byte_flag(const Bytes a, const Bytes b) {
+  switch (OP) {
+    case ByteOp::ADD_CARRY: {
+      // The sum wraps around on carry
+      Bytes sum = a + b;
+      return (Bytes)(sum < a) & 1;  // NOLINT(readability/casting)
+    }
+    case ByteOp::SUB:
+      return (Bytes)(a > b) & 1;  // NOLINT(readability/casting)
+    case ByteOp::SUBN:
+      return (Bytes)(b > a) & 1;  // NOLINT(readability/casting)
+    case ByteOp::SHR:
+      return a & 1;
+    case ByteOp::SHL:
+      return a >> 7;
+    default:
+      return a & 0;
+  }
+}
+
+// destination = OP(a, b) and, for operations setting a flag,
+// flag = flag of OP(a, b), for the machines selected by mask only.  Every
+// operand is read before anything is written, so that operands may alias,
+// and the flag is written last, as VF is by 8XYN
+template <ByteOp OP, class Bytes>
+CHIP8_VECTOR_INLINE void apply_bytes(uint8_t *destination, uint8_t *flag,
+                                    const uint8_t *a, const uint8_t *b,
+                                    const uint8_t *mask,
+                                    const size_t n_lanes) {
+  for (size_t lane = 0; lane < n_lanes; lane += sizeof(Bytes)) {
+    Bytes value_a = load_bytes<Bytes>(a + lane);
+    Bytes value_b = load_bytes<Bytes>(b + lane);
+    Bytes selected = load_bytes<Bytes>(mask + lane);
+    Bytes result = byte_result<OP, Bytes>(value_a, value_b);
+    Bytes previous = load_bytes<Bytes>(destination + lane);
+    store_bytes<Bytes>(destination + lane,
+                       (result & selected) | (previous & ~selected));
+    if (sets_flag(OP)) {
+      Bytes flag_value = byte_flag<OP, Bytes>(value_a, value_b);
+      previous = load_bytes<Bytes>(flag + lane);
+      store_bytes<Bytes>(flag + lane,
+                         (flag_value & selected) | (previous & ~selected));
+    }
+  }
+}
+
+template <ByteOp OP>
+void apply_bytes_default(uint8_t *destination, uint8_t *flag,
+                         const uint8_t *a, const uint8_t *b,
+                         const uint8_t *mask, const size_t n_lanes) {
+  apply_bytes<OP, ByteBlock>(destination, flag, a, b, mask, n_lanes);
+}
+
+#ifdef CHIP8_VECTOR_AVX2
+template <ByteOp OP>
+__attribute__((target("avx2")))
+void apply_bytes_avx2(uint8_t *destination, uint8_t *flag,
+                      const uint8_t *a, const uint8_t *b,
+                      const uint8_t *mask, const size_t n_lanes) {
+  apply_bytes<OP, ByteBlock>(destination, flag, a, b, mask, n_lanes);
+}
+#endif
+
+template <ByteOp OP>
+void apply(uint8_t *destination, uint8_t *flag, const uint8_t *a,
+           const uint8_t *b, const uint8_t *mask, const size_t n_lanes) {
+#ifdef CHIP8_VECTOR_AVX2
+  if (has_avx2()) {
+    apply_bytes_avx2<OP>(destination, flag, a, b, mask, n_lanes);
+    return;
+  }
+#endif
+  apply_bytes_default<OP>(destination, flag, a, b, mask, n_lanes);
+}
+}  // namespace
+
+/// \brief Create a batch of identical machines
+///
+/// Every machine starts from the state of the prototype, and uses its quirk
+/// policy.  No key is pressed.
+///
+/// \param prototype Machine whose state is copied into every machine
+/// \param n_machines_ Number of machines in the batch
+MachineBatch::MachineBatch(const Chip8Machine &prototype,
+                           const size_t n_machines_)
+    : n_machines(n_machines_),
+      n_lanes((n_machines_ + LANE_BLOCK - 1) / LANE_BLOCK * LANE_BLOCK),
+      v(NUM_V_REGS * n_lanes, 0), i(n_lanes, 0), pc(n_lanes, 0),
+      sp(n_lanes, 0), delay_timer(n_lanes, 0), sound_timer(n_lanes, 0),
+      rng(n_lanes, 0), keys(n_lanes, 0), stack(STACK_DEPTH * n_lanes, 0),
+      screen(MAX_HEIGHT * n_lanes, 0), ram(n_machines_ * RAM_SIZE, 0),
+      shared_ram(prototype.get_state().ram), dirty_pages(n_lanes, 0),
+      status(n_lanes, RunStatus::HALTED),
+      faults(n_lanes, FaultInfo{Fault::NONE, 0, 0}), pending(n_lanes, 0),
+      group(n_lanes, 0), scratch(n_lanes, 0), vector_steps(0),
+      scalar_steps(0) {
+  for (size_t lane = 0; lane < n_machines; lane++) {
+    set_state(lane, prototype.get_state());
+  }
+  switch (prototype.get_quirks_profile()) {
+    case QuirksProfile::COSMAC_VIP:
+      run_policy = &MachineBatch::run_steps<CosmacVipQuirks>;
+      break;
+    case QuirksProfile::SUPER_CHIP:
+      run_policy = &MachineBatch::run_steps<SuperChipQuirks>;
+      break;
+    case QuirksProfile::XO_CHIP:
+      run_policy = &MachineBatch::run_steps<XoChipQuirks>;
+      break;
+    default:
+      run_policy = &MachineBatch::run_steps<DefaultQuirks>;
+      break;
+  }
+}
+
+/// \brief Name the vector instructions used by the register-only kernels
+/// \return "AVX2", "SSE2", "NEON", or "none" if kernels are scalar
+const char *MachineBatch::get_vector_extension() {
+  return Emulator::get_vector_extension();
+}
+
+/// \brief Return the number of machines in the batch
+/// \return Number of machines
+size_t MachineBatch::size() const {
+  return n_machines;
+}
+
+/// \brief Return the complete state of one machine
+///
+/// The cycle count of the frame is always zero, as the batch has no timing
+/// model
+///
+/// \param lane Machine to look up
+/// \return Registers, stack, timers, screen and RAM of the machine
+MachineState MachineBatch::get_state(const size_t lane) const {
+  MachineState state = MachineState();
+  for (int reg = 0; reg < NUM_V_REGS; reg++) {
+    state.v[reg] = v[reg * n_lanes + lane];
+  }
+  state.i = i[lane];
+  state.pc = pc[lane];
+  state.sp = sp[lane];
+  state.delay_timer = delay_timer[lane];
+  state.sound_timer = sound_timer[lane];
+  state.rng = rng[lane];
+  state.frame_cycles = 0;
+  for (int slot = 0; slot < STACK_DEPTH; slot++) {
+    state.stack[slot] = stack[slot * n_lanes + lane];
+  }
+  for (int row = 0; row < MAX_HEIGHT; row++) {
+    state.screen[row] = screen[row * n_lanes + lane];
+  }
+  std::copy(ram.begin() + lane * RAM_SIZE, ram.begin() + (lane + 1) * RAM_SIZE,
+            state.ram.begin());
+  return state;
+}
+
+/// \brief Replace the complete state of one machine
+///
+/// The machine resumes running, even if it had stopped
+///
+/// \param lane Machine to update
+/// \param state State to copy into the machine
+void MachineBatch::set_state(const size_t lane, const MachineState &state) {
+  for (int reg = 0; reg < NUM_V_REGS; reg++) {
+    v[reg * n_lanes + lane] = state.v[reg] & 0xFF;
+  }
+  i[lane] = state.i;
+  pc[lane] = state.pc;
+  sp[lane] = state.sp;
+  delay_timer[lane] = state.delay_timer;
+  sound_timer[lane] = state.sound_timer;
+  rng[lane] = state.rng;
+  for (int slot = 0; slot < STACK_DEPTH; slot++) {
+    stack[slot * n_lanes + lane] = state.stack[slot];
+  }
+  for (int row = 0; row < MAX_HEIGHT; row++) {
+    screen[row * n_lanes + lane] = state.screen[row];
+  }
+  std::copy(state.ram.begin(), state.ram.end(),
+            ram.begin() + lane * RAM_SIZE);
+
+  const size_t page_size = 1 << PAGE_SHIFT;
+  dirty_pages[lane] = 0;
+  for (int page = 0; page < (RAM_SIZE >> PAGE_SHIFT); page++) {
+    if (std::memcmp(&state.ram[page * page_size],
+                    &shared_ram[page * page_size], page_size) != 0) {
+      dirty_pages[lane] |= uint64_t{1} << page;
+    }
+  }
+  status[lane] = RunStatus::OK;
+  faults[lane] = FaultInfo{Fault::NONE, 0, 0};
+}
+
+/// \brief Seed the random number generator of one machine
+///
+/// Machines seeded alike draw the same numbers, as Chip8Machine::set_seed()
+///
+/// \param lane Machine to seed
+/// \param seed Seed for the generator
+void MachineBatch::set_seed(const size_t lane, const int seed) {
+  rng[lane] = static_cast<uint32_t>(seed) ^ 0x9E3779B9u;
+  if (rng[lane] == 0) rng[lane] = 0x9E3779B9u;
+}
+
+/// \brief Update the state of a key on the keypad of one machine
+/// \param lane Machine to update
+/// \param key Key to update, from 0x0 to 0xF
+/// \param pressed Whether the key is held down
+void MachineBatch::set_key(const size_t lane, const int key,
+                           const bool pressed) {
+  uint16_t bit = static_cast<uint16_t>(1 << (key & 0xF));
+  if (pressed) {
+    keys[lane] |= bit;
+  } else {
+    keys[lane] &= ~bit;
+  }
+}
+
+/// \brief Return the value of a pixel on the screen of one machine
+/// \param lane Machine to look up
+/// \param x Column of the pixel
+/// \param y Row of the pixel
+/// \return Value of the pixel
+PIXEL_TYPE MachineBatch::get_pixel(const size_t lane, const int x,
+                                   const int y) const {
+  return (screen[y * n_lanes + lane] >> (MAX_WIDTH - 1 - x)) & 0x1;
+}
+
+/// \brief Execute instructions on every running machine
+///
+/// Machines stop, and execute nothing more, when their program counter runs
+/// off the end of RAM or an instruction faults (see get_status()).
+///
+/// \param n_steps Number of instructions to execute on each machine
+/// \return Number of instructions executed, all machines included
+uint64_t MachineBatch::run(const int n_steps) {
+  return (this->*run_policy)(n_steps);
+}
+
+/// \brief Decrement the delay and sound timers of every machine, as done
+///        60 times a second
+void MachineBatch::tick_60hz() {
+  for (size_t lane = 0; lane < n_lanes; lane++) {
+    if (delay_timer[lane] > 0) delay_timer[lane] -= 1;
+    if (sound_timer[lane] > 0) sound_timer[lane] -= 1;
+  }
+}
+
+/// \brief Return whether a machine is still running
+/// \param lane Machine to look up
+/// \return RunStatus::OK if running, otherwise why the machine stopped
+RunStatus MachineBatch::get_status(const size_t lane) const {
+  return status[lane];
+}
+
+/// \brief Return the error which stopped a machine
+/// \param lane Machine to look up
+/// \return Fault status, whose code is Fault::NONE if no error occurred
+const FaultInfo &MachineBatch::get_fault(const size_t lane) const {
+  return faults[lane];
+}
+
+/// \brief Return the number of instructions executed by vector kernels
+/// \return Instructions executed for a whole group at once
+uint64_t MachineBatch::get_vector_steps() const {
+  return vector_steps;
+}
+
+/// \brief Return the number of instructions executed one machine at a time
+/// \return Instructions executed by the scalar fallback
+uint64_t MachineBatch::get_scalar_steps() const {
+  return scalar_steps;
+}
+
+template <class Quirks>
+uint64_t MachineBatch::run_steps(const int n_steps) {
+  // Byte stores may alias anything, including the internals of vectors;
+  // raw pointers let the compiler keep them in registers
+  uint8_t *waiting = pending.data();
+  uint8_t *members = group.data();
+  const uint16_t *addresses = pc.data();
+  const RunStatus *statuses = status.data();
+  const size_t lanes = n_lanes;
+
+  uint64_t n_executed = 0;
+  for (int step = 0; step < n_steps; step++) {
+    size_t n_pending = 0;
+    for (size_t lane = 0; lane < lanes; lane++) {
+      waiting[lane] = statuses[lane] == RunStatus::OK ? 0xFF : 0x00;
+      n_pending += waiting[lane] & 0x1;
+    }
+    if (n_pending == 0) break;
+
+    // Machines about to execute the instruction of the first pending machine
+    // form a group, until every machine is part of a group.  The passes over
+    // the masks are simple enough for the compiler to vectorize.
+    size_t first = 0;
+    for (int n_groups = 0; n_pending > 0; n_groups++) {
+      while (pending[first] == 0) first++;
+      size_t begin = first / LANE_BLOCK * LANE_BLOCK;
+      if (n_groups == MAX_GROUPS_PER_STEP) {
+        for (size_t lane = first; lane < n_machines; lane++) {
+          if (pending[lane] == 0) continue;
+          if (pc[lane] + 1 >= RAM_SIZE) {
+            status[lane] = RunStatus::HALTED;
+            continue;
+          }
+          execute_lane<Quirks>(lane,
+                               DecodedInstruction(fetch_instruction(lane)));
+          scalar_steps += 1;
+          n_executed += 1;
+        }
+        break;
+      }
+
+      uint16_t address = pc[first];
+      std::fill(members, members + begin, 0);
+      for (size_t lane = begin; lane < lanes; lane++) {
+        members[lane] = waiting[lane] & (addresses[lane] == address ? 0xFF : 0);
+      }
+      // Machines which wrote over their copy of the code may execute
+      // something else at the same address.  The leader may be one of them,
+      // so once any member has dirty code, every member is compared with it.
+      OPCODE_TYPE opcode = fetch_instruction(first);
+      uint64_t code_pages = (uint64_t{1} << (address >> PAGE_SHIFT))
+          | (uint64_t{1} << (((address + 1) & (RAM_SIZE - 1)) >> PAGE_SHIFT));
+      const uint64_t *dirty = dirty_pages.data();
+      uint64_t dirty_code = 0;
+      for (size_t lane = begin; lane < lanes; lane++) {
+        dirty_code |= dirty[lane] & (0u - uint64_t{members[lane] & 0x1u});
+      }
+      if ((dirty_code & code_pages) != 0) {
+        for (size_t lane = begin; lane < lanes; lane++) {
+          if (members[lane] != 0 && fetch_instruction(lane) != opcode) {
+            members[lane] = 0x00;
+          }
+        }
+      }
+      size_t n_members = 0;
+      for (size_t lane = begin; lane < lanes; lane++) {
+        n_members += members[lane] & 0x1;
+        waiting[lane] &= ~members[lane];
+      }
+      n_pending -= n_members;
+      size_t last = lanes - 1;
+      while (group[last] == 0) last--;
+      size_t end = (last / LANE_BLOCK + 1) * LANE_BLOCK;
+
+      if (address + 1 >= RAM_SIZE) {
+        for (size_t lane = begin; lane < end; lane++) {
+          if (group[lane] != 0) status[lane] = RunStatus::HALTED;
+        }
+        continue;
+      }
+      n_executed += n_members;
+      DecodedInstruction instruction(opcode);
+      if (n_members * VECTOR_DENSITY >= end - begin
+          && execute_group<Quirks>(instruction, begin, end)) {
+        vector_steps += n_members;
+        continue;
+      }
+      for (size_t lane = first; lane <= last; lane++) {
+        if (group[lane] != 0) execute_lane<Quirks>(lane, instruction);
+      }
+      scalar_steps += n_members;
+    }
+  }
+  return n_executed;
+}
+
+/// \brief Execute a register-only instruction on a group of machines
+///
+/// Machines of the group are marked in the group mask, and lie between
+/// machines begin and end (both multiples of LANE_BLOCK)
+///
+/// \param instruction Instruction every machine of the group executes
+/// \param begin First machine which may be part of the group
+/// \param end One past the last machine which may be part of the group
+/// \return False, executing nothing, if the instruction has no vector kernel
+template <class Quirks>
+bool MachineBatch::execute_group(const DecodedInstruction &instruction,
+                                 const size_t begin, const size_t end) {
+  uint8_t *value_x = &v[instruction.x * n_lanes + begin];
+  uint8_t *value_y = &v[instruction.y * n_lanes + begin];
+  uint8_t *flag = &v[0xF * n_lanes + begin];
+  uint8_t *operand = &scratch[begin];
+  const uint8_t *mask = &group[begin];
+  const size_t count = end - begin;
+  const uint8_t *skips = nullptr;
+  // Raw pointers, which byte stores cannot alias, let loops vectorize
+  uint16_t *addresses = pc.data();
+  uint16_t *index = i.data();
+  uint32_t *seeds = rng.data();
+  const uint8_t *members = group.data();
+
+  switch (instruction.opcode >> 12) {
+    case 0x1:
+      for (size_t lane = begin; lane < end; lane++) {
+        if (members[lane] != 0) addresses[lane] = instruction.nnn;
+      }
+      return true;
+    case 0x3:
+      std::fill(operand, operand + count, instruction.nn);
+      apply<ByteOp::EQUAL>(operand, nullptr, value_x, operand, mask, count);
+      skips = operand;
+      break;
+    case 0x4:
+      std::fill(operand, operand + count, instruction.nn);
+      apply<ByteOp::NOT_EQUAL>(operand, nullptr, value_x, operand, mask,
+                               count);
+      skips = operand;
+      break;
+    case 0x6:
+      std::fill(operand, operand + count, instruction.nn);
+      apply<ByteOp::LOAD>(value_x, nullptr, value_x, operand, mask, count);
+      break;
+    case 0x7:
+      std::fill(operand, operand + count, instruction.nn);
+      apply<ByteOp::ADD>(value_x, nullptr, value_x, operand, mask, count);
+      break;
+    case 0x8: {
+      uint8_t *source = Quirks::SHIFT_USES_VY ? value_y : value_x;
+      switch (instruction.n) {
+        case 0x0:
+          apply<ByteOp::LOAD>(value_x, nullptr, value_x, value_y, mask,
+                              count);
+          break;
+        case 0x1:
+          apply<ByteOp::OR>(value_x, nullptr, value_x, value_y, mask, count);
+          break;
+        case 0x2:
+          apply<ByteOp::AND>(value_x, nullptr, value_x, value_y, mask, count);
+          break;
+        case 0x3:
+          apply<ByteOp::XOR>(value_x, nullptr, value_x, value_y, mask, count);
+          break;
+        case 0x4:
+          apply<ByteOp::ADD_CARRY>(value_x, flag, value_x, value_y, mask,
+                                   count);
+          break;
+        case 0x5:
+          apply<ByteOp::SUB>(value_x, flag, value_x, value_y, mask, count);
+          break;
+        case 0x6:
+          apply<ByteOp::SHR>(value_x, flag, source, source, mask, count);
+          break;
+        case 0x7:
+          apply<ByteOp::SUBN>(value_x, flag, value_x, value_y, mask, count);
+          break;
+        case 0xE:
+          apply<ByteOp::SHL>(value_x, flag, source, source, mask, count);
+          break;
+        default:
+          return false;
+      }
+      if (Quirks::LOGIC_RESETS_VF && instruction.n >= 0x1
+          && instruction.n <= 0x3) {
+        std::fill(operand, operand + count, 0);
+        apply<ByteOp::LOAD>(flag, nullptr, flag, operand, mask, count);
+      }
+      break;
+    }
+    case 0xA:
+      for (size_t lane = begin; lane < end; lane++) {
+        if (members[lane] != 0) index[lane] = instruction.nnn;
+      }
+      break;
+    case 0xC:
+      // Same as next_random_byte(), without branches
+      for (size_t lane = begin; lane < end; lane++) {
+        uint32_t selected = 0u - (members[lane] & 0x1u);
+        uint32_t value = seeds[lane];
+        value ^= value << 13;
+        value ^= value >> 17;
+        value ^= value << 5;
+        seeds[lane] = (value & selected) | (seeds[lane] & ~selected);
+        uint8_t random = (value >> 24) & instruction.nn;
+        value_x[lane - begin] = (random & members[lane])
+            | (value_x[lane - begin] & ~members[lane]);
+      }
+      break;
+    case 0xF: {
+      uint8_t *delay = &delay_timer[begin];
+      switch (instruction.nn) {
+        case 0x07:
+          apply<ByteOp::LOAD>(value_x, nullptr, value_x, delay, mask, count);
+          break;
+        case 0x15:
+          apply<ByteOp::LOAD>(delay, nullptr, delay, value_x, mask, count);
+          break;
+        case 0x18:
+          apply<ByteOp::LOAD>(&sound_timer[begin], nullptr,
+                              &sound_timer[begin], value_x, mask, count);
+          break;
+        case 0x29:
+          for (size_t lane = begin; lane < end; lane++) {
+            if (members[lane] != 0) index[lane] = value_x[lane - begin];
+          }
+          break;
+        default:
+          return false;
+      }
+      break;
+    }
+    default:
+      return false;
+  }
+  advance_group_pc(skips, begin, end);
+  return true;
+}
+
+/// \brief Execute an instruction on one machine
+///
+/// Same as the handlers of Chip8Machine, on the arrays of the batch
+///
+/// \param lane Machine executing the instruction
+/// \param instruction Instruction at the program counter of the machine
+template <class Quirks>
+void MachineBatch::execute_lane(const size_t lane,
+                                const DecodedInstruction &instruction) {
+  const uint16_t address = pc[lane];
+  pc[lane] += INSTRUCTION_LENGTH;
+  uint8_t &value_x = v[instruction.x * n_lanes + lane];
+  uint8_t &value_y = v[instruction.y * n_lanes + lane];
+  uint8_t &flag = v[0xF * n_lanes + lane];
+  int x = value_x;
+  int y = value_y;
+
+  switch (instruction.opcode >> 12) {
+    case 0x0:
+      if (instruction.opcode == 0x00E0) {
+        for (int row = 0; row < MAX_HEIGHT; row++) {
+          screen[row * n_lanes + lane] = 0;
+        }
+        return;
+      }
+      if (instruction.opcode == 0x00EE) {
+        if (sp[lane] == 0) {
+          stop_lane(lane, RunStatus::FAULTED, Fault::STACK_UNDERFLOW, address,
+                    instruction.opcode);
+          return;
+        }
+        sp[lane] -= 1;
+        pc[lane] = stack[sp[lane] * n_lanes + lane];
+        return;
+      }
+      break;
+    case 0x1:
+      pc[lane] = instruction.nnn;
+      return;
+    case 0x2:
+      if (sp[lane] == STACK_DEPTH) {
+        stop_lane(lane, RunStatus::FAULTED, Fault::STACK_OVERFLOW, address,
+                  instruction.opcode);
+        return;
+      }
+      stack[sp[lane] * n_lanes + lane] = pc[lane];
+      sp[lane] += 1;
+      pc[lane] = instruction.nnn;
+      return;
+    case 0x3:
+      if (x == instruction.nn) pc[lane] += INSTRUCTION_LENGTH;
+      return;
+    case 0x4:
+      if (x != instruction.nn) pc[lane] += INSTRUCTION_LENGTH;
+      return;
+    case 0x6:
+      value_x = instruction.nn;
+      return;
+    case 0x7:
+      value_x = (x + instruction.nn) & 0xFF;
+      return;
+    case 0x8: {
+      int source = Quirks::SHIFT_USES_VY ? y : x;
+      switch (instruction.n) {
+        case 0x0:
+          value_x = y;
+          return;
+        case 0x1:
+          value_x = x | y;
+          if (Quirks::LOGIC_RESETS_VF) flag = 0;
+          return;
+        case 0x2:
+          value_x = x & y;
+          if (Quirks::LOGIC_RESETS_VF) flag = 0;
+          return;
+        case 0x3:
+          value_x = x ^ y;
+          if (Quirks::LOGIC_RESETS_VF) flag = 0;
+          return;
+        case 0x4:
+          value_x = (x + y) & 0xFF;
+          flag = x + y > 0xFF ? 1 : 0;
+          return;
+        case 0x5:
+          value_x = (x - y) & 0xFF;
+          flag = x > y ? 1 : 0;
+          return;
+        case 0x6:
+          value_x = (source >> 1) & 0xFF;
+          flag = source & 0x1;
+          return;
+        case 0x7:
+          value_x = (y - x) & 0xFF;
+          flag = y > x ? 1 : 0;
+          return;
+        case 0xE:
+          value_x = (source << 1) & 0xFF;
+          flag = (source >> 7) & 0x1;
+          return;
+        default:
+          break;
+      }
+      break;
+    }
+    case 0xA:
+      i[lane] = instruction.nnn;
+      return;
+    case 0xB: {
+      int offset_reg = Quirks::JUMP_USES_VX ? instruction.x : 0x0;
+      pc[lane] = instruction.nnn + v[offset_reg * n_lanes + lane];
+      return;
+    }
+    case 0xC:
+      value_x = next_random_byte(lane) & instruction.nn;
+      return;
+    case 0xD:
+      draw_sprite<Quirks>(lane, instruction);
+      return;
+    case 0xE: {
+      bool pressed = (keys[lane] >> (x & 0xF)) & 0x1;
+      if (instruction.nn == 0x9E) {
+        if (pressed) pc[lane] += INSTRUCTION_LENGTH;
+        return;
+      }
+      if (instruction.nn == 0xA1) {
+        if (!pressed) pc[lane] += INSTRUCTION_LENGTH;
+        return;
+      }
+      break;
+    }
+    case 0xF:
+      switch (instruction.nn) {
+        case 0x07:
+          value_x = delay_timer[lane];
+          return;
+        case 0x0A: {
+          if (keys[lane] == 0) {
+            // Execute this instruction again until a key is pressed
+            pc[lane] = address;
+            return;
+          }
+          int key = 0;
+          while (((keys[lane] >> key) & 0x1) == 0) key++;
+          value_x = key;
+          return;
+        }
+        case 0x15:
+          delay_timer[lane] = x;
+          return;
+        case 0x18:
+          sound_timer[lane] = x;
+          return;
+        case 0x29:
+          i[lane] = x;
+          return;
+        case 0x33:
+          write_memory(lane, i[lane], (x / 100) % 10);
+          write_memory(lane, i[lane] + 1, (x / 10) % 10);
+          write_memory(lane, i[lane] + 2, x % 10);
+          return;
+        case 0x55:
+        case 0x65: {
+          ADDR_TYPE first = i[lane];
+          for (int reg = 0; reg <= instruction.x; reg++) {
+            uint8_t &value = v[reg * n_lanes + lane];
+            if (instruction.nn == 0x55) {
+              write_memory(lane, first + reg, value);
+            } else {
+              value = read_memory(lane, first + reg);
+            }
+          }
+          if (Quirks::LOAD_STORE_INCREMENTS_I) {
+            i[lane] = first + instruction.x + 1;
+          }
+          return;
+        }
+        default:
+          break;
+      }
+      break;
+    default:
+      break;
+  }
+  // Unsupported instructions are not executed
+  pc[lane] = address;
+  stop_lane(lane, RunStatus::UNSUPPORTED_OPCODE, Fault::UNSUPPORTED_OPCODE,
+            address, instruction.opcode);
+}
+
+/// \brief Execute DXYN on one machine, a whole sprite row at a time
+/// \param lane Machine executing the instruction
+/// \param instruction DXYN instruction
+template <class Quirks>
+void MachineBatch::draw_sprite(const size_t lane,
+                               const DecodedInstruction &instruction) {
+  int x_offset = v[instruction.x * n_lanes + lane] % MAX_WIDTH;
+  int y_offset = v[instruction.y * n_lanes + lane] % MAX_HEIGHT;
+  ADDR_TYPE address = i[lane];
+  uint8_t &flag = v[0xF * n_lanes + lane];
+  for (int row = y_offset; row < y_offset + instruction.n; row++) {
+    if (row >= MAX_HEIGHT && !Quirks::WRAP_SPRITES) break;
+    uint64_t bits = get_sprite_row_bits(read_memory(lane, address), x_offset,
+                                        MAX_WIDTH, Quirks::WRAP_SPRITES);
+    uint64_t &line = screen[(row % MAX_HEIGHT) * n_lanes + lane];
+    if ((line & bits) != 0) flag = 0x1;
+    line ^= bits;
+    address += 1;
+  }
+}
+
+OPCODE_TYPE MachineBatch::fetch_instruction(const size_t lane) const {
+  ADDR_TYPE address = pc[lane];
+  uint64_t pages = (uint64_t{1} << (address >> PAGE_SHIFT))
+      | (uint64_t{1} << (((address + 1) & (RAM_SIZE - 1)) >> PAGE_SHIFT));
+  if ((dirty_pages[lane] & pages) == 0) {
+    return (shared_ram[address] << 8)
+        + shared_ram[(address + 1) & (RAM_SIZE - 1)];
+  }
+  return (read_memory(lane, address) << 8) + read_memory(lane, address + 1);
+}
+
+MEM_TYPE MachineBatch::read_memory(const size_t lane,
+                                   const ADDR_TYPE address) const {
+  return ram[lane * RAM_SIZE + (address & (RAM_SIZE - 1))];
+}
+
+void MachineBatch::write_memory(const size_t lane, ADDR_TYPE address,
+                                const MEM_TYPE value) {
+  address &= RAM_SIZE - 1;
+  ram[lane * RAM_SIZE + address] = value;
+  dirty_pages[lane] |= uint64_t{1} << (address >> PAGE_SHIFT);
+}
+
+/// \brief Advance the xorshift32 generator of one machine, as
+///        Chip8Machine::next_random_byte()
+/// \param lane Machine drawing a number
+/// \return Random value between 0 and MAX_RANDOM_NUMBER
+uint8_t MachineBatch::next_random_byte(const size_t lane) {
+  uint32_t value = rng[lane];
+  value ^= value << 13;
+  value ^= value >> 17;
+  value ^= value << 5;
+  rng[lane] = value;
+  return (value >> 24) & MAX_RANDOM_NUMBER;
+}
+
+/// \brief Move the machines of the group past the current instruction
+/// \param skips 1 for each machine skipping the next instruction, nullptr if
+///              none does;  indexed from begin
+/// \param begin First machine which may be part of the group
+/// \param end One past the last machine which may be part of the group
+void MachineBatch::advance_group_pc(const uint8_t *skips, const size_t begin,
+                                    const size_t end) {
+  uint16_t *addresses = pc.data();
+  const uint8_t *members = group.data();
+  if (skips == nullptr) {
+    for (size_t lane = begin; lane < end; lane++) {
+      addresses[lane] += members[lane] & INSTRUCTION_LENGTH;
+    }
+    return;
+  }
+  for (size_t lane = begin; lane < end; lane++) {
+    int length = (1 + skips[lane - begin]) * INSTRUCTION_LENGTH;
+    addresses[lane] += members[lane] & length;
+  }
+}
+
+void MachineBatch::stop_lane(const size_t lane, const RunStatus reason,
+                             const Fault code, const ADDR_TYPE address,
+                             const OPCODE_TYPE opcode) {
+  status[lane] = reason;
+  faults[lane] = FaultInfo{code, address, opcode};
+}
+
+}  // namespace Emulator
@@ -0,0 +1,189 @@
+#include "machinefarm.hpp"
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+
+#include "machinestate.hpp"
+
+namespace Emulator {
+
+/// \brief Start the worker threads
+/// \param n_workers Number of worker threads, 0 for one per hardware thread
+MachineFarm::MachineFarm(size_t n_workers)
+    : n_queued(0), n_unfinished(0), first_job(0), next_worker(0),
+      stopping(false) {
+  if (n_workers == 0) n_workers = std::thread::hardware_concurrency();
+  if (n_workers == 0) n_workers = 1;
+  for (size_t index = 0; index < n_workers; index++) {
+    workers.emplace_back(new Worker());
+    workers.back()->jobs = 0;
+    workers.back()->stolen = 0;
+    workers.back()->cycles = 0;
+    workers.back()->busy_nanoseconds = 0;
+  }
+  for (size_t index = 0; index < n_workers; index++) {
+    threads.emplace_back(&MachineFarm::work, this, index);
+  }
+}
+
+/// \brief Stop the worker threads, once every submitted job has run
+MachineFarm::~MachineFarm() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  job_queued.notify_all();
+  for (std::thread &thread : threads) thread.join();
+}
+
+/// \brief Return the number of worker threads
+/// \return Number of worker threads
+size_t MachineFarm::get_n_workers() const {
+  return workers.size();
+}
+
+/// \brief Queue a job, to be run by the first available worker
+/// \param job Job to run
+/// \return Number of the job, counting from zero since the last wait()
+size_t MachineFarm::submit(FarmJob job) {
+  size_t number;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    number = results.size();
+    results.emplace_back();
+    n_unfinished += 1;
+  }
+  Worker &worker = *workers[next_worker];
+  next_worker = (next_worker + 1) % workers.size();
+  {
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    worker.queue.emplace_back(first_job + number, std::move(job));
+  }
+  {
+    // Workers check n_queued under the lock before sleeping
+    std::lock_guard<std::mutex> lock(mutex);
+    n_queued += 1;
+  }
+  job_queued.notify_one();
+  return number;
+}
+
+/// \brief Wait for every submitted job to finish
+/// \return Results of the jobs submitted since the last wait(), in
+///         submission order
+std::vector<FarmResult> MachineFarm::wait() {
+  std::unique_lock<std::mutex> lock(mutex);
+  jobs_finished.wait(lock, [this] { return n_unfinished == 0; });
+  std::vector<FarmResult> finished;
+  finished.swap(results);
+  first_job += finished.size();
+  return finished;
+}
+
+/// \brief Return the throughput counters of every worker
+///
+/// Counters accumulate over the lifetime of the farm, and may be read while
+/// jobs are running
+///
+/// \return Counters, by worker
+std::vector<WorkerStats> MachineFarm::get_worker_stats() const {
+  std::vector<WorkerStats> stats;
+  for (const std::unique_ptr<Worker> &worker : workers) {
+    stats.push_back({worker->jobs, worker->stolen, worker->cycles,
+                     worker->busy_nanoseconds});
+  }
+  return stats;
+}
+
+/// \brief Run a job to completion on the calling thread
+///
+/// Key events are applied at the start of their frame.  The machine stops
+/// early when the program halts (see RunStatus::HALTED) or faults;  it goes
+/// on while FX0A waits for a key, as the input script may press one.
+///
+/// \param job Job to run
+/// \return Final state of the machine;  the job number is left at zero
+FarmResult MachineFarm::run_job(const FarmJob &job) {
+  Chip8Machine machine(job.quirks);
+  machine.reset();
+  machine.load_rom(job.rom);
+  machine.set_seed(job.seed);
+  machine.set_recompiler(true);
+
+  FarmResult result = FarmResult();
+  result.status = RunStatus::OK;
+  size_t next_input = 0;
+  for (uint64_t frame = 0; result.cycles < job.cycle_budget; frame++) {
+    while (next_input < job.inputs.size()
+           && job.inputs[next_input].frame <= frame) {
+      machine.set_key(job.inputs[next_input].key,
+                      job.inputs[next_input].pressed);
+      next_input += 1;
+    }
+    int n_cycles = static_cast<int>(std::min<uint64_t>(
+        job.instructions_per_frame, job.cycle_budget - result.cycles));
+    result.status = machine.run_frame(n_cycles);
+    result.cycles += n_cycles;
+    if (result.status == RunStatus::HALTED
+        || result.status == RunStatus::UNSUPPORTED_OPCODE
+        || result.status == RunStatus::FAULTED) {
+      break;
+    }
+  }
+
+  result.fault = machine.get_fault();
+  result.state_hash = hash_state(machine.get_state());
+  result.screen = machine.get_state().screen;
+  return result;
+}
+
+void MachineFarm::work(const size_t index) {
+  Worker &worker = *workers[index];
+  std::pair<size_t, FarmJob> job;
+  while (true) {
+    if (!take_job(index, &job)) {
+      std::unique_lock<std::mutex> lock(mutex);
+      job_queued.wait(lock, [this] { return stopping || n_queued > 0; });
+      if (n_queued == 0) return;
+      continue;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    FarmResult result = run_job(job.second);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    worker.jobs += 1;
+    worker.cycles += result.cycles;
+    worker.busy_nanoseconds +=
+        std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    result.job = job.first - first_job;
+    results[result.job] = result;
+    n_unfinished -= 1;
+    if (n_unfinished == 0) jobs_finished.notify_all();
+  }
+}
+
+// Own queue first, newest job first;  then the oldest job of the other
+// queues, starting with the next worker so that thieves spread out
+bool MachineFarm::take_job(const size_t index,
+                           std::pair<size_t, FarmJob> *job) {
+  for (size_t offset = 0; offset < workers.size(); offset++) {
+    Worker &victim = *workers[(index + offset) % workers.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (victim.queue.empty()) continue;
+    if (offset == 0) {
+      *job = std::move(victim.queue.back());
+      victim.queue.pop_back();
+    } else {
+      *job = std::move(victim.queue.front());
+      victim.queue.pop_front();
+      workers[index]->stolen += 1;
+    }
+    n_queued -= 1;
+    return true;
+  }
+  return false;
+}
+
+}  // namespace Emulator
@@ -0,0 +1,46 @@
+#include "machinestate.hpp"
+
+namespace Emulator {
+
+namespace {
+// 64-bit FNV-1a
+const uint64_t FNV_OFFSET_BASIS = 0xCBF29CE484222325u;
+const uint64_t FNV_PRIME = 0x100000001B3u;
+
+void hash_bytes(uint64_t *hash, const void *data, const size_t size) {
+  const unsigned char *bytes = static_cast<const unsigned char *>(data);
+  for (size_t index = 0; index < size; index++) {
+    *hash = (*hash ^ bytes[index]) * FNV_PRIME;
+  }
+}
+
+template <class T>
+void hash_value(uint64_t *hash, const T &value) {
+  hash_bytes(hash, &value, sizeof(value));
+}
+}  // namespace
+
+/// \brief Summarize the architectural state of a machine in one word
+///
+/// Fields are hashed one by one, so that padding never changes the result.
+/// The cycle count of the frame is left out, as it depends on the timing
+/// model rather than on the program.
+///
+/// \param state State to hash
+/// \return 64-bit FNV-1a hash of registers, stack, timers, screen and RAM
+uint64_t hash_state(const MachineState &state) {
+  uint64_t hash = FNV_OFFSET_BASIS;
+  hash_value(&hash, state.v);
+  hash_value(&hash, state.i);
+  hash_value(&hash, state.pc);
+  hash_value(&hash, state.sp);
+  hash_value(&hash, state.delay_timer);
+  hash_value(&hash, state.sound_timer);
+  hash_value(&hash, state.rng);
+  hash_value(&hash, state.stack);
+  hash_value(&hash, state.screen);
+  hash_value(&hash, state.ram);
+  return hash;
+}
+
+}  // namespace Emulator
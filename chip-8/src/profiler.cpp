@@ -0,0 +1,220 @@
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+namespace Emulator {
+
+namespace {
+double percentage(const uint64_t part, const uint64_t total) {
+  if (total == 0) return 0.0;
+  return 100.0 * static_cast<double>(part) / static_cast<double>(total);
+}
+
+std::string address_to_hex_str(const ADDR_TYPE address) {
+  std::stringstream stream;
+  stream << "0x" << std::hex << std::uppercase << std::setw(3)
+         << std::setfill('0') << address;
+  return stream.str();
+}
+}  // namespace
+
+/// \brief Create an empty profile
+/// \param class_names_ Name of every instruction class, by class number
+Profiler::Profiler(const std::vector<std::string> &class_names_)
+    : class_names(class_names_), class_executions(class_names_.size(), 0),
+      class_nanoseconds(class_names_.size(), 0), address_executions(),
+      previous_address(0), previous_is_jump(false) {
+  for (const std::string &name : class_names) {
+    is_jump.push_back(name == "1NNN" || name == "BNNN");
+  }
+}
+
+/// \brief Whether Chip8Machine was built with the profiling hooks
+/// \return True if the build was configured with CHIP8_ENABLE_PROFILER
+bool Profiler::is_enabled() {
+#ifdef CHIP8_ENABLE_PROFILER
+  return true;
+#else
+  return false;
+#endif
+}
+
+/// \brief Account for one executed instruction
+///
+/// Instructions must be recorded in execution order, for loops to be found
+///
+/// \param opcode_class Class number of the instruction
+/// \param address Address of the instruction
+/// \param nanoseconds Host time spent executing it
+void Profiler::record(const uint8_t opcode_class, ADDR_TYPE address,
+                      const uint64_t nanoseconds) {
+  address &= RAM_SIZE - 1;
+  if (previous_is_jump && address <= previous_address) {
+    backward_jumps[(address << 16) | previous_address] += 1;
+  }
+  class_executions[opcode_class] += 1;
+  class_nanoseconds[opcode_class] += nanoseconds;
+  address_executions[address] += 1;
+  previous_address = address;
+  previous_is_jump = is_jump[opcode_class];
+}
+
+/// \brief Forget everything recorded so far
+void Profiler::clear() {
+  std::fill(class_executions.begin(), class_executions.end(), 0);
+  std::fill(class_nanoseconds.begin(), class_nanoseconds.end(), 0);
+  address_executions.fill(0);
+  backward_jumps.clear();
+  previous_address = 0;
+  previous_is_jump = false;
+}
+
+/// \brief Return the number of instructions recorded
+/// \return Number of instructions recorded
+uint64_t Profiler::get_total_executions() const {
+  uint64_t total = 0;
+  for (uint64_t executions : class_executions) total += executions;
+  return total;
+}
+
+/// \brief Return the instruction classes executed, most executed first
+/// \return Totals of every class executed at least once
+std::vector<Profiler::ClassStats> Profiler::get_classes() const {
+  std::vector<ClassStats> classes;
+  for (size_t index = 0; index < class_names.size(); index++) {
+    if (class_executions[index] == 0) continue;
+    classes.push_back({class_names[index], class_executions[index],
+                       class_nanoseconds[index]});
+  }
+  std::stable_sort(classes.begin(), classes.end(),
+                   [](const ClassStats &a, const ClassStats &b) {
+                     return a.executions > b.executions;
+                   });
+  return classes;
+}
+
+/// \brief Return the most executed guest addresses, most executed first
+/// \param n_addresses Maximum number of addresses to return
+/// \return Totals of the hottest addresses
+std::vector<Profiler::AddressStats> Profiler::get_hottest_addresses(
+    const size_t n_addresses) const {
+  std::vector<AddressStats> addresses;
+  for (ADDR_TYPE address = 0; address < RAM_SIZE; address++) {
+    if (address_executions[address] == 0) continue;
+    addresses.push_back({address, address_executions[address]});
+  }
+  std::stable_sort(addresses.begin(), addresses.end(),
+                   [](const AddressStats &a, const AddressStats &b) {
+                     return a.executions > b.executions;
+                   });
+  if (addresses.size() > n_addresses) addresses.resize(n_addresses);
+  return addresses;
+}
+
+/// \brief Return the loops which executed the most instructions
+/// \param n_loops Maximum number of loops to return
+/// \return Totals of the hottest loops
+std::vector<Profiler::LoopStats> Profiler::get_hottest_loops(
+    const size_t n_loops) const {
+  std::vector<LoopStats> loops;
+  for (const auto &entry : backward_jumps) {
+    LoopStats loop{entry.first >> 16, entry.first & 0xFFFF, entry.second, 0};
+    for (ADDR_TYPE address = loop.start; address <= loop.end; address++) {
+      loop.executions += address_executions[address];
+    }
+    loops.push_back(loop);
+  }
+  std::sort(loops.begin(), loops.end(),
+            [](const LoopStats &a, const LoopStats &b) {
+              if (a.executions != b.executions) {
+                return a.executions > b.executions;
+              }
+              return a.start < b.start;
+            });
+  if (loops.size() > n_loops) loops.resize(n_loops);
+  return loops;
+}
+
+/// \brief Print a human-readable summary, hottest entries first
+/// \param stream Stream to print to
+/// \param n_entries Number of addresses and loops to list
+void Profiler::write_report(std::ostream &stream,
+                            const size_t n_entries) const {
+  uint64_t total = get_total_executions();
+  stream << "Instructions executed: " << total << std::endl;
+
+  stream << std::endl << "Instruction classes:" << std::endl;
+  stream << std::left << std::setw(12) << "class" << std::right
+         << std::setw(14) << "executions" << std::setw(9) << "%"
+         << std::setw(16) << "host ns" << std::setw(10) << "ns/instr"
+         << std::endl;
+  for (const ClassStats &current : get_classes()) {
+    stream << std::left << std::setw(12) << current.name << std::right
+           << std::setw(14) << current.executions
+           << std::setw(8) << std::fixed << std::setprecision(2)
+           << percentage(current.executions, total) << "%"
+           << std::setw(16) << current.nanoseconds
+           << std::setw(10) << std::setprecision(1)
+           << static_cast<double>(current.nanoseconds) / current.executions
+           << std::endl;
+  }
+
+  stream << std::endl << "Hottest addresses:" << std::endl;
+  for (const AddressStats &current : get_hottest_addresses(n_entries)) {
+    stream << std::left << std::setw(12) << address_to_hex_str(current.address)
+           << std::right << std::setw(14) << current.executions
+           << std::setw(8) << std::setprecision(2)
+           << percentage(current.executions, total) << "%" << std::endl;
+  }
+
+  stream << std::endl << "Hottest loops:" << std::endl;
+  for (const LoopStats &current : get_hottest_loops(n_entries)) {
+    stream << address_to_hex_str(current.start) << "-"
+           << std::left << std::setw(7) << address_to_hex_str(current.end)
+           << std::right << std::setw(14) << current.executions
+           << std::setw(8) << std::setprecision(2)
+           << percentage(current.executions, total) << "%"
+           << "  (" << current.iterations << " iterations)" << std::endl;
+  }
+  stream << std::defaultfloat;
+}
+
+/// \brief Write the complete profile as JSON
+/// \param stream Stream to write to
+void Profiler::write_json(std::ostream &stream) const {
+  stream << "{\n  \"executions\": " << get_total_executions() << ",\n";
+
+  stream << "  \"classes\": [";
+  const char *separator = "\n";
+  for (const ClassStats &current : get_classes()) {
+    stream << separator << "    {\"class\": \"" << current.name
+           << "\", \"executions\": " << current.executions
+           << ", \"nanoseconds\": " << current.nanoseconds << "}";
+    separator = ",\n";
+  }
+  stream << "\n  ],\n";
+
+  stream << "  \"addresses\": [";
+  separator = "\n";
+  for (const AddressStats &current : get_hottest_addresses(RAM_SIZE)) {
+    stream << separator << "    {\"address\": " << current.address
+           << ", \"executions\": " << current.executions << "}";
+    separator = ",\n";
+  }
+  stream << "\n  ],\n";
+
+  stream << "  \"loops\": [";
+  separator = "\n";
+  for (const LoopStats &current : get_hottest_loops(backward_jumps.size())) {
+    stream << separator << "    {\"start\": " << current.start
+           << ", \"end\": " << current.end
+           << ", \"iterations\": " << current.iterations
+           << ", \"executions\": " << current.executions << "}";
+    separator = ",\n";
+  }
+  stream << "\n  ]\n}\n";
+}
+
+}  // namespace Emulator
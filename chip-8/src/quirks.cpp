@@ -0,0 +1,45 @@
+#include "quirks.hpp"
+
+namespace Emulator {
+
+namespace {
+// Instructions that only exist in XO-CHIP:  register range save/load and
+// scroll up.  Long I loads (F000) and plane selection (FN01) are left out, as
+// they are indistinguishable from common sprite data
+bool is_xo_chip_instruction(const OPCODE_TYPE opcode) {
+  return (opcode & 0xF00F) == 0x5002
+      || (opcode & 0xF00F) == 0x5003
+      || (opcode & 0xFFF0) == 0x00D0;
+}
+
+// Instructions that only exist in SUPER-CHIP (and its descendants):
+// scrolling, resolution changes, exit, large font and flag registers
+bool is_super_chip_instruction(const OPCODE_TYPE opcode) {
+  return (opcode & 0xFFF0) == 0x00C0
+      || (opcode >= 0x00FB && opcode <= 0x00FF)
+      || (opcode & 0xF0FF) == 0xF030
+      || (opcode & 0xF0FF) == 0xF075
+      || (opcode & 0xF0FF) == 0xF085;
+}
+}  // namespace
+
+/// \brief Guess which interpreter a ROM was written for
+///
+/// ROMs are scanned for instructions introduced by later interpreters;  as
+/// plain CHIP-8 ROMs cannot be told apart from one another, they get the
+/// default quirks.
+///
+/// \param rom ROM to inspect
+/// \return Most likely profile for the ROM
+QuirksProfile detect_quirks_profile(const std::vector<MEM_TYPE> &rom) {
+  bool super_chip = false;
+  for (size_t offset = 0; offset + 1 < rom.size(); offset += 2) {
+    OPCODE_TYPE opcode = (rom[offset] << 8) + rom[offset + 1];
+    if (is_xo_chip_instruction(opcode)) return QuirksProfile::XO_CHIP;
+    super_chip = super_chip || is_super_chip_instruction(opcode);
+  }
+  if (super_chip) return QuirksProfile::SUPER_CHIP;
+  return QuirksProfile::DEFAULT;
+}
+
+}  // namespace Emulator
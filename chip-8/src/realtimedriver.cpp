@@ -0,0 +1,58 @@
+#include "realtimedriver.hpp"
+
+namespace Emulator {
+
+namespace {
+const int64_t TICKS_PER_SECOND = 60;
+}  // namespace
+
+/// \brief Create a driver for a machine, started now
+/// \param machine Machine whose timers are ticked, which must outlive the
+///        driver
+RealTimeDriver::RealTimeDriver(Chip8Machine &machine)
+    : machine(&machine), origin(Clock::now()), ticks(0) {}
+
+/// \brief Restart counting ticks from now
+void RealTimeDriver::start() {
+  start(Clock::now());
+}
+
+/// \brief Restart counting ticks from a given time
+/// \param now Time of the first tick period's start
+void RealTimeDriver::start(const Clock::time_point now) {
+  origin = now;
+  ticks = 0;
+}
+
+/// \brief Tick the timers for every sixtieth of a second elapsed until now
+/// \return Number of ticks applied
+int RealTimeDriver::sync() {
+  return sync(Clock::now());
+}
+
+/// \brief Tick the timers for every sixtieth of a second elapsed until a
+///        given time
+/// \param now Current time;  times earlier than a previous call tick nothing
+/// \return Number of ticks applied
+int RealTimeDriver::sync(const Clock::time_point now) {
+  if (now <= origin) return 0;
+  auto elapsed =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(now - origin);
+  uint64_t due = static_cast<uint64_t>(
+      elapsed.count() * TICKS_PER_SECOND / std::nano::den);
+  int n_ticks = 0;
+  while (ticks < due) {
+    machine->tick_60hz();
+    ticks += 1;
+    n_ticks += 1;
+  }
+  return n_ticks;
+}
+
+/// \brief Return the number of ticks applied since start()
+/// \return Number of ticks
+uint64_t RealTimeDriver::get_ticks() const {
+  return ticks;
+}
+
+}  // namespace Emulator
@@ -0,0 +1,249 @@
+#include "recompiler.hpp"
+
+#include <cstring>
+
+#include "chip8constants.hpp"
+
+#if defined(CHIP8_ENABLE_RECOMPILER) && defined(__x86_64__) && defined(__unix__)
+#define CHIP8_RECOMPILER_AVAILABLE
+#include <sys/mman.h>
+#endif
+
+namespace Emulator {
+
+namespace {
+const size_t CODE_SIZE = 1 << 20;
+
+// Offset of register VX in the array passed as first argument
+uint8_t v_offset(const int reg_num) {
+  return static_cast<uint8_t>(reg_num * sizeof(REG_TYPE));
+}
+
+bool is_terminator(const OPCODE_TYPE opcode) {
+  int family = opcode >> 12;
+  return family == 0x1 || family == 0x3 || family == 0x4;
+}
+}  // namespace
+
+/// \brief Reserve memory for compiled code
+///
+/// If the recompiler is not supported on this platform, no memory is reserved
+/// and compile() never produces code.
+///
+/// \param logic_resets_vf_ Whether 8XY1/8XY2/8XY3 set VF to zero
+Recompiler::Recompiler(const bool logic_resets_vf_)
+    : code(nullptr), code_size(0), code_used(0), exhausted(false),
+      logic_resets_vf(logic_resets_vf_) {
+#ifdef CHIP8_RECOMPILER_AVAILABLE
+  void *region = mmap(nullptr, CODE_SIZE, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (region != MAP_FAILED) {
+    code = static_cast<uint8_t *>(region);
+    code_size = CODE_SIZE;
+  }
+#endif
+}
+
+Recompiler::~Recompiler() {
+#ifdef CHIP8_RECOMPILER_AVAILABLE
+  if (code != nullptr) munmap(code, code_size);
+#endif
+}
+
+/// \brief Whether native code can be generated on this platform
+/// \return True if compile() is able to produce code
+bool Recompiler::is_supported() {
+#ifdef CHIP8_RECOMPILER_AVAILABLE
+  return true;
+#else
+  return false;
+#endif
+}
+
+/// \brief Compile the longest translatable prefix of a basic block
+///
+/// The block is assumed to end at its first jump or skip instruction.
+///
+/// \param opcodes Instructions of the basic block, in execution order
+/// \param start Address of the first instruction of the block
+/// \param n_compiled Set to the number of instructions compiled
+/// \return Compiled code, or nullptr if nothing could be compiled
+Recompiler::NativeBlock Recompiler::compile(
+    const std::vector<OPCODE_TYPE> &opcodes, const ADDR_TYPE start,
+    int *n_compiled) {
+  *n_compiled = 0;
+  if (code == nullptr) return nullptr;
+
+  buffer.clear();
+  ADDR_TYPE address = start;
+  bool terminated = false;
+  for (OPCODE_TYPE opcode : opcodes) {
+    ADDR_TYPE next = (address + INSTRUCTION_LENGTH) & 0xFFFF;
+    if (!emit_instruction(opcode, next)) break;
+    *n_compiled += 1;
+    address = next;
+    if (is_terminator(opcode)) {
+      terminated = true;
+      break;
+    }
+  }
+  if (*n_compiled == 0) return nullptr;
+  if (!terminated) {
+    emit({0xB8});  // mov eax, imm32
+    emit_imm32(address);
+    emit({0xC3});  // ret
+  }
+
+  if (code_used + buffer.size() > code_size) {
+    exhausted = true;
+    *n_compiled = 0;
+    return nullptr;
+  }
+#ifdef CHIP8_RECOMPILER_AVAILABLE
+  mprotect(code, code_size, PROT_READ | PROT_WRITE);
+  uint8_t *entry = code + code_used;
+  std::memcpy(entry, buffer.data(), buffer.size());
+  code_used += buffer.size();
+  mprotect(code, code_size, PROT_READ | PROT_EXEC);
+  return reinterpret_cast<NativeBlock>(entry);
+#else
+  return nullptr;
+#endif
+}
+
+/// \brief Whether compile() failed because the code area is full
+/// \return True if flush() must be called before compiling more code
+bool Recompiler::is_exhausted() const {
+  return exhausted;
+}
+
+/// \brief Discard all compiled code
+///
+/// Every NativeBlock handed out so far becomes invalid
+void Recompiler::flush() {
+  code_used = 0;
+  exhausted = false;
+}
+
+void Recompiler::emit(std::initializer_list<uint8_t> bytes) {
+  buffer.insert(buffer.end(), bytes);
+}
+
+void Recompiler::emit_imm32(const uint32_t value) {
+  emit({static_cast<uint8_t>(value), static_cast<uint8_t>(value >> 8),
+        static_cast<uint8_t>(value >> 16), static_cast<uint8_t>(value >> 24)});
+}
+
+/// \brief Emit native code for one instruction
+///
+/// Registers are loaded with movzx and stored as words, which reproduces the
+/// interpreter exactly, including for register values above 0xFF.
+/// Arguments follow the System V ABI:  rdi points to V0, rsi to I.
+///
+/// \param opcode Instruction to compile
+/// \param next Address of the instruction following this one
+/// \return False if the instruction cannot be compiled
+bool Recompiler::emit_instruction(const OPCODE_TYPE opcode,
+                                  const ADDR_TYPE next) {
+  uint8_t x = v_offset((opcode & 0x0F00) >> 8);
+  uint8_t y = v_offset((opcode & 0x00F0) >> 4);
+  uint8_t flag = v_offset(0xF);
+  uint8_t nn = opcode & 0x00FF;
+  uint16_t nnn = opcode & 0x0FFF;
+
+  switch (opcode >> 12) {
+    case 0x1:
+      emit({0xB8});                          // mov eax, nnn
+      emit_imm32(nnn);
+      emit({0xC3});                          // ret
+      return true;
+    case 0x3:
+    case 0x4:
+      emit({0x0F, 0xB7, 0x47, x});           // movzx eax, word [rdi + x]
+      emit({0x3D});                          // cmp eax, nn
+      emit_imm32(nn);
+      emit({0xB8});                          // mov eax, next
+      emit_imm32(next);
+      emit({0xB9});                          // mov ecx, next + 2
+      emit_imm32((next + INSTRUCTION_LENGTH) & 0xFFFF);
+      if ((opcode >> 12) == 0x3) {
+        emit({0x0F, 0x44, 0xC1});            // cmove eax, ecx
+      } else {
+        emit({0x0F, 0x45, 0xC1});            // cmovne eax, ecx
+      }
+      emit({0xC3});                          // ret
+      return true;
+    case 0x6:
+      emit({0x66, 0xC7, 0x47, x, nn, 0x00});  // mov word [rdi + x], nn
+      return true;
+    case 0x7:
+      emit({0x0F, 0xB7, 0x47, x});           // movzx eax, word [rdi + x]
+      emit({0x05});                          // add eax, nn
+      emit_imm32(nn);
+      emit({0x25});                          // and eax, 0xFF
+      emit_imm32(0xFF);
+      emit({0x66, 0x89, 0x47, x});           // mov [rdi + x], ax
+      return true;
+    case 0xA:
+      emit({0x66, 0xC7, 0x06,                // mov word [rsi], nnn
+            static_cast<uint8_t>(nnn), static_cast<uint8_t>(nnn >> 8)});
+      return true;
+    case 0x8:
+      break;
+    default:
+      return false;
+  }
+
+  switch (opcode & 0x000F) {
+    case 0x0:
+      emit({0x0F, 0xB7, 0x47, y});           // movzx eax, word [rdi + y]
+      emit({0x66, 0x89, 0x47, x});           // mov [rdi + x], ax
+      return true;
+    case 0x1:
+    case 0x2:
+    case 0x3:
+      emit({0x0F, 0xB7, 0x47, x});           // movzx eax, word [rdi + x]
+      emit({0x0F, 0xB7, 0x4F, y});           // movzx ecx, word [rdi + y]
+      if ((opcode & 0x000F) == 0x1) {
+        emit({0x09, 0xC8});                  // or eax, ecx
+      } else if ((opcode & 0x000F) == 0x2) {
+        emit({0x21, 0xC8});                  // and eax, ecx
+      } else {
+        emit({0x31, 0xC8});                  // xor eax, ecx
+      }
+      emit({0x66, 0x89, 0x47, x});           // mov [rdi + x], ax
+      if (logic_resets_vf) {
+        emit({0x66, 0xC7, 0x47, flag, 0x00, 0x00});  // mov word [rdi + 0xF], 0
+      }
+      return true;
+    case 0x4:
+      emit({0x0F, 0xB7, 0x47, x});           // movzx eax, word [rdi + x]
+      emit({0x0F, 0xB7, 0x4F, y});           // movzx ecx, word [rdi + y]
+      emit({0x01, 0xC8});                    // add eax, ecx
+      emit({0x31, 0xD2});                    // xor edx, edx
+      emit({0x3D});                          // cmp eax, 0xFF
+      emit_imm32(0xFF);
+      emit({0x0F, 0x97, 0xC2});              // seta dl
+      emit({0x25});                          // and eax, 0xFF
+      emit_imm32(0xFF);
+      emit({0x66, 0x89, 0x47, x});           // mov [rdi + x], ax
+      emit({0x66, 0x89, 0x57, flag});        // mov [rdi + 0xF], dx
+      return true;
+    case 0x5:
+      emit({0x0F, 0xB7, 0x47, x});           // movzx eax, word [rdi + x]
+      emit({0x0F, 0xB7, 0x4F, y});           // movzx ecx, word [rdi + y]
+      emit({0x31, 0xD2});                    // xor edx, edx
+      emit({0x39, 0xC8});                    // cmp eax, ecx
+      emit({0x0F, 0x97, 0xC2});              // seta dl
+      emit({0x29, 0xC8});                    // sub eax, ecx
+      emit({0x25});                          // and eax, 0xFF
+      emit_imm32(0xFF);
+      emit({0x66, 0x89, 0x47, x});           // mov [rdi + x], ax
+      emit({0x66, 0x89, 0x57, flag});        // mov [rdi + 0xF], dx
+      return true;
+    default:
+      return false;
+  }
+}
+
+}  // namespace Emulator
@@ -1,14 +1,24 @@
 #include <chrono>  // NOLINT [build/c++11]
+#include <fstream>
 #include <iostream>
 #include <map>
 #include <thread>  // NOLINT [build/c++11]
 
 #include "chip8machine.hpp"
+#include "memory.hpp"
+#include "realtimedriver.hpp"
 
 const int N_BYTES_IN_OP = sizeof(Emulator::OPCODE_TYPE);
 
 const int SLEEP_MS = 500;
 
+// Roughly the speed of the original interpreter, at 60 frames per second
+const int INSTRUCTIONS_PER_FRAME = 10;
+
+const int DEFAULT_PROFILE_FRAMES = 3600;
+
+const char DEFAULT_PROFILE_PATH[] = "chip8-profile.json";
+
 void output_stats(const std::map<std::string, int> &counter,
                   const unsigned int n_total) {
   int n_ops = 0;
@@ -80,14 +90,16 @@ void check_implemented_instructions(
     opcode = extract_big_endian_opcode(rom, pc);
     std::string opcode_str = convert_opcode_to_str(opcode);
 
-    try {
-      machine.decode(opcode);
+    // Other faults (e.g. returning with an empty stack) are expected here,
+    // since the instructions are executed out of context
+    Emulator::Fault fault = machine.execute(opcode);
+    machine.clear_fault();
+    if (fault != Emulator::Fault::UNSUPPORTED_OPCODE) {
       if (implemented.count(opcode_str) == 0) {
         implemented[opcode_str] = 0;
       }
       implemented[opcode_str] += 1;
-    }
-    catch (Emulator::OpcodeNotSupported &) {
+    } else {
       if (unimplemented.count(opcode_str) == 0) {
         unimplemented[opcode_str] = 0;
       }
@@ -98,10 +110,6 @@ void check_implemented_instructions(
         has_encountered_unimplemented = true;
       }
     }
-    catch (...) {
-      throw std::runtime_error(
-          "Unknown error encountered when parsing " + opcode_str);
-    }
     pc += N_BYTES_IN_OP;
   }
 
@@ -126,7 +134,7 @@ void check_implemented_instructions(
 }
 
 [[noreturn]] void run_rom(const std::vector<Emulator::MEM_TYPE> &rom) {
-  Emulator::Chip8Machine machine;
+  Emulator::Chip8Machine machine(Emulator::detect_quirks_profile(rom));
 
   std::cout << std::endl;
   std::cout << "Running ROM" << std::endl;
@@ -134,28 +142,89 @@ void check_implemented_instructions(
 
   machine.reset();
   machine.load_rom(rom);
-  machine.start_timers();
+  Emulator::RealTimeDriver driver(machine);
   while (true) {
     std::this_thread::sleep_for(std::chrono::milliseconds(SLEEP_MS));
     std::cout << std::string(machine) << std::endl;
     std::cout << machine.display_str() << std::endl;
     machine.advance();
+    driver.sync();
   }
 }
 
+// Runs the ROM without input for a fixed number of frames, then reports
+// where the time went
+void profile_rom(const std::vector<Emulator::MEM_TYPE> &rom,
+                 const int n_frames, const std::string &json_path) {
+  Emulator::Chip8Machine machine(Emulator::detect_quirks_profile(rom));
+  if (!machine.set_profiler(true)) {
+    std::cout << "Profiling is not available in this build, "
+              << "reconfigure with -DCHIP8_ENABLE_PROFILER=ON" << std::endl;
+    exit(1);
+  }
+
+  std::cout << std::endl;
+  std::cout << "Profiling ROM for " << n_frames << " frames" << std::endl;
+  std::cout << std::endl;
+
+  machine.reset();
+  machine.load_rom(rom);
+  for (int frame = 0; frame < n_frames; frame++) {
+    Emulator::RunStatus status = machine.run_frame(INSTRUCTIONS_PER_FRAME);
+    if (status == Emulator::RunStatus::UNSUPPORTED_OPCODE
+        || status == Emulator::RunStatus::FAULTED) {
+      std::cout << "Stopped at frame " << frame << ", PC "
+                << convert_opcode_to_str(machine.get_fault().pc) << std::endl;
+      break;
+    }
+  }
+
+  const Emulator::Profiler &profiler = *machine.get_profiler();
+  profiler.write_report(std::cout);
+  std::cout << std::endl;
+  std::cout << "Cycles skipped in idle loops: " << machine.get_elided_cycles()
+            << std::endl;
+
+  std::ofstream json(json_path);
+  profiler.write_json(json);
+  std::cout << "Profile written to " << json_path << std::endl;
+}
+
 int main(int argc, char **argv) {
-  if (argc < 2) {
+  bool profile = false;
+  std::string json_path = DEFAULT_PROFILE_PATH;
+  int n_frames = DEFAULT_PROFILE_FRAMES;
+  std::string path;
+  for (int arg = 1; arg < argc; arg++) {
+    std::string option(argv[arg]);
+    if (option == "--profile") {
+      profile = true;
+    } else if (option.compare(0, 10, "--profile=") == 0) {
+      profile = true;
+      json_path = option.substr(10);
+    } else if (option.compare(0, 9, "--frames=") == 0) {
+      n_frames = std::stoi(option.substr(9));
+    } else {
+      path = option;
+    }
+  }
+  if (path.empty()) {
     std::cout << "Please specify a file as an argument" << std::endl;
+    std::cout << "Usage: " << argv[0]
+              << " [--profile[=FILE.json]] [--frames=N] ROM" << std::endl;
     exit(1);
   }
 
   void *data;
   size_t size;
-  std::tie(data, size) =
-      Emulator::Memory::get_bytestream_from_file(std::string(argv[1]));
+  std::tie(data, size) = Emulator::Memory::get_bytestream_from_file(path);
   std::vector<Emulator::MEM_TYPE> rom =
       Emulator::Memory::convert_bytestream_to_vector(data, size);
 
+  if (profile) {
+    profile_rom(rom, n_frames, json_path);
+    return 0;
+  }
   check_implemented_instructions(rom);
   run_rom(rom);
 }
@@ -0,0 +1,184 @@
+#include "timerservice.hpp"
+
+#include <algorithm>
+
+namespace Emulator {
+
+namespace {
+const int64_t NANOSECONDS_PER_SECOND = 1000000000;
+}  // namespace
+
+TimerSubscription::TimerSubscription(TimerService *service,
+                                     Chip8Machine *machine)
+    : service(service), machine(machine), pending(0) {}
+
+/// \brief Stop receiving ticks;  pending ticks are discarded
+TimerSubscription::~TimerSubscription() {
+  service->unsubscribe(this);
+}
+
+/// \brief Tick the timers of the machine for every pending tick
+///
+/// Must be called from the thread running the machine
+///
+/// \return Number of ticks applied
+int TimerSubscription::apply() {
+  uint32_t n_ticks = pending.exchange(0);
+  for (uint32_t tick = 0; tick < n_ticks; tick++) machine->tick_60hz();
+  return static_cast<int>(n_ticks);
+}
+
+/// \brief Return the number of ticks received but not yet applied
+/// \return Number of pending ticks
+uint32_t TimerSubscription::get_pending() const {
+  return pending.load();
+}
+
+/// \brief Start the service thread
+/// \param ticks_per_second Frequency of the ticks
+/// \param threaded Whether to start the thread;  without it, ticks are only
+///        delivered by sync()
+TimerService::TimerService(const int ticks_per_second, const bool threaded)
+    : ticks_per_second(ticks_per_second), stopping(false), origin(),
+      n_scheduled(0), ticks(0), missed_ticks(0) {
+  if (threaded) thread = std::thread(&TimerService::run, this);
+}
+
+/// \brief Stop the service thread
+TimerService::~TimerService() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  changed.notify_all();
+  if (thread.joinable()) thread.join();
+}
+
+/// \brief Return the process-wide service, ticking at 60 Hz
+/// \return Process-wide service, started on first use
+TimerService &TimerService::get_instance() {
+  static TimerService instance;
+  return instance;
+}
+
+/// \brief Start delivering ticks to a machine
+/// \param machine Machine to tick, which must outlive the subscription
+/// \return Subscription, delivering ticks until destroyed
+std::unique_ptr<TimerSubscription> TimerService::subscribe(
+    Chip8Machine &machine) {
+  std::unique_ptr<TimerSubscription> subscription(
+      new TimerSubscription(this, &machine));
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    subscribers.push_back(subscription.get());
+  }
+  changed.notify_all();
+  return subscription;
+}
+
+/// \brief Return the number of machines receiving ticks
+/// \return Number of live subscriptions
+size_t TimerService::get_n_subscribers() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return subscribers.size();
+}
+
+/// \brief Return the frequency of the ticks
+/// \return Ticks per second
+int TimerService::get_ticks_per_second() const {
+  return ticks_per_second;
+}
+
+/// \brief Return the number of ticks delivered since the service started
+/// \return Number of ticks, counted once for all machines
+uint64_t TimerService::get_ticks() const {
+  return ticks.load();
+}
+
+/// \brief Return the number of ticks not delivered on time
+///
+/// Ticks are missed when the service thread wakes up after their deadline
+/// has been followed by another:  they are then delivered late, or dropped
+/// after a long stall.
+///
+/// \return Number of ticks, counted once for all machines
+uint64_t TimerService::get_missed_ticks() const {
+  return missed_ticks.load();
+}
+
+/// \brief Restart the schedule, the first tick being due one period later
+///
+/// Only meant for services created without a thread
+///
+/// \param now Start of the schedule
+void TimerService::start(const Clock::time_point now) {
+  std::lock_guard<std::mutex> lock(mutex);
+  origin = now;
+  n_scheduled = 0;
+}
+
+/// \brief Deliver the ticks due since the previous call
+///
+/// Only meant for services created without a thread.  Ticks due together
+/// are counted as missed, as for a late wake-up of the thread.
+///
+/// \param now Current time, no earlier than at the previous call
+/// \return Number of ticks delivered to each machine
+uint32_t TimerService::sync(const Clock::time_point now) {
+  std::lock_guard<std::mutex> lock(mutex);
+  return deliver_due_ticks(now);
+}
+
+void TimerService::unsubscribe(TimerSubscription *subscription) {
+  std::lock_guard<std::mutex> lock(mutex);
+  subscribers.erase(
+      std::remove(subscribers.begin(), subscribers.end(), subscription),
+      subscribers.end());
+}
+
+// Time of the end of a tick period, from the start of the schedule
+TimerService::Clock::duration TimerService::get_deadline(
+    const uint64_t n_periods) const {
+  return std::chrono::nanoseconds(
+      n_periods * NANOSECONDS_PER_SECOND / ticks_per_second);
+}
+
+void TimerService::run() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (!stopping) {
+    changed.wait(lock, [this] { return stopping || !subscribers.empty(); });
+
+    // The schedule starts over whenever machines subscribe to an idle service
+    origin = Clock::now();
+    n_scheduled = 0;
+    while (!stopping && !subscribers.empty()) {
+      Clock::time_point deadline = origin + get_deadline(n_scheduled + 1);
+      if (changed.wait_until(lock, deadline, [this] { return stopping; })) {
+        break;
+      }
+      deliver_due_ticks(Clock::now());
+    }
+  }
+}
+
+// Must be called with the mutex held
+uint32_t TimerService::deliver_due_ticks(const Clock::time_point now) {
+  int64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      now - origin).count();
+  uint64_t n_due = static_cast<uint64_t>(
+      elapsed * ticks_per_second / NANOSECONDS_PER_SECOND) - n_scheduled;
+  // Deadlines are rounded down, so the tick may not be due quite yet
+  if (n_due == 0) return 0;
+  n_scheduled += n_due;
+  if (subscribers.empty()) return 0;
+  missed_ticks += n_due - 1;
+  const uint64_t max_catch_up = static_cast<uint64_t>(ticks_per_second);
+  uint32_t n_delivered = static_cast<uint32_t>(std::min(n_due, max_catch_up));
+  for (TimerSubscription *subscription : subscribers) {
+    subscription->pending += n_delivered;
+  }
+  ticks += n_delivered;
+  return n_delivered;
+}
+
+}  // namespace Emulator
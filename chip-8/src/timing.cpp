@@ -0,0 +1,211 @@
+#include "chip8machine.hpp"
+
+namespace Emulator {
+
+namespace {
+// One frame of the CDP1861 video chip:  1.7609 MHz, 8 clock periods per
+// machine cycle, 60 frames per second
+const int VIP_CYCLES_PER_FRAME = 3668;
+
+// Cycles taken from the interpreter every frame by video DMA (128 lines of
+// 8 bytes) and by the interrupt routine, which also decrements the timers
+const int VIP_VIDEO_CYCLES_PER_FRAME = 1024 + 32;
+
+const int VIP_INTERPRETER_CYCLES_PER_FRAME =
+    VIP_CYCLES_PER_FRAME - VIP_VIDEO_CYCLES_PER_FRAME;
+
+// Spent by the interpreter loop fetching and dispatching every instruction
+const int VIP_FETCH_CYCLES = 40;
+
+// Spent by skip instructions when the skip is taken
+const int VIP_SKIP_CYCLES = 4;
+}  // namespace
+
+/// \brief Return how the length of a frame is measured
+/// \return Current timing model
+TimingModel Chip8Machine::get_timing_model() const {
+  return timing_model;
+}
+
+/// \brief Select how the length of a frame is measured by run_frame()
+///
+/// The next frame starts from its first cycle
+///
+/// \param model Timing model to use
+void Chip8Machine::set_timing_model(const TimingModel model) {
+  timing_model = model;
+  state.frame_cycles = 0;
+}
+
+/// \brief Decrement the delay and sound timers, as done 60 times a second
+///
+/// Timers only move when this is called, by run_frame() or by a driver such
+/// as RealTimeDriver, so that a machine runs in emulated time:  as fast as
+/// the host allows, and identically from one run to the next.
+void Chip8Machine::tick_60hz() {
+  trigger_delay_timer();
+  sound_playing = state.sound_timer > 0;
+  if (state.sound_timer > 0) state.sound_timer -= 1;
+}
+
+/// \brief Return whether the buzzer sounded during the last 1/60 s
+///
+/// The buzzer sounds while the sound timer is nonzero, so FX18 with VX = 1
+/// sounds it until the next tick_60hz().
+///
+/// \return Whether the sound timer was nonzero when the timers last ticked
+bool Chip8Machine::is_sound_playing() const {
+  return sound_playing;
+}
+
+/// \brief Execute one 60 Hz frame of a COSMAC VIP
+///
+/// Instructions are charged their approximate cost on the original
+/// interpreter, until the cycles left to the interpreter by the video chip
+/// are spent.  The last instruction may overrun the frame, the next frame is
+/// then shortened accordingly.  As on the VIP, DXYN waits for the start of a
+/// frame before drawing, so at most one sprite is drawn per frame.
+///
+/// Frames cut short (jump to self, FX0A waiting for a key, faults) still last
+/// until their end, and tick the timers once.
+///
+/// \return Why execution stopped
+RunStatus Chip8Machine::run_vip_frame() {
+  RunStatus status = RunStatus::OK;
+  while (state.frame_cycles < VIP_INTERPRETER_CYCLES_PER_FRAME) {
+    if (fault.code != Fault::NONE) {
+      status = RunStatus::FAULTED;
+      break;
+    }
+    ADDR_TYPE address = state.pc;
+    if (address + 1 >= memory_size) {
+      status = RunStatus::HALTED;
+      break;
+    }
+    DecodedInstruction uncached;
+    DecodedInstruction *instruction = &uncached;
+    if ((address % INSTRUCTION_LENGTH) != 0) {
+      uncached = predecode(fetch_instruction());
+    } else {
+      instruction = &instruction_cache[address / INSTRUCTION_LENGTH];
+      if (instruction->handler == nullptr) {
+        *instruction = predecode(fetch_instruction());
+      }
+    }
+
+    if (instruction->handler == &Chip8Machine::op_unsupported) {
+      raise_fault(Fault::UNSUPPORTED_OPCODE, address, instruction->opcode);
+      status = RunStatus::UNSUPPORTED_OPCODE;
+      break;
+    }
+    // Sprites are drawn right after the vertical blank interrupt
+    bool draws = (instruction->opcode >> 12) == 0xD;
+    if (draws && state.frame_cycles > 0) break;
+
+    state.frame_cycles += vip_cycles(*instruction);
+    bool jumps_to_self = instruction->handler == &Chip8Machine::op_1NNN
+        && instruction->nnn == address;
+    state.pc += INSTRUCTION_LENGTH;
+#ifdef CHIP8_ENABLE_PROFILER
+    if (profiler) {
+      execute_profiled(*instruction, address);
+    } else {
+      (this->*instruction->handler)(*instruction);
+    }
+#else
+    (this->*instruction->handler)(*instruction);
+#endif
+
+    if (jumps_to_self) {
+      status = RunStatus::HALTED;
+      break;
+    }
+    if (waiting_for_key) {
+      status = RunStatus::WAITING_FOR_KEY;
+      break;
+    }
+  }
+
+  if (state.frame_cycles >= VIP_INTERPRETER_CYCLES_PER_FRAME) {
+    state.frame_cycles -= VIP_INTERPRETER_CYCLES_PER_FRAME;
+  } else {
+    state.frame_cycles = 0;
+  }
+  tick_60hz();
+  return status;
+}
+
+/// \brief Return the cost of an instruction on the COSMAC VIP interpreter
+///
+/// Costs are in machine cycles of 8 clock periods (4.54 us), approximating
+/// the published timings of the original interpreter.  They must be computed
+/// before the instruction executes, as some depend on register contents.
+///
+/// \param instruction Instruction about to be executed
+/// \return Number of machine cycles the instruction takes
+int Chip8Machine::vip_cycles(const DecodedInstruction &instruction) const {
+  REG_TYPE value_x = state.v[instruction.x];
+  REG_TYPE value_y = state.v[instruction.y];
+  int cycles = VIP_FETCH_CYCLES;
+  switch (instruction.opcode >> 12) {
+    case 0x0:
+      return cycles + (instruction.opcode == 0x00E0 ? 24 : 10);
+    case 0x1:
+      return cycles + 12;
+    case 0x2:
+      return cycles + 26;
+    case 0x3:
+      cycles += 10;
+      return cycles + (value_x == instruction.nn ? VIP_SKIP_CYCLES : 0);
+    case 0x4:
+      cycles += 10;
+      return cycles + (value_x != instruction.nn ? VIP_SKIP_CYCLES : 0);
+    case 0x5:
+      cycles += 14;
+      return cycles + (value_x == value_y ? VIP_SKIP_CYCLES : 0);
+    case 0x6:
+      return cycles + 6;
+    case 0x7:
+      return cycles + 10;
+    case 0x8:
+      return cycles + 44;
+    case 0x9:
+      cycles += 14;
+      return cycles + (value_x != value_y ? VIP_SKIP_CYCLES : 0);
+    case 0xA:
+      return cycles + 12;
+    case 0xB:
+      return cycles + 22;
+    case 0xC:
+      return cycles + 36;
+    case 0xD: {
+      // Sprites not aligned on a byte are shifted across two bytes
+      int cycles_per_row = (value_x % 8) == 0 ? 34 : 56;
+      return cycles + 26 + instruction.n * cycles_per_row;
+    }
+    case 0xE: {
+      bool pressed = keys.test(value_x & 0xF);
+      bool skips = pressed == (instruction.nn == 0x9E);
+      return cycles + 14 + (skips ? VIP_SKIP_CYCLES : 0);
+    }
+    default:
+      break;
+  }
+  switch (instruction.nn) {
+    case 0x1E:
+      return cycles + 12;
+    case 0x29:
+      return cycles + 16;
+    case 0x33:
+      // Digits are extracted by repeated subtraction
+      return cycles + 24
+          + 4 * ((value_x / 100) % 10 + (value_x / 10) % 10 + value_x % 10);
+    case 0x55:
+    case 0x65:
+      return cycles + 8 + 8 * (instruction.x + 1);
+    default:
+      return cycles + 10;
+  }
+}
+
+}  // namespace Emulator
@@ -1,37 +1,115 @@
 #include "upscaler.hpp"
 
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
 namespace Emulator {
 
 namespace {
-const int PIXEL_COLOR = 0xFFFF;
-const int X_SCALE = 8;
-const int Y_SCALE = 8;
+// Pixels of the display covered by one span
+const int SPAN_PIXELS = 8;
+
+const int N_SPANS = 256;
+
+// Upscale one row of the display into one line, span by span;  the last
+// span is cut short when the line ends in the middle of a byte
+void expand_line(unsigned char *line, const uint64_t bits,
+                 const int line_bytes, const unsigned char *spans,
+                 const int span_bytes) {
+  for (int offset = 0, shift = 64 - SPAN_PIXELS; offset < line_bytes;
+       offset += span_bytes, shift -= SPAN_PIXELS) {
+    const unsigned char *span = spans + ((bits >> shift) & 0xFF) * span_bytes;
+    std::memcpy(line + offset, span,
+                std::min(span_bytes, line_bytes - offset));
+  }
+}
+
+int get_format_bytes(const PixelFormat format) {
+  return format == PixelFormat::RGB565 ? 2 : 4;
+}
 }  // namespace
 
-Upscaler::Upscaler()
-    : pixel_color(PIXEL_COLOR), x_scale(X_SCALE), y_scale(Y_SCALE) {}
+/// \brief Create an upscaler and precompute the spans of its configuration
+/// \param x_scale_ Scaling factor for width of display
+/// \param y_scale_ Scaling factor for height of display
+/// \param format_ Layout of the pixels of the upscaled frame
+/// \param palette_ Colors of the pixels, as 0xRRGGBB
+/// \throw std::invalid_argument if a scaling factor is less than 1
+Upscaler::Upscaler(int x_scale_, int y_scale_, PixelFormat format_,
+                   Palette palette_)
+    : x_scale(x_scale_), y_scale(y_scale_), format(format_),
+      palette(palette_),
+      span_bytes(SPAN_PIXELS * x_scale_ * get_format_bytes(format_)) {
+  if (x_scale < 1 || y_scale < 1) {
+    throw std::invalid_argument("Scaling factors must be at least 1, got "
+                                + std::to_string(x_scale) + "x"
+                                + std::to_string(y_scale));
+  }
+  const int bytes_per_pixel = get_bytes_per_pixel();
+  const uint32_t colors[2] = {convert_color(palette.off_color, format),
+                              convert_color(palette.on_color, format)};
+  spans.resize(N_SPANS * span_bytes);
+  for (int group = 0; group < N_SPANS; group++) {
+    unsigned char *span = spans.data() + group * span_bytes;
+    for (int x = 0; x < SPAN_PIXELS * x_scale; x++) {
+      int on = (group >> (SPAN_PIXELS - 1 - x / x_scale)) & 0x1;
+      if (bytes_per_pixel == 2) {
+        uint16_t pixel = static_cast<uint16_t>(colors[on]);
+        std::memcpy(span + x * bytes_per_pixel, &pixel, sizeof(pixel));
+      } else {
+        std::memcpy(span + x * bytes_per_pixel, &colors[on],
+                    sizeof(colors[on]));
+      }
+    }
+  }
+}
 
 /// \brief Upscale a frame buffer to machine resolution to user-specified value
-/// \param frame_buffer Frame buffer, already allocated to upscaled size
-/// \param width Width of upscaled screen, in number of bytes
+/// \param frame_buffer Frame buffer, already allocated to upscaled size, of
+///        pixels laid out as format
+/// \param width Width of upscaled screen, in number of pixels
 /// \param my_machine Machine whose display will be upscaled
-void Upscaler::upscale(unsigned short *frame_buffer, int width,
-                       const Chip8Machine &my_machine) const {
+/// \param rows Rows of the machine display to upscale, bit y standing for
+///        row y;  other rows of the frame buffer are left untouched
+void Upscaler::upscale(void *frame_buffer, int width,
+                       const Chip8Machine &my_machine,
+                       const uint64_t rows) const {
+  const std::array<uint64_t, MAX_HEIGHT> &screen = my_machine.get_screen();
+  const int pitch = width * get_bytes_per_pixel();
+  const int line_bytes =
+      my_machine.display_width * x_scale * get_bytes_per_pixel();
   for (int y_machine = 0; y_machine < my_machine.display_height; y_machine++) {
-    for (int x_machine = 0; x_machine < my_machine.display_width; x_machine++) {
-      unsigned short pixel = my_machine.get_pixel(x_machine, y_machine);
-      if (pixel > 0) {
-        pixel = pixel_color;
-      }
-      for (int y_sub = 0; y_sub < Upscaler::y_scale; y_sub++) {
-        for (int x_sub = 0; x_sub < Upscaler::x_scale; x_sub++) {
-          unsigned short x = Upscaler::y_scale * x_machine + x_sub;
-          unsigned short y = Upscaler::y_scale * y_machine + y_sub;
-          frame_buffer[y * width + x] = pixel;
-        }
-      }
+    if (((rows >> y_machine) & 0x1) == 0) continue;
+    unsigned char *line = static_cast<unsigned char *>(frame_buffer)
+        + y_machine * y_scale * pitch;
+    expand_line(line, screen[y_machine], line_bytes, spans.data(),
+                span_bytes);
+    for (int y_sub = 1; y_sub < y_scale; y_sub++) {
+      std::memcpy(line + y_sub * pitch, line, line_bytes);
     }
   }
 }
 
+/// \brief Return the size of the pixels of the upscaled frame
+/// \return 2 for RGB565, 4 for XRGB8888
+int Upscaler::get_bytes_per_pixel() const {
+  return get_format_bytes(format);
+}
+
+/// \brief Convert a 0xRRGGBB color to a pixel format
+/// \param color Color to convert, as 0xRRGGBB
+/// \param pixel_format Format to convert to
+/// \return Value of a pixel of that color, in the low bits for RGB565
+uint32_t Upscaler::convert_color(const uint32_t color,
+                                 const PixelFormat pixel_format) {
+  if (pixel_format == PixelFormat::XRGB8888) return color & 0xFFFFFF;
+  uint32_t red = (color >> 16) & 0xFF;
+  uint32_t green = (color >> 8) & 0xFF;
+  uint32_t blue = color & 0xFF;
+  return ((red >> 3) << 11) | ((green >> 2) << 5) | (blue >> 3);
+}
+
 }  //  namespace Emulator
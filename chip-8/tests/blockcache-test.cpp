@@ -0,0 +1,234 @@
+#pragma clang diagnostic push
+#pragma ide diagnostic ignored "cert-err58-cpp"
+#include "gtest/gtest.h"
+
+#include "chip8machine.hpp"
+
+#include "chip8machinetester.hpp"
+#include "test-constants.hpp"
+#include "utilities.hpp"
+
+class BlockCacheFixture : public Emulator::LockstepFixture {};
+
+class RunCyclesParameterizedTestFixture : public BlockCacheFixture,
+                                          public ::testing::WithParamInterface<int> {
+};
+TEST_P(RunCyclesParameterizedTestFixture, RunCyclesMatchesRepeatedAdvance) {
+  int n_cycles = GetParam();
+  load(Emulator::LOOP_ROM);
+  machine.run_cycles(n_cycles);
+  for (int i = 0; i < n_cycles; i++) {
+    reference.advance();
+  }
+  expect_same_state();
+}
+TEST_P(RunCyclesParameterizedTestFixture, RunCyclesInSingleStepsMatchesRepeatedAdvance) {
+  int n_cycles = GetParam();
+  load(Emulator::LOOP_ROM);
+  for (int i = 0; i < n_cycles; i++) {
+    machine.run_cycles(1);
+    reference.advance();
+    expect_same_state();
+  }
+}
+INSTANTIATE_TEST_SUITE_P
+(
+    RunCyclesTests,
+    RunCyclesParameterizedTestFixture,
+    ::testing::Values(0, 1, 2, 5, 8, 17, 40)
+);
+
+TEST_F(BlockCacheFixture, RunCyclesExecutesInstructionRewrittenInMemory) {
+  load({0x61, 0x3F, 0x62, 0x3F});
+  machine.run_cycles(2);
+  EXPECT_EQ(0x3F, tester.get_v(1));
+
+  // Rewrite the second instruction of the already-executed block
+  tester.set_memory_byte(TEST_ROM_START_ADDRESS + 3, 0x2A);
+  machine.reset();
+  machine.run_cycles(2);
+  EXPECT_EQ(0x2A, tester.get_v(2));
+}
+
+TEST_F(BlockCacheFixture, RunCyclesExecutesCodeOverwrittenByFX33) {
+  std::vector<unsigned char> rom = {
+      0x61, 0x00,  // 0x200: V1 = 0x00, hundreds digit of V0 lands in NN
+      0xF0, 0x33,  // 0x202: BCD of V0 at I = 0x201, overwrites itself
+  };
+  load(rom);
+  tester.set_v(0, 200);
+  tester.set_i(TEST_ROM_START_ADDRESS + 1);
+  machine.run_cycles(2);
+  EXPECT_EQ(0x00, tester.get_v(1));
+  EXPECT_EQ(0x02, tester.get_memory_byte(TEST_ROM_START_ADDRESS + 1));
+
+  machine.reset();
+  machine.run_cycles(1);
+  EXPECT_EQ(0x02, tester.get_v(1));
+}
+
+TEST_F(BlockCacheFixture, RunCyclesStopsBeforeUnsupportedOpcode) {
+  load({0x61, 0x01, 0x90, 0x00});
+  EXPECT_EQ(Emulator::RunStatus::UNSUPPORTED_OPCODE, machine.run_cycles(10));
+  EXPECT_EQ(0x01, tester.get_v(1));
+  EXPECT_EQ(TEST_ROM_START_ADDRESS + 2, tester.get_pc());
+}
+
+TEST_F(BlockCacheFixture, RunCyclesRecordsFaultForUnsupportedOpcode) {
+  load({0x61, 0x01, 0x90, 0x00});
+  machine.run_cycles(10);
+  EXPECT_EQ(Emulator::Fault::UNSUPPORTED_OPCODE, machine.get_fault().code);
+  EXPECT_EQ(TEST_ROM_START_ADDRESS + 2, machine.get_fault().pc);
+  EXPECT_EQ(0x9000, machine.get_fault().opcode);
+}
+
+TEST_F(BlockCacheFixture, RunCyclesDoesNothingUntilFaultCleared) {
+  load({0x00, 0xEE, 0x61, 0x01});
+  EXPECT_EQ(Emulator::RunStatus::FAULTED, machine.run_cycles(10));
+  EXPECT_EQ(Emulator::Fault::STACK_UNDERFLOW, machine.get_fault().code);
+  EXPECT_EQ(Emulator::RunStatus::FAULTED, machine.run_cycles(10));
+  EXPECT_EQ(0x00, tester.get_v(1));
+
+  machine.clear_fault();
+  EXPECT_EQ(Emulator::RunStatus::OK, machine.run_cycles(1));
+  EXPECT_EQ(0x01, tester.get_v(1));
+}
+
+TEST_F(BlockCacheFixture, RunCyclesReportsOkWhenBudgetEndsBeforeUnsupportedOpcode) {
+  load({0x61, 0x01, 0x90, 0x00});
+  EXPECT_EQ(Emulator::RunStatus::OK, machine.run_cycles(1));
+  EXPECT_EQ(TEST_ROM_START_ADDRESS + 2, tester.get_pc());
+}
+
+TEST_F(BlockCacheFixture, RunCyclesHaltsOnJumpToSelf) {
+  load({0x61, 0x01, 0x12, 0x02});
+  EXPECT_EQ(Emulator::RunStatus::HALTED, machine.run_cycles(100));
+  EXPECT_EQ(TEST_ROM_START_ADDRESS + 2, tester.get_pc());
+}
+
+TEST_F(BlockCacheFixture, RunCyclesHaltsWhenRunningOffEndOfRAM) {
+  load({});
+  tester.set_pc(TEST_RAM_SIZE - 1);
+  EXPECT_EQ(Emulator::RunStatus::HALTED, machine.run_cycles(10));
+  EXPECT_EQ(10u, machine.get_elided_cycles());
+}
+
+TEST_F(BlockCacheFixture, RunCyclesWaitsForKeyPress) {
+  load({0xF3, 0x0A, 0x61, 0x01});
+  EXPECT_EQ(Emulator::RunStatus::WAITING_FOR_KEY, machine.run_cycles(10));
+  EXPECT_EQ(TEST_ROM_START_ADDRESS, tester.get_pc());
+
+  machine.set_key(0x5, true);
+  EXPECT_EQ(Emulator::RunStatus::OK, machine.run_cycles(2));
+  EXPECT_EQ(0x5, tester.get_v(3));
+  EXPECT_EQ(0x01, tester.get_v(1));
+}
+
+// Waits for the delay timer to reach zero, then sets V1
+const std::vector<unsigned char> TIMER_WAIT_ROM = {
+    0xF0, 0x07,  // 0x200: V0 = delay timer
+    0x30, 0x00,  // 0x202: skip if V0 == 0
+    0x12, 0x00,  // 0x204: jump to 0x200
+    0x61, 0x01,  // 0x206: V1 = 1
+    0x12, 0x08,  // 0x208: jump to self
+};
+
+class IdleLoopParameterizedTestFixture : public BlockCacheFixture,
+                                         public ::testing::WithParamInterface<int> {
+};
+TEST_P(IdleLoopParameterizedTestFixture, SkippingTimerWaitMatchesRepeatedAdvance) {
+  int n_cycles = GetParam();
+  load(TIMER_WAIT_ROM);
+  tester.set_delay_timer(0x3);
+  reference_tester.set_delay_timer(0x3);
+  // Leave V0 stale, the first iteration must still load it
+  tester.set_v(0, 0x7);
+  reference_tester.set_v(0, 0x7);
+  for (int frame = 0; frame < 5; frame++) {
+    machine.run_frame(n_cycles);
+    for (int i = 0; i < n_cycles; i++) {
+      reference.advance();
+    }
+    reference.trigger_delay_timer();
+    expect_same_state();
+  }
+}
+INSTANTIATE_TEST_SUITE_P
+(
+    IdleLoopTests,
+    IdleLoopParameterizedTestFixture,
+    ::testing::Values(1, 2, 3, 4, 5, 7, 100)
+);
+
+TEST_F(BlockCacheFixture, RunCyclesSkipsTimerWaitUntilTimerExpires) {
+  load(TIMER_WAIT_ROM);
+  tester.set_delay_timer(0x2);
+  EXPECT_EQ(Emulator::RunStatus::OK, machine.run_cycles(301));
+  EXPECT_EQ(0x2, tester.get_v(0));
+  EXPECT_EQ(TEST_ROM_START_ADDRESS + 2, tester.get_pc());
+  EXPECT_EQ(300u, machine.get_elided_cycles());
+
+  machine.trigger_delay_timer();
+  machine.trigger_delay_timer();
+  EXPECT_EQ(Emulator::RunStatus::HALTED, machine.run_cycles(100));
+  EXPECT_EQ(0x01, tester.get_v(1));
+}
+
+TEST_F(BlockCacheFixture, RunCyclesSkipsKeyWaitUntilKeyPressed) {
+  load({
+      0x60, 0x05,  // 0x200: V0 = 5
+      0xE0, 0x9E,  // 0x202: skip if key V0 is pressed
+      0x12, 0x02,  // 0x204: jump to 0x202
+      0x61, 0x01,  // 0x206: V1 = 1
+  });
+  EXPECT_EQ(Emulator::RunStatus::OK, machine.run_cycles(101));
+  EXPECT_EQ(TEST_ROM_START_ADDRESS + 2, tester.get_pc());
+  EXPECT_EQ(98u, machine.get_elided_cycles());
+
+  machine.set_key(0x5, true);
+  machine.run_cycles(2);
+  EXPECT_EQ(0x01, tester.get_v(1));
+}
+
+TEST_F(BlockCacheFixture, RunCyclesExecutesLoopsThatChangeState) {
+  load({
+      0xF0, 0x07,  // 0x200: V0 = delay timer
+      0x31, 0x00,  // 0x202: skip if V1 == 0
+      0x12, 0x00,  // 0x204: jump to 0x200
+  });
+  tester.set_v(1, 0x1);
+  machine.run_cycles(100);
+  EXPECT_EQ(0u, machine.get_elided_cycles());
+}
+
+TEST_F(BlockCacheFixture, RunCyclesChecksJumpBackOfIdleLoop) {
+  load(TIMER_WAIT_ROM);
+  tester.set_delay_timer(0x2);
+  machine.run_cycles(3);
+  EXPECT_EQ(3u, machine.get_elided_cycles());
+
+  // V1 = V1 + 1 in place of the jump back
+  tester.set_memory_byte(TEST_ROM_START_ADDRESS + 4, 0x71);
+  tester.set_memory_byte(TEST_ROM_START_ADDRESS + 5, 0x01);
+  machine.reset();
+  machine.run_cycles(3);
+  EXPECT_EQ(3u, machine.get_elided_cycles());
+  EXPECT_EQ(0x01, tester.get_v(1));
+}
+
+TEST_F(BlockCacheFixture, RunCyclesCountsCyclesLeftAfterJumpToSelf) {
+  load({0x61, 0x01, 0x12, 0x02});
+  machine.run_cycles(100);
+  EXPECT_EQ(98u, machine.get_elided_cycles());
+}
+
+TEST_F(BlockCacheFixture, RunFrameTicksDelayTimerOnce) {
+  load({0x12, 0x00});
+  tester.set_delay_timer(0x10);
+  EXPECT_EQ(Emulator::RunStatus::HALTED, machine.run_frame(10));
+  EXPECT_EQ(0x0F, tester.get_delay_timer());
+}
+
+#ifndef __CLION_IDE_
+#pragma clang diagnostic pop
+#endif
@@ -0,0 +1,76 @@
+#include "buzzer.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace {
+std::vector<int16_t> render(Emulator::Buzzer &buzzer, const bool playing) {
+  const int16_t *samples = buzzer.render_frame(playing);
+  return std::vector<int16_t>(
+      samples, samples + 2 * buzzer.get_frames_per_video_frame());
+}
+}  // namespace
+
+TEST(BuzzerTest, FrameLastsOneSixtiethOfASecond) {
+  Emulator::Buzzer buzzer;
+  EXPECT_EQ(buzzer.get_frames_per_video_frame(), 735u);
+  Emulator::Buzzer fast(48000, 50);
+  EXPECT_EQ(fast.get_frames_per_video_frame(), 960u);
+}
+
+TEST(BuzzerTest, SilentFrameIsZero) {
+  Emulator::Buzzer buzzer;
+  for (int16_t sample : render(buzzer, false)) ASSERT_EQ(sample, 0);
+}
+
+TEST(BuzzerTest, SquareWaveAlternatesBetweenPeaksInBothChannels) {
+  Emulator::Buzzer buzzer(44100, 60, 420.0, Emulator::Waveform::SQUARE, 1000);
+  std::vector<int16_t> samples = render(buzzer, true);
+  for (size_t sample = 0; sample < samples.size(); sample += 2) {
+    ASSERT_TRUE(samples[sample] == 1000 || samples[sample] == -1000);
+    ASSERT_EQ(samples[sample], samples[sample + 1]);
+  }
+  // 105 samples per period at 420 Hz:  the first half period is high
+  EXPECT_EQ(samples[0], 1000);
+  EXPECT_EQ(samples[2 * 52], 1000);
+  EXPECT_EQ(samples[2 * 53], -1000);
+  EXPECT_EQ(samples[2 * 106], 1000);
+}
+
+// Rendering frame after frame gives the same tone as one long frame
+TEST(BuzzerTest, PhaseCarriesOverBetweenFrames) {
+  Emulator::Buzzer buzzer(44100, 60, 440.0, Emulator::Waveform::SINE, 10000);
+  Emulator::Buzzer long_frame(44100, 20, 440.0, Emulator::Waveform::SINE,
+                              10000);
+  std::vector<int16_t> expected = render(long_frame, true);
+  std::vector<int16_t> actual;
+  for (int frame = 0; frame < 3; frame++) {
+    std::vector<int16_t> samples = render(buzzer, true);
+    actual.insert(actual.end(), samples.begin(), samples.end());
+  }
+  EXPECT_EQ(actual, expected);
+}
+
+TEST(BuzzerTest, ToneRestartsAfterSilence) {
+  Emulator::Buzzer buzzer(44100, 60, 440.0, Emulator::Waveform::TRIANGLE);
+  std::vector<int16_t> first = render(buzzer, true);
+  render(buzzer, true);
+  render(buzzer, false);
+  EXPECT_EQ(render(buzzer, true), first);
+}
+
+TEST(BuzzerTest, TriangleAndSineStayWithinAmplitude) {
+  for (Emulator::Waveform waveform :
+       {Emulator::Waveform::TRIANGLE, Emulator::Waveform::SINE}) {
+    Emulator::Buzzer buzzer(44100, 60, 420.0, waveform, 5000);
+    int16_t peak = 0;
+    for (int16_t sample : render(buzzer, true)) {
+      ASSERT_LE(std::abs(sample), 5000);
+      if (sample > peak) peak = sample;
+    }
+    EXPECT_GT(peak, 4900);
+  }
+}
@@ -2,6 +2,8 @@
 #pragma ide diagnostic ignored "cert-err58-cpp"
 #include "gtest/gtest.h"
 
+#include <cstring>
+
 #include "chip8machine.hpp"
 
 #include "chip8machinetester.hpp"
@@ -44,6 +46,70 @@ TEST_F(Chip8MachineFixture, PassingUnsupportedOpcodeStopsInterpreter) {
   }
 }
 
+TEST_F(Chip8MachineFixture, ExecuteRecordsUnsupportedOpcodeWithoutThrowing) {
+  tester.set_pc(TEST_ROM_START_ADDRESS + TEST_INSTRUCTION_LENGTH);
+  EXPECT_EQ(Emulator::Fault::UNSUPPORTED_OPCODE, machine.execute(0x9000));
+  EXPECT_EQ(Emulator::Fault::UNSUPPORTED_OPCODE, machine.get_fault().code);
+  EXPECT_EQ(TEST_ROM_START_ADDRESS, machine.get_fault().pc);
+  EXPECT_EQ(0x9000, machine.get_fault().opcode);
+}
+
+TEST_F(Chip8MachineFixture, FaultIsKeptUntilCleared) {
+  machine.execute(0x9000);
+  machine.execute(0x6105);
+  EXPECT_EQ(Emulator::Fault::UNSUPPORTED_OPCODE, machine.execute(0x9123));
+  EXPECT_EQ(0x9000, machine.get_fault().opcode);
+  EXPECT_EQ(0x05, tester.get_v(1));
+
+  machine.clear_fault();
+  EXPECT_EQ(Emulator::Fault::NONE, machine.get_fault().code);
+}
+
+TEST_F(Chip8MachineFixture, ReturnWithEmptyStackFaults) {
+  tester.set_pc(TEST_ROM_START_ADDRESS + TEST_INSTRUCTION_LENGTH);
+  EXPECT_EQ(Emulator::Fault::STACK_UNDERFLOW, machine.execute(0x00EE));
+  EXPECT_EQ(TEST_ROM_START_ADDRESS, machine.get_fault().pc);
+  EXPECT_EQ(TEST_ROM_START_ADDRESS + TEST_INSTRUCTION_LENGTH, tester.get_pc());
+}
+
+TEST_F(Chip8MachineFixture, CallWithFullStackFaults) {
+  for (int depth = 0; depth < TEST_STACK_DEPTH; depth++) {
+    EXPECT_EQ(Emulator::Fault::NONE, machine.execute(0x2300));
+  }
+  tester.set_pc(TEST_ROM_START_ADDRESS + TEST_INSTRUCTION_LENGTH);
+  EXPECT_EQ(Emulator::Fault::STACK_OVERFLOW, machine.execute(0x2300));
+  EXPECT_EQ(TEST_ROM_START_ADDRESS, machine.get_fault().pc);
+  EXPECT_EQ(TEST_ROM_START_ADDRESS + TEST_INSTRUCTION_LENGTH, tester.get_pc());
+}
+
+TEST_F(Chip8MachineFixture, DecodeClearsFaultItThrows) {
+  EXPECT_THROW(machine.decode(0x9000), Emulator::OpcodeNotSupported);
+  EXPECT_EQ(Emulator::Fault::NONE, machine.get_fault().code);
+}
+
+TEST_F(Chip8MachineFixture, InvalidRegisterThrowsThroughTester) {
+  EXPECT_THROW(tester.get_v(TEST_NUM_REGISTERS), std::runtime_error);
+  EXPECT_THROW(tester.set_v(TEST_NUM_REGISTERS, 0x00), std::runtime_error);
+  EXPECT_EQ(Emulator::Fault::NONE, machine.get_fault().code);
+}
+
+class UnsupportedOpcodeParameterizedTestFixture : public Chip8MachineFixture,
+                                                  public ::testing::WithParamInterface<Emulator::OPCODE_TYPE> {
+};
+TEST_P(UnsupportedOpcodeParameterizedTestFixture, UnsupportedOpcodeInEveryDispatchTableThrows) {
+  Emulator::OPCODE_TYPE bad_opcode = GetParam();
+  EXPECT_THROW(machine.decode(bad_opcode), Emulator::OpcodeNotSupported);
+}
+INSTANTIATE_TEST_SUITE_P
+(
+    UnsupportedOpcodeTests,
+    UnsupportedOpcodeParameterizedTestFixture,
+    ::testing::Values(
+        // High nibble, 8XYN low nibble, EXNN/FXNN low byte and 0NNN gaps
+        0x0123, 0x01E0, 0x5120, 0x812F, 0xE1FF, 0xF1FF
+    )
+);
+
 TEST_F(Chip8MachineFixture, ClearScreenClearsTheScreen) {
   for (int x = 0; x < machine.display_width; x++) {
     for (int y = 0; y < machine.display_height; y++) {
@@ -143,6 +209,85 @@ TEST_F(Chip8MachineFixture, AdvanceExecutesInstructionPointedToByPC) {
   EXPECT_EQ(reg_value, tester.get_v(reg_int));
 }
 
+TEST_F(Chip8MachineFixture, AdvanceExecutesInstructionRewrittenInMemory) {
+  int reg_int = 1;
+  std::vector<unsigned char> rom = {0x61, 0x3F};
+
+  machine.reset();
+  machine.load_rom(rom);
+  machine.advance();
+  EXPECT_EQ(0x3F, tester.get_v(reg_int));
+
+  // Same address, different instruction:  V1 = 0x2A
+  tester.set_memory_byte(TEST_ROM_START_ADDRESS + 1, 0x2A);
+  machine.reset();
+  machine.advance();
+  EXPECT_EQ(0x2A, tester.get_v(reg_int));
+}
+
+TEST_F(Chip8MachineFixture, AdvanceExecutesInstructionFromReloadedROM) {
+  machine.reset();
+  machine.load_rom({0x61, 0x3F});
+  machine.advance();
+
+  machine.reset();
+  machine.load_rom({0x62, 0x3F});
+  machine.advance();
+  EXPECT_EQ(0x3F, tester.get_v(2));
+}
+
+TEST_F(Chip8MachineFixture, AdvanceExecutesInstructionOverwrittenByFX33) {
+  std::vector<unsigned char> rom = {
+      0xF0, 0x33,  // 0x200: BCD of V0 at I
+      0x61, 0x00,  // 0x202: V1 = 0x00, hundreds digit of V0 lands in NN
+  };
+  machine.reset();
+  machine.load_rom(rom);
+  tester.set_v(0, 200);
+  tester.set_i(TEST_ROM_START_ADDRESS + 3);
+
+  // Execute the instruction at 0x202 once before it gets overwritten
+  tester.set_pc(TEST_ROM_START_ADDRESS + 2);
+  machine.advance();
+  EXPECT_EQ(0x00, tester.get_v(1));
+
+  machine.reset();
+  machine.advance();
+  machine.advance();
+  EXPECT_EQ(0x02, tester.get_v(1));
+}
+
+TEST_F(Chip8MachineFixture, ScreenRowsMatchPixels) {
+  machine.reset();
+  tester.set_pixel(1, 5, TEST_ON_PIXEL);
+  tester.set_pixel(62, 5, TEST_ON_PIXEL);
+  EXPECT_EQ(0x4000000000000002u, machine.get_screen()[5]);
+  EXPECT_EQ(0u, machine.get_screen()[4]);
+}
+
+TEST_F(Chip8MachineFixture, DrawingAndClearingMarkRowsDirty) {
+  machine.reset();
+  EXPECT_EQ(Emulator::ALL_ROWS, machine.get_dirty_rows());
+  machine.clear_dirty_rows();
+  tester.set_i(TEST_ROM_START_ADDRESS);
+  tester.set_memory_byte(TEST_ROM_START_ADDRESS, 0xC0);
+  tester.set_memory_byte(TEST_ROM_START_ADDRESS + 1, 0x00);
+  tester.set_v(0, 0x02);
+  machine.decode(0x6104);  // V1 = 0x04
+  machine.decode(0x7005);  // V0 += 0x05
+  EXPECT_FALSE(machine.is_frame_changed());
+
+  machine.decode(0xD012);  // draw 2 rows at (V0, V1)
+  EXPECT_EQ(0x10u, machine.get_dirty_rows());
+  machine.clear_dirty_rows();
+  machine.decode(0x00E0);
+  EXPECT_EQ(0x10u, machine.get_dirty_rows());
+
+  machine.clear_dirty_rows();
+  machine.set_state(machine.get_state());
+  EXPECT_EQ(Emulator::ALL_ROWS, machine.get_dirty_rows());
+}
+
 TEST_F(Chip8MachineFixture, TriggerDelayTimerDoesNothingWhenTimerIsZero) {
   tester.set_delay_timer(0);
   machine.trigger_delay_timer();
@@ -156,6 +301,41 @@ TEST_F(Chip8MachineFixture, TriggerDelayTimerDecrementsTimerWhenTimerGreaterThan
   EXPECT_EQ(some_value - 1, tester.get_delay_timer());
 }
 
+TEST_F(Chip8MachineFixture, RestoringStateUndoesEverySubsequentChange) {
+  machine.reset();
+  machine.load_rom({
+      0x70, 0x01,  // 0x200: V0 += 1
+      0xC1, 0xFF,  // 0x202: V1 = random
+      0x22, 0x08,  // 0x204: call 0x208
+      0x12, 0x00,  // 0x206: jump to 0x200
+      0x00, 0xEE,  // 0x208: return
+  });
+  machine.set_seed(7);
+  tester.set_delay_timer(0x20);
+  tester.set_pixel(3, 4, TEST_ON_PIXEL);
+  machine.run_cycles(5);
+  Emulator::MachineState snapshot = machine.get_state();
+
+  machine.run_cycles(5);
+  Emulator::REG_TYPE random = tester.get_v(1);
+  machine.trigger_delay_timer();
+  machine.clear_screen();
+  tester.set_memory_byte(TEST_ROM_START_ADDRESS + 1, 0x05);
+  machine.run_cycles(5);
+  EXPECT_EQ(0x07, tester.get_v(0));
+
+  machine.set_state(snapshot);
+  EXPECT_EQ(0, std::memcmp(&snapshot, &machine.get_state(), sizeof(snapshot)));
+  EXPECT_EQ(TEST_ON_PIXEL, machine.get_pixel(3, 4));
+  EXPECT_EQ(0x20, tester.get_delay_timer());
+  EXPECT_EQ(0x01, tester.get_memory_byte(TEST_ROM_START_ADDRESS + 1));
+
+  // Instructions decoded before the restore must not be reused
+  machine.run_cycles(5);
+  EXPECT_EQ(0x02, tester.get_v(0));
+  EXPECT_EQ(random, tester.get_v(1));
+}
+
 #ifndef __CLION_IDE_
 #pragma clang diagnostic pop
 #endif
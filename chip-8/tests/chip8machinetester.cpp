@@ -18,8 +18,13 @@ REG_TYPE Chip8MachineTester::get_i() const { return machine->get_i(); }
 
 REG_TYPE Chip8MachineTester::get_flag() const { return machine->get_flag(); }
 
+// Bad register numbers are reported as exceptions, leaving alone any fault
+// raised by the instructions under test
 REG_TYPE Chip8MachineTester::get_v(const int reg_num) const {
-  return machine->get_v(reg_num);
+  bool was_faulted = machine->get_fault().code != Fault::NONE;
+  REG_TYPE value = machine->get_v(reg_num);
+  if (!was_faulted) machine->throw_if_faulted();
+  return value;
 }
 ADDR_TYPE Chip8MachineTester::get_pc() const { return machine->get_pc(); }
 
@@ -31,6 +36,10 @@ REG_TYPE Chip8MachineTester::get_delay_timer() const {
   return machine->get_delay_timer();
 }
 
+REG_TYPE Chip8MachineTester::get_sound_timer() const {
+  return machine->get_sound_timer();
+}
+
 void Chip8MachineTester::set_memory_byte(const ADDR_TYPE address, unsigned char value) {
   machine->set_memory_byte(address, value);
 }
@@ -43,7 +52,9 @@ void Chip8MachineTester::set_i(const REG_TYPE new_value) { machine->set_i(new_va
 void Chip8MachineTester::set_flag(const REG_TYPE new_value) { machine->set_flag(new_value); }
 
 void Chip8MachineTester::set_v(const int reg_num, const REG_TYPE new_value) {
+  bool was_faulted = machine->get_fault().code != Fault::NONE;
   machine->set_v(reg_num, new_value);
+  if (!was_faulted) machine->throw_if_faulted();
 }
 void Chip8MachineTester::set_pc(const ADDR_TYPE new_pc) { machine->set_pc(new_pc); }
 
@@ -55,4 +66,8 @@ void Chip8MachineTester::set_delay_timer(const REG_TYPE new_delay) {
   machine->set_delay_timer(new_delay);
 }
 
+void Chip8MachineTester::set_sound_timer(const REG_TYPE new_sound) {
+  machine->set_sound_timer(new_sound);
+}
+
 }  // namespace Emulator
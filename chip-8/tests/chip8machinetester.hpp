@@ -22,6 +22,7 @@ class Chip8MachineTester {
   ADDR_TYPE get_pc() const;
   ADDR_TYPE get_top_of_stack() const;
   REG_TYPE get_delay_timer() const;
+  REG_TYPE get_sound_timer() const;
 
   void set_memory_byte(ADDR_TYPE, unsigned char);
   void set_pixel(int, int, PIXEL_TYPE);
@@ -31,6 +32,7 @@ class Chip8MachineTester {
   void set_pc(ADDR_TYPE);
   void add_to_stack(ADDR_TYPE);
   void set_delay_timer(REG_TYPE);
+  void set_sound_timer(REG_TYPE);
  private:
   Chip8Machine *machine;
 };
@@ -285,7 +285,17 @@ INSTANTIATE_TEST_SUITE_P
         std::make_tuple(0x8992, 0x71, 0x71, 0x71),
         std::make_tuple(0x8342, 0xD7, 0x59, 0x51),
         std::make_tuple(0x8722, 0x56, 0x57, 0x56),
-        std::make_tuple(0x8B12, 0x70, 0x4F, 0x40)
+        std::make_tuple(0x8B12, 0x70, 0x4F, 0x40),
+        // OR
+        std::make_tuple(0x8001, 0x00, 0x00, 0x00),
+        std::make_tuple(0x8011, 0xF0, 0x0F, 0xFF),
+        std::make_tuple(0x8A31, 0x52, 0x18, 0x5A),
+        std::make_tuple(0x8C61, 0x81, 0x81, 0x81),
+        // XOR
+        std::make_tuple(0x8003, 0xFF, 0xFF, 0x00),
+        std::make_tuple(0x8013, 0xF0, 0x0F, 0xFF),
+        std::make_tuple(0x8A33, 0x52, 0x18, 0x4A),
+        std::make_tuple(0x8C63, 0x81, 0x80, 0x01)
     )
 );
 
@@ -348,7 +358,21 @@ INSTANTIATE_TEST_SUITE_P
         std::make_tuple(0x8625, 0x80, 0x53, 0x2D, 1),
         std::make_tuple(0x83D5, 0x7D, 0xFD, 0x80, 0),
         std::make_tuple(0x8C25, 0xFD, 0xEA, 0x13, 1),
-        std::make_tuple(0x85D5, 0xA8, 0xD2, 0xD6, 0)
+        std::make_tuple(0x85D5, 0xA8, 0xD2, 0xD6, 0),
+        // SUB (VY - VX)
+        std::make_tuple(0x8007, 0x00, 0x00, 0x00, 0),
+        std::make_tuple(0x8017, 0x00, 0xFF, 0xFF, 1),
+        std::make_tuple(0x8017, 0xFF, 0x00, 0x01, 0),
+        std::make_tuple(0x8A17, 0x9C, 0xAD, 0x11, 1),
+        std::make_tuple(0x8627, 0x80, 0x53, 0xD3, 0),
+        // SHR (VX in place, default quirks)
+        std::make_tuple(0x8006, 0x03, 0x03, 0x01, 1),
+        std::make_tuple(0x8016, 0x80, 0x07, 0x40, 0),
+        std::make_tuple(0x8A36, 0xFF, 0x00, 0x7F, 1),
+        // SHL (VX in place, default quirks)
+        std::make_tuple(0x800E, 0x81, 0x81, 0x02, 1),
+        std::make_tuple(0x801E, 0x41, 0x80, 0x82, 0),
+        std::make_tuple(0x8A3E, 0xFF, 0x00, 0xFE, 1)
     )
 );
 
@@ -668,6 +692,31 @@ INSTANTIATE_TEST_SUITE_P
                       std::make_tuple(0xFF15, 0xFA))
 );
 
+class OpcodeFX18ParameterizedTestFixture : public Chip8MachineFixture,
+                                           public ::testing::WithParamInterface< std::tuple<Emulator::OPCODE_TYPE, Emulator::ADDR_TYPE> > {
+};
+TEST_P(OpcodeFX18ParameterizedTestFixture, OpcodeFX18SetsSoundTimerToValueInVRegister) {
+  auto opcode = std::get<0>(GetParam());
+  auto value = std::get<1>(GetParam());
+
+  int v_num = (opcode & 0x0F00) >> 8;
+
+  tester.set_sound_timer(0);
+  tester.set_v(v_num, value);
+
+  machine.decode(opcode);
+  EXPECT_EQ(tester.get_sound_timer(), value);
+}
+INSTANTIATE_TEST_SUITE_P
+(
+    OpcodeFX18Tests,
+    OpcodeFX18ParameterizedTestFixture,
+    ::testing::Values(std::make_tuple(0xF018, 0xFB),
+                      std::make_tuple(0xF318, 0x01),
+                      std::make_tuple(0xF918, 0x3C),
+                      std::make_tuple(0xFF18, 0xFA))
+);
+
 class OpcodeFX07ParameterizedTestFixture : public Chip8MachineFixture,
                                            public ::testing::WithParamInterface< std::tuple<Emulator::OPCODE_TYPE, Emulator::ADDR_TYPE> > {
 };
@@ -693,6 +742,60 @@ INSTANTIATE_TEST_SUITE_P
                       std::make_tuple(0xFF07, 0x89))
 );
 
+// Skips over the next instruction when the key in VX is pressed (EX9E) or
+// released (EXA1)
+class OpcodeEXNNParameterizedTestFixture : public Chip8MachineFixture,
+                                           public ::testing::WithParamInterface< std::tuple<Emulator::OPCODE_TYPE, int, bool, bool> > {
+};
+TEST_P(OpcodeEXNNParameterizedTestFixture, OpcodeEXNNSkipsDependingOnKeyInVRegister) {
+  auto opcode = std::get<0>(GetParam());
+  auto key = std::get<1>(GetParam());
+  auto pressed = std::get<2>(GetParam());
+  auto skips = std::get<3>(GetParam());
+
+  int v_num = (opcode & 0x0F00) >> 8;
+
+  tester.set_pc(TEST_ROM_START_ADDRESS);
+  tester.set_v(v_num, key);
+  machine.set_key(key, pressed);
+  machine.set_key((key + 1) % 16, !pressed);
+
+  machine.decode(opcode);
+  Emulator::ADDR_TYPE expected = TEST_ROM_START_ADDRESS;
+  if (skips) expected += TEST_INSTRUCTION_LENGTH;
+  EXPECT_EQ(tester.get_pc(), expected);
+}
+INSTANTIATE_TEST_SUITE_P
+(
+    OpcodeEXNNTests,
+    OpcodeEXNNParameterizedTestFixture,
+    ::testing::Values(std::make_tuple(0xE09E, 0x0, true, true),
+                      std::make_tuple(0xE59E, 0xA, true, true),
+                      std::make_tuple(0xE59E, 0xA, false, false),
+                      std::make_tuple(0xEF9E, 0xF, false, false),
+                      std::make_tuple(0xE0A1, 0x0, true, false),
+                      std::make_tuple(0xE5A1, 0xA, true, false),
+                      std::make_tuple(0xE5A1, 0xA, false, true),
+                      std::make_tuple(0xEFA1, 0xF, false, true))
+);
+
+TEST_F(Chip8MachineFixture, OpcodeFX0ARepeatsItselfUntilKeyPressed) {
+  tester.set_pc(TEST_ROM_START_ADDRESS + TEST_INSTRUCTION_LENGTH);
+  tester.set_v(3, 0xFF);
+  machine.decode(0xF30A);
+  EXPECT_EQ(tester.get_pc(), TEST_ROM_START_ADDRESS);
+  EXPECT_EQ(tester.get_v(3), 0xFF);
+}
+
+TEST_F(Chip8MachineFixture, OpcodeFX0AStoresLowestPressedKey) {
+  tester.set_pc(TEST_ROM_START_ADDRESS + TEST_INSTRUCTION_LENGTH);
+  machine.set_key(0xC, true);
+  machine.set_key(0x7, true);
+  machine.decode(0xF30A);
+  EXPECT_EQ(tester.get_pc(), TEST_ROM_START_ADDRESS + TEST_INSTRUCTION_LENGTH);
+  EXPECT_EQ(tester.get_v(3), 0x7);
+}
+
 class OpcodeFX29ParameterizedTestFixture : public Chip8MachineFixture,
     public ::testing::WithParamInterface< std::tuple<Emulator::OPCODE_TYPE, Emulator::ADDR_TYPE> > {
 };
@@ -784,10 +887,10 @@ INSTANTIATE_TEST_SUITE_P
 
 namespace {
 // Testing pseudo-randomness is always fun
-// The tests for opcode 0xCXNN assume we are using std::mt19937 as the generator engine,
-// std::uniform_int_distribution(0, 0xFF) as the distribution, and the seed value is
-// fixed to a particular value (here 0 because why not).
-int expected_vals[3] = {0x8C, 0x97, 0xB7};
+// The tests for opcode 0xCXNN assume we are using xorshift32 as the generator engine,
+// keeping the top byte of each output, and the seed value is fixed to a particular
+// value (here 0 because why not).
+int expected_vals[3] = {0x51, 0xE0, 0x7B};
 int seed_val = 0;
 
 class OpcodeCXNNParameterizedTestFixture : public Chip8MachineFixture,
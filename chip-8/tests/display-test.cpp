@@ -48,6 +48,44 @@ TEST_F(DisplayFixture, ClearClearsTheScreen) {
   }
 }
 
+TEST_F(DisplayFixture, RowsArePackedLeftmostPixelFirst) {
+  display.set_pixel(0, 2, TEST_ON_PIXEL);
+  display.set_pixel(63, 2, TEST_ON_PIXEL);
+  EXPECT_EQ(0x8000000000000001u, display.get_row(2));
+  EXPECT_EQ(0u, display.get_rows()[1]);
+}
+
+TEST_F(DisplayFixture, SpriteRowIsXoredAndReportsCollision) {
+  EXPECT_FALSE(display.draw_sprite_row(4, 7, 0xF0));
+  EXPECT_EQ(0x0F00000000000000u, display.get_row(7));
+  EXPECT_TRUE(display.draw_sprite_row(6, 7, 0xF0));
+  EXPECT_EQ(0x0CC0000000000000u, display.get_row(7));
+  EXPECT_EQ(TEST_OFF_PIXEL, display.get_pixel(6, 7));
+  EXPECT_EQ(TEST_ON_PIXEL, display.get_pixel(9, 7));
+}
+
+TEST_F(DisplayFixture, SpriteRowIsClippedOrWrappedAtRightEdge) {
+  display.draw_sprite_row(60, 0, 0xFF);
+  EXPECT_EQ(0x000000000000000Fu, display.get_row(0));
+  display.draw_sprite_row(60, 1, 0xFF, true);
+  EXPECT_EQ(0xF00000000000000Fu, display.get_row(1));
+}
+
+TEST(DisplayTest, NarrowDisplayClipsAndWrapsAtItsWidth) {
+  Emulator::Display display(2, 10);
+  display.draw_sprite_row(6, 0, 0xFF);
+  EXPECT_EQ(0x03C0000000000000u, display.get_row(0));
+  display.draw_sprite_row(6, 1, 0xFF, true);
+  EXPECT_EQ(0xF3C0000000000000u, display.get_row(1));
+
+  display.set_rows({~uint64_t{0}, 0});
+  EXPECT_EQ(0xFFC0000000000000u, display.get_row(0));
+}
+
+TEST(DisplayTest, RowsWiderThanAWordAreRejected) {
+  EXPECT_THROW(Emulator::Display(32, 65), std::invalid_argument);
+}
+
 #ifndef __CLION_IDE_
 #pragma clang diagnostic pop
 #endif
@@ -0,0 +1,55 @@
+#include "framebuffer.hpp"
+
+#include <cstdint>
+
+#include "gtest/gtest.h"
+
+TEST(FrameBufferTest, BuffersAndLinesAreCacheLineAligned) {
+  Emulator::FrameBuffer frame_buffer;
+  EXPECT_TRUE(frame_buffer.set_geometry(100, 30, 2));
+  EXPECT_EQ(frame_buffer.get_width(), 100);
+  EXPECT_EQ(frame_buffer.get_height(), 30);
+  EXPECT_EQ(frame_buffer.get_pitch(), 256u);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(frame_buffer.get_back_buffer())
+                % Emulator::CACHE_LINE_SIZE, 0u);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(frame_buffer.get_front_buffer())
+                % Emulator::CACHE_LINE_SIZE, 0u);
+}
+
+TEST(FrameBufferTest, OnlyReallocatesWhenGeometryChanges) {
+  Emulator::FrameBuffer frame_buffer;
+  frame_buffer.set_geometry(512, 256, 2);
+  void *back = frame_buffer.get_back_buffer();
+  EXPECT_FALSE(frame_buffer.set_geometry(512, 256, 2));
+  EXPECT_EQ(frame_buffer.get_back_buffer(), back);
+  EXPECT_TRUE(frame_buffer.set_geometry(512, 256, 4));
+  EXPECT_EQ(frame_buffer.get_pitch(), 2048u);
+}
+
+TEST(FrameBufferTest, PresentSwapsBuffers) {
+  Emulator::FrameBuffer frame_buffer;
+  frame_buffer.set_geometry(64, 32, 4);
+  void *first = frame_buffer.get_back_buffer();
+  frame_buffer.present();
+  EXPECT_EQ(frame_buffer.get_front_buffer(), first);
+  EXPECT_NE(frame_buffer.get_back_buffer(), first);
+  frame_buffer.present();
+  EXPECT_EQ(frame_buffer.get_back_buffer(), first);
+}
+
+TEST(FrameBufferTest, EachBufferTracksItsOwnStaleRows) {
+  Emulator::FrameBuffer frame_buffer;
+  frame_buffer.set_geometry(64, 32, 2);
+  EXPECT_EQ(frame_buffer.get_stale_rows(), ~uint64_t{0});
+  frame_buffer.present();
+  EXPECT_EQ(frame_buffer.get_stale_rows(), ~uint64_t{0});
+  frame_buffer.present();
+  EXPECT_EQ(frame_buffer.get_stale_rows(), 0u);
+
+  frame_buffer.mark_rows_changed(0x5);
+  frame_buffer.present();
+  frame_buffer.mark_rows_changed(0x8);
+  EXPECT_EQ(frame_buffer.get_stale_rows(), 0xDu);
+  frame_buffer.present();
+  EXPECT_EQ(frame_buffer.get_stale_rows(), 0x8u);
+}
@@ -2,6 +2,10 @@
 #pragma ide diagnostic ignored "cert-err58-cpp"
 #include "../include/libretro.h"
 
+#include <algorithm>
+#include <string>
+#include <vector>
+
 #include "gtest/gtest.h"
 
 #include "chip8machinetester.hpp"
@@ -14,6 +18,16 @@ class RetroFixture : public ::testing::Test {
     chip8machine_init(my_machine);
   }
 
+  // The upscaler and frame budget are shared by every machine, so each test
+  // starts and ends with the defaults
+  void SetUp() override { restore_defaults(); }
+  void TearDown() override { restore_defaults(); }
+
+  static void restore_defaults() {
+    Emulator::chip8machine_set_instructions_per_frame(10);
+    Emulator::chip8machine_set_upscaler(Emulator::Upscaler());
+  }
+
   Emulator::Chip8Machine my_machine;
   Emulator::Chip8MachineTester tester;
 };
@@ -62,23 +76,24 @@ TEST_F(RetroFixture, RetroGetSystemAvInfoSetsProperVariables) {
   chip8machine_get_system_av_info(info, my_machine);
   int height = my_machine.display_height;
   int width = my_machine.display_width;
-  Emulator::Upscaler upscaler;
+  const Emulator::Upscaler &upscaler = Emulator::chip8machine_get_upscaler();
   int x_scale = upscaler.x_scale;
   int y_scale = upscaler.y_scale;
 
   EXPECT_FLOAT_EQ(info->geometry.aspect_ratio, -1.0);
   EXPECT_EQ(info->geometry.base_height, y_scale * height);
   EXPECT_EQ(info->geometry.base_width, x_scale * width);
-  EXPECT_EQ(info->geometry.max_height, y_scale * height);
-  EXPECT_EQ(info->geometry.max_width, x_scale * width);
+  // Room for the largest scale option, so that it can be changed in game
+  EXPECT_EQ(info->geometry.max_height, 10 * height);
+  EXPECT_EQ(info->geometry.max_width, 10 * width);
   EXPECT_FLOAT_EQ(info->timing.fps, 60.0);
   EXPECT_FLOAT_EQ(info->timing.sample_rate, 44100.0);
 }
 
-// We don't need this subroutine for anything, but the RetroArch API
-// requires it, so test only that it exists and can be called
+// Only used to find out whether frames may be duped, test only that it can
+// be called with a frontend which supports nothing
 TEST(RetroSetEnvironment, ExistsAndDoesntCrash) {
-  retro_environment_t environment;
+  retro_environment_t environment = [](unsigned, void *) { return false; };
   retro_set_environment(environment);
 }
 
@@ -96,9 +111,10 @@ TEST(RetroSetAudioSample, Exists) {
   retro_set_audio_sample(audioSample);
 }
 
-// TODO(WPH):  Ignoring audio tests for now
+// Called by chip8machine_run(), so it must be a valid callback
 TEST(RetroSetAudioSampleBatch, Exists) {
-  retro_audio_sample_batch_t audioSampleBatch;
+  retro_audio_sample_batch_t audioSampleBatch =
+      [](const int16_t *, size_t frames) { return frames; };
   retro_set_audio_sample_batch(audioSampleBatch);
 }
 
@@ -261,15 +277,328 @@ TEST_F(RetroFixture, RetroGetMemorySizeReturnsCorrectSize) {
   EXPECT_EQ(expected, actual);
 }
 
-TEST_F(RetroFixture, RetroRunAdvancesOneInstruction) {
+TEST_F(RetroFixture, RetroRunExecutesOneFrameOfInstructions) {
+  EXPECT_EQ(Emulator::chip8machine_get_instructions_per_frame(), 10);
+  std::vector<unsigned char> rom;
+  for (int i = 0; i < 20; i++) {
+    rom.push_back(0x70);  // VA += 1
+    rom.push_back(0x01);
+  }
+  rom[0] = 0x60;  // V0 = 0x20
+  rom[1] = 0x20;
+  rom[2] = 0xF0;  // delay timer = V0
+  rom[3] = 0x15;
+  my_machine.load_rom(rom);
+  chip8machine_run(my_machine, true);
+  EXPECT_EQ(tester.get_pc(), TEST_ROM_START_ADDRESS + 10 * 2);
+  EXPECT_EQ(tester.get_delay_timer(), 0x1F);
+
+  Emulator::chip8machine_set_instructions_per_frame(1);
+  chip8machine_run(my_machine, true);
+  EXPECT_EQ(tester.get_pc(), TEST_ROM_START_ADDRESS + 11 * 2);
+  EXPECT_EQ(tester.get_delay_timer(), 0x1E);
+}
+
+TEST_F(RetroFixture, RetroRunStopsFrameAtUnsupportedInstruction) {
   auto game = new retro_game_info;
   game->size = 4;
-  game->data = static_cast<void *>(new unsigned char[4]{0xDE, 0xAD, 0xBE, 0xEF});
+  game->data = static_cast<void *>(new unsigned char[4]{0x60, 0x01, 0x00, 0x00});
   chip8machine_load_game(game, my_machine);
   chip8machine_run(my_machine, true);
-  Emulator::ADDR_TYPE pc = tester.get_pc();
-  EXPECT_EQ(pc, 0x202);
-  EXPECT_EQ(tester.get_ram()[pc], 0xBE);
+  chip8machine_run(my_machine, true);
+  EXPECT_EQ(tester.get_pc(), 0x202);
+  EXPECT_EQ(my_machine.get_fault().code, Emulator::Fault::UNSUPPORTED_OPCODE);
+}
+
+TEST_F(RetroFixture, RetroResetAndLoadGameClearTheFault) {
+  auto game = new retro_game_info;
+  game->size = 4;
+  game->data = static_cast<void *>(new unsigned char[4]{0x60, 0x01, 0x00, 0x00});
+  chip8machine_load_game(game, my_machine);
+  chip8machine_run(my_machine, true);
+  chip8machine_reset(my_machine);
+  EXPECT_EQ(my_machine.get_fault().code, Emulator::Fault::NONE);
+
+  chip8machine_run(my_machine, true);
+  game->data = static_cast<void *>(new unsigned char[4]{0x61, 0x07, 0x12, 0x02});
+  chip8machine_reset(my_machine);
+  chip8machine_load_game(game, my_machine);
+  chip8machine_run(my_machine, true);
+  EXPECT_EQ(my_machine.get_fault().code, Emulator::Fault::NONE);
+  EXPECT_EQ(tester.get_pc(), 0x202);
+  EXPECT_EQ(tester.get_v(1), 0x07);
+}
+
+namespace {
+const void *last_frame;
+unsigned last_width;
+unsigned last_height;
+size_t last_pitch;
+int n_frames;
+
+void record_frame(const void *data, unsigned width, unsigned height,
+                  size_t pitch) {
+  last_frame = data;
+  last_width = width;
+  last_height = height;
+  last_pitch = pitch;
+  n_frames += 1;
+}
+
+bool supports_dupe(unsigned command, void *data) {
+  if (command != RETRO_ENVIRONMENT_GET_CAN_DUPE) return false;
+  *static_cast<bool *>(data) = true;
+  return true;
+}
+
+bool supports_nothing(unsigned, void *) { return false; }
+
+std::vector<size_t> batch_sizes;
+bool batch_was_silent;
+
+size_t record_audio(const int16_t *data, size_t frames) {
+  batch_sizes.push_back(frames);
+  batch_was_silent = std::all_of(data, data + 2 * frames,
+                                 [](int16_t sample) { return sample == 0; });
+  return frames;
+}
+
+std::vector<std::string> messages;
+
+bool records_messages(unsigned command, void *data) {
+  if (command != RETRO_ENVIRONMENT_SET_MESSAGE) return false;
+  messages.push_back(static_cast<const retro_message *>(data)->msg);
+  return true;
+}
+
+const char *scale_option;
+const char *palette_option;
+std::vector<unsigned> geometry_widths;
+int n_av_info_changes;
+
+bool changes_core_options(unsigned command, void *data) {
+  if (command == RETRO_ENVIRONMENT_GET_VARIABLE_UPDATE) {
+    *static_cast<bool *>(data) = true;
+    return true;
+  }
+  if (command == RETRO_ENVIRONMENT_GET_VARIABLE) {
+    retro_variable *variable = static_cast<retro_variable *>(data);
+    variable->value = nullptr;
+    if (std::string(variable->key) == "chip8_scale") {
+      variable->value = scale_option;
+    } else if (std::string(variable->key) == "chip8_palette") {
+      variable->value = palette_option;
+    }
+    return variable->value != nullptr;
+  }
+  if (command == RETRO_ENVIRONMENT_SET_GEOMETRY) {
+    geometry_widths.push_back(
+        static_cast<const retro_game_geometry *>(data)->base_width);
+    return true;
+  }
+  if (command == RETRO_ENVIRONMENT_SET_SYSTEM_AV_INFO) n_av_info_changes += 1;
+  return false;
+}
+
+std::vector<uint16_t> frontend_memory;
+
+bool supports_software_framebuffer(unsigned command, void *data) {
+  if (command != RETRO_ENVIRONMENT_GET_CURRENT_SOFTWARE_FRAMEBUFFER) {
+    return false;
+  }
+  retro_framebuffer *frontend_buffer = static_cast<retro_framebuffer *>(data);
+  // Lines are padded, as frontends are free to do
+  frontend_memory.assign((frontend_buffer->width + 8)
+                         * frontend_buffer->height, 0x1234);
+  frontend_buffer->data = frontend_memory.data();
+  frontend_buffer->pitch = (frontend_buffer->width + 8) * sizeof(uint16_t);
+  frontend_buffer->format = RETRO_PIXEL_FORMAT_RGB565;
+  return true;
+}
+}  // namespace
+
+TEST_F(RetroFixture, RetroRunPresentsChangedRowsOnly) {
+  my_machine.load_rom({
+      0xA2, 0x00,  // 0x200: I = 0x200
+      0xD0, 0x01,  // 0x202: draw 1 row at (V0, V0)
+      0x60, 0x01,  // 0x204: V0 = 0x01
+  });
+  EXPECT_TRUE(my_machine.is_frame_changed());
+  chip8machine_run(my_machine, true);
+  EXPECT_FALSE(my_machine.is_frame_changed());
+
+  chip8machine_run(my_machine, true);
+  EXPECT_FALSE(my_machine.is_frame_changed());
+  chip8machine_run(my_machine, true);
+  EXPECT_FALSE(my_machine.is_frame_changed());
+}
+
+TEST_F(RetroFixture, RetroRunDupesUnchangedFramesWhenFrontendAllows) {
+  // One instruction per frame, so that each frame makes one change
+  Emulator::chip8machine_set_instructions_per_frame(1);
+  my_machine.load_rom({
+      0x60, 0x01,  // 0x200: V0 = 0x01
+      0xA2, 0x00,  // 0x202: I = 0x200
+      0xD0, 0x01,  // 0x204: draw 1 row at (V0, V0)
+      0x60, 0x02,  // 0x206: V0 = 0x02
+      0x60, 0x03,  // 0x208: V0 = 0x03
+  });
+  retro_set_video_refresh(record_frame);
+  retro_set_environment(supports_dupe);
+  n_frames = 0;
+
+  chip8machine_run(my_machine);
+  EXPECT_NE(nullptr, last_frame);
+  chip8machine_run(my_machine);
+  EXPECT_EQ(nullptr, last_frame);
+  chip8machine_run(my_machine);
+  EXPECT_NE(nullptr, last_frame);
+  chip8machine_run(my_machine);
+  EXPECT_EQ(nullptr, last_frame);
+  EXPECT_EQ(4, n_frames);
+
+  retro_set_environment(supports_nothing);
+  chip8machine_run(my_machine);
+  EXPECT_NE(nullptr, last_frame);
+}
+
+TEST_F(RetroFixture, RetroRunPresentsFramesOfTheConfiguredUpscaler) {
+  Emulator::chip8machine_set_upscaler(Emulator::Upscaler(
+      2, 3, Emulator::PixelFormat::XRGB8888, {0x102030, 0x405060}));
+  my_machine.load_rom({
+      0xA2, 0x00,  // 0x200: I = 0x200
+      0xD0, 0x01,  // 0x202: draw 1 row at (V0, V0)
+  });
+  retro_set_video_refresh(record_frame);
+  retro_set_environment(supports_nothing);
+  chip8machine_run(my_machine);
+  chip8machine_run(my_machine);
+
+  retro_system_av_info info;
+  chip8machine_get_system_av_info(&info, my_machine);
+  EXPECT_EQ(info.geometry.base_width, 2 * my_machine.display_width);
+  EXPECT_EQ(info.geometry.base_height, 3 * my_machine.display_height);
+  EXPECT_EQ(last_width, info.geometry.base_width);
+  EXPECT_EQ(last_height, info.geometry.base_height);
+  EXPECT_EQ(last_pitch, 4 * last_width);
+  // 0xA2 = 0b10100010:  on, off, on
+  const uint32_t *pixels = static_cast<const uint32_t *>(last_frame);
+  EXPECT_EQ(pixels[0], 0x405060u);
+  EXPECT_EQ(pixels[2 * last_width + 1], 0x405060u);
+  EXPECT_EQ(pixels[2], 0x102030u);
+  EXPECT_EQ(pixels[4], 0x405060u);
+  EXPECT_EQ(pixels[3 * last_width], 0x102030u);
+}
+
+TEST_F(RetroFixture, RetroRunChangesGeometryOnlyWhenScaleChanges) {
+  retro_set_video_refresh(record_frame);
+  retro_set_audio_sample_batch(record_audio);
+  retro_set_environment(changes_core_options);
+  geometry_widths.clear();
+  n_av_info_changes = 0;
+  scale_option = "4";
+  palette_option = "white on black";
+  retro_run();
+  retro_run();
+  palette_option = "green on black";
+  retro_run();
+  scale_option = "2";
+  retro_run();
+
+  EXPECT_EQ(geometry_widths, std::vector<unsigned>({4u * 64, 2u * 64}));
+  EXPECT_EQ(n_av_info_changes, 0);
+  retro_set_environment(supports_nothing);
+}
+
+TEST_F(RetroFixture, RetroRunAlternatesBetweenTwoAlignedBuffers) {
+  // One instruction per frame, so that each frame makes one change
+  Emulator::chip8machine_set_instructions_per_frame(1);
+  my_machine.load_rom({
+      0xA2, 0x00,  // 0x200: I = 0x200
+      0xD0, 0x01,  // 0x202: draw 1 row at (V0, V0)
+      0xD0, 0x01,  // 0x204: draw 1 row at (V0, V0)
+  });
+  retro_set_video_refresh(record_frame);
+  retro_set_environment(supports_nothing);
+  chip8machine_run(my_machine);
+  const void *first = last_frame;
+  chip8machine_run(my_machine);
+  const void *second = last_frame;
+  chip8machine_run(my_machine);
+
+  EXPECT_NE(first, second);
+  EXPECT_EQ(last_frame, first);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(first) % Emulator::CACHE_LINE_SIZE,
+            0u);
+  EXPECT_EQ(last_pitch % Emulator::CACHE_LINE_SIZE, 0u);
+  // The sprite was drawn then erased:  the first buffer caught up with both
+  // changes, while the second one still holds the previous frame
+  EXPECT_EQ(static_cast<const uint16_t *>(first)[0], 0x0000);
+  EXPECT_EQ(static_cast<const uint16_t *>(second)[0], 0xFFFF);
+}
+
+TEST_F(RetroFixture, RetroRunRendersIntoFrontendFramebuffer) {
+  my_machine.load_rom({
+      0xA2, 0x00,  // 0x200: I = 0x200
+      0xD0, 0x01,  // 0x202: draw 1 row at (V0, V0)
+  });
+  retro_set_video_refresh(record_frame);
+  retro_set_environment(supports_software_framebuffer);
+  chip8machine_run(my_machine);
+  chip8machine_run(my_machine);
+
+  EXPECT_EQ(last_frame, frontend_memory.data());
+  EXPECT_EQ(last_pitch, (last_width + 8) * sizeof(uint16_t));
+  // 0xA2 = 0b10100010, upscaled 8 times
+  size_t pitch = last_width + 8;
+  EXPECT_EQ(frontend_memory[0], 0xFFFF);
+  EXPECT_EQ(frontend_memory[7 * pitch + 7], 0xFFFF);
+  EXPECT_EQ(frontend_memory[8], 0x0000);
+  EXPECT_EQ(frontend_memory[8 * pitch], 0x0000);
+  EXPECT_EQ(frontend_memory[last_width], 0x1234);
+  retro_set_environment(supports_nothing);
+}
+
+TEST_F(RetroFixture, RetroRunReportsAFaultToTheFrontendOnce) {
+  my_machine.load_rom({
+      0x60, 0x01,  // 0x200: V0 = 0x01
+      0x00, 0x00,  // 0x202: not supported
+  });
+  retro_set_video_refresh(record_frame);
+  retro_set_environment(records_messages);
+  messages.clear();
+  chip8machine_run(my_machine);
+  chip8machine_run(my_machine);
+  ASSERT_EQ(messages.size(), 1u);
+  EXPECT_NE(messages[0].find("unsupported instruction 0000 at 202"),
+            std::string::npos);
+
+  chip8machine_reset(my_machine);
+  chip8machine_run(my_machine);
+  EXPECT_EQ(messages.size(), 2u);
+  retro_set_environment(supports_nothing);
+}
+
+TEST_F(RetroFixture, RetroRunSendsOneAudioBatchPerFrame) {
+  my_machine.load_rom({
+      0x60, 0x01,  // 0x200: V0 = 0x01
+      0x12, 0x02,  // 0x202: jump to self
+      0xF0, 0x18,  // 0x204: sound timer = V0
+  });
+  retro_set_video_refresh(record_frame);
+  retro_set_environment(supports_nothing);
+  retro_set_audio_sample_batch(record_audio);
+  batch_sizes.clear();
+  chip8machine_run(my_machine);
+  EXPECT_TRUE(batch_was_silent);
+
+  tester.set_pc(0x204);
+  chip8machine_run(my_machine);
+  EXPECT_FALSE(batch_was_silent);
+  chip8machine_run(my_machine);
+  EXPECT_TRUE(batch_was_silent);
+  // 44.1 kHz at 60 frames per second
+  EXPECT_EQ(batch_sizes, std::vector<size_t>(3, 735));
 }
 
 int main(int argc, char *argv[]) {
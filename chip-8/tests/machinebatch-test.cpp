@@ -0,0 +1,275 @@
+#pragma clang diagnostic push
+#pragma ide diagnostic ignored "cert-err58-cpp"
+#include "gtest/gtest.h"
+
+#include <vector>
+
+#include "chip8machine.hpp"
+#include "machinebatch.hpp"
+
+#include "test-constants.hpp"
+
+namespace {
+// Touches every instruction the machine supports (except FX0A),
+// with random operands and keys to make machines diverge, and a jump back
+// to the start to bring them back in step
+const std::vector<unsigned char> EVERY_INSTRUCTION_ROM = {
+    0xA3, 0x00,  // 0x200: I = 0x300
+    0xC0, 0xFF,  // 0x202: V0 = random
+    0xC1, 0x3F,  // 0x204: V1 = random & 0x3F
+    0x62, 0x07,  // 0x206: V2 = 0x07
+    0x83, 0x00,  // 0x208: V3 = V0
+    0x83, 0x21,  // 0x20A: V3 |= V2
+    0x84, 0x02,  // 0x20C: V4 &= V0
+    0x84, 0x13,  // 0x20E: V4 ^= V1
+    0x85, 0x04,  // 0x210: V5 += V0
+    0x86, 0x15,  // 0x212: V6 -= V1
+    0x87, 0x27,  // 0x214: V7 = V2 - V7
+    0x88, 0x06,  // 0x216: V8 >>= 1, or V8 = V0 >> 1
+    0x89, 0x1E,  // 0x218: V9 <<= 1, or V9 = V1 << 1
+    0x30, 0x80,  // 0x21A: skip if V0 == 0x80
+    0x40, 0x10,  // 0x21C: skip if V0 != 0x10
+    0x7A, 0x03,  // 0x21E: VA += 0x03
+    0xF0, 0x33,  // 0x220: BCD of V0 at I
+    0xF2, 0x55,  // 0x222: store V0-V2 at I
+    0xF2, 0x65,  // 0x224: load V0-V2 from I
+    0x22, 0x50,  // 0x226: call 0x250
+    0xE1, 0x9E,  // 0x228: skip if key V1 pressed
+    0x6B, 0x01,  // 0x22A: VB = 0x01
+    0xE2, 0xA1,  // 0x22C: skip if key V2 not pressed
+    0x7C, 0x01,  // 0x22E: VC += 0x01
+    0xFD, 0x07,  // 0x230: VD = delay timer
+    0xF5, 0x15,  // 0x232: delay timer = V5
+    0x4D, 0x00,  // 0x234: skip if VD != 0x00
+    0x00, 0xE0,  // 0x236: clear screen
+    0x60, 0x04,  // 0x238: V0 = 0x04
+    0x62, 0x04,  // 0x23A: V2 = 0x04
+    0xB2, 0x40,  // 0x23C: jump to 0x244
+    0x00, 0x00,  // 0x23E
+    0x00, 0x00,  // 0x240
+    0x00, 0x00,  // 0x242
+    0x12, 0x00,  // 0x244: jump to 0x200
+    0x00, 0x00,  // 0x246
+    0x00, 0x00,  // 0x248
+    0x00, 0x00,  // 0x24A
+    0x00, 0x00,  // 0x24C
+    0x00, 0x00,  // 0x24E
+    0xF1, 0x29,  // 0x250: I = V1
+    0xA2, 0x00,  // 0x252: I = 0x200
+    0xD3, 0x45,  // 0x254: draw 5 rows at (V3, V4)
+    0xF6, 0x18,  // 0x256: sound timer = V6
+    0x00, 0xEE,  // 0x258: return
+};
+
+// Not a multiple of the vector width, so that padding is exercised
+const size_t N_MACHINES = 37;
+
+void expect_same_state(const Emulator::MachineState &expected,
+                       const Emulator::MachineState &actual, size_t lane) {
+  SCOPED_TRACE("machine " + std::to_string(lane));
+  for (int reg = 0; reg < Emulator::NUM_V_REGS; reg++) {
+    ASSERT_EQ(expected.v[reg], actual.v[reg]) << "V" << reg;
+  }
+  ASSERT_EQ(expected.i, actual.i);
+  ASSERT_EQ(expected.pc, actual.pc);
+  ASSERT_EQ(expected.sp, actual.sp);
+  ASSERT_EQ(expected.delay_timer, actual.delay_timer);
+  ASSERT_EQ(expected.sound_timer, actual.sound_timer);
+  ASSERT_EQ(expected.rng, actual.rng);
+  ASSERT_EQ(expected.stack, actual.stack);
+  ASSERT_EQ(expected.screen, actual.screen);
+  ASSERT_EQ(expected.ram, actual.ram);
+}
+}  // namespace
+
+class MachineBatchFixture : public ::testing::Test {
+ protected:
+  MachineBatchFixture() { load({0x12, 0x00}); }
+
+  void load(const std::vector<unsigned char> &rom) {
+    prototype.reset();
+    prototype.load_rom(rom);
+  }
+
+  Emulator::Chip8Machine prototype;
+};
+
+class LockstepTest
+    : public ::testing::TestWithParam<Emulator::QuirksProfile> {};
+
+TEST_P(LockstepTest, EveryMachineMatchesAMachineRunAlone) {
+  Emulator::Chip8Machine prototype(GetParam());
+  prototype.reset();
+  prototype.load_rom(EVERY_INSTRUCTION_ROM);
+  Emulator::MachineBatch batch(prototype, N_MACHINES);
+
+  std::vector<Emulator::Chip8Machine> machines;
+  machines.reserve(N_MACHINES);
+  for (size_t lane = 0; lane < N_MACHINES; lane++) {
+    machines.emplace_back(GetParam());
+    Emulator::Chip8Machine &machine = machines.back();
+    machine.set_state(prototype.get_state());
+    // Machines seeded alike stay in step with each other
+    machine.set_seed(lane % 4);
+    batch.set_seed(lane, lane % 4);
+    for (int key : {static_cast<int>(lane % 16), 7}) {
+      bool pressed = (lane % 3) == 0;
+      machine.set_key(key, pressed);
+      batch.set_key(lane, key, pressed);
+    }
+  }
+
+  for (int chunk = 0; chunk < 60; chunk++) {
+    EXPECT_EQ(7u * N_MACHINES, batch.run(7));
+    batch.tick_60hz();
+    for (size_t lane = 0; lane < N_MACHINES; lane++) {
+      for (int step = 0; step < 7; step++) machines[lane].advance();
+      machines[lane].tick_60hz();
+      expect_same_state(machines[lane].get_state(), batch.get_state(lane),
+                        lane);
+      if (HasFatalFailure()) return;
+    }
+  }
+  EXPECT_GT(batch.get_vector_steps(), 0u);
+  EXPECT_GT(batch.get_scalar_steps(), 0u);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    MachineBatchTest, LockstepTest,
+    ::testing::Values(Emulator::QuirksProfile::DEFAULT,
+                      Emulator::QuirksProfile::COSMAC_VIP,
+                      Emulator::QuirksProfile::SUPER_CHIP,
+                      Emulator::QuirksProfile::XO_CHIP));
+
+TEST_F(MachineBatchFixture, MachinesInStepAreExecutedWithVectors) {
+  load({
+      0x70, 0x01,  // 0x200: V0 += 1
+      0x81, 0x04,  // 0x202: V1 += V0
+      0x12, 0x00,  // 0x204: jump to 0x200
+  });
+  Emulator::MachineBatch batch(prototype, 100);
+  EXPECT_EQ(100u * 30, batch.run(30));
+  EXPECT_EQ(100u * 30, batch.get_vector_steps());
+  EXPECT_EQ(0u, batch.get_scalar_steps());
+  for (size_t lane = 0; lane < batch.size(); lane++) {
+    EXPECT_EQ(10, batch.get_state(lane).v[0]);
+    EXPECT_EQ(55, batch.get_state(lane).v[1]);
+  }
+}
+
+TEST_F(MachineBatchFixture, MachinesRewritingTheirCodeExecuteTheirOwnCopy) {
+  load({
+      0xA2, 0x08,  // 0x200: I = 0x208
+      0xF1, 0x55,  // 0x202: store V0-V1 at I
+      0x00, 0xE0,  // 0x204: clear screen
+      0x00, 0xE0,  // 0x206: clear screen
+      0x00, 0xE0,  // 0x208: replaced by V0-V1
+  });
+  Emulator::MachineBatch batch(prototype, 40);
+  Emulator::MachineState state = batch.get_state(0);
+  state.v[0] = 0x6E;  // V0-V1 = 6E 42: VE = 0x42
+  state.v[1] = 0x42;
+  batch.set_state(3, state);
+  batch.run(5);
+  EXPECT_EQ(0x42, batch.get_state(3).v[0xE]);
+  EXPECT_EQ(Emulator::RunStatus::OK, batch.get_status(3));
+  // The others store 00 00, which is not supported
+  EXPECT_EQ(Emulator::RunStatus::UNSUPPORTED_OPCODE, batch.get_status(0));
+  EXPECT_EQ(TEST_ROM_START_ADDRESS + 8, batch.get_fault(0).pc);
+  EXPECT_EQ(TEST_ROM_START_ADDRESS + 8, batch.get_state(0).pc);
+}
+
+TEST_F(MachineBatchFixture, MachinesFollowingARewrittenLeaderExecuteTheirOwnCopy) {
+  load({
+      0x62, 0x05,  // 0x200: V2 = 5
+      0x12, 0x02,  // 0x202: jump to self
+  });
+  Emulator::MachineBatch batch(prototype, 3);
+  Emulator::MachineState state = batch.get_state(0);
+  state.ram[TEST_ROM_START_ADDRESS + 1] = 0x07;  // V2 = 7
+  batch.set_state(0, state);
+  EXPECT_EQ(3u, batch.run(1));
+  EXPECT_EQ(7, batch.get_state(0).v[2]);
+  EXPECT_EQ(5, batch.get_state(1).v[2]);
+  EXPECT_EQ(5, batch.get_state(2).v[2]);
+}
+
+TEST_F(MachineBatchFixture, FaultStopsOnlyTheFaultingMachine) {
+  load({
+      0x22, 0x00,  // 0x200: call 0x200
+  });
+  Emulator::MachineBatch batch(prototype, 3);
+  Emulator::MachineState state = batch.get_state(1);
+  state.pc = TEST_ROM_START_ADDRESS + 2;
+  state.ram[TEST_ROM_START_ADDRESS + 2] = 0x12;  // jump to self
+  state.ram[TEST_ROM_START_ADDRESS + 3] = 0x02;
+  batch.set_state(1, state);
+
+  EXPECT_EQ(3u * TEST_STACK_DEPTH, batch.run(TEST_STACK_DEPTH));
+  // Machines 0 and 2 execute the faulting call only
+  EXPECT_EQ(1u + 5u + 1u, batch.run(5));
+  EXPECT_EQ(Emulator::RunStatus::FAULTED, batch.get_status(0));
+  EXPECT_EQ(Emulator::Fault::STACK_OVERFLOW, batch.get_fault(0).code);
+  EXPECT_EQ(Emulator::RunStatus::OK, batch.get_status(1));
+  EXPECT_EQ(Emulator::Fault::NONE, batch.get_fault(1).code);
+  EXPECT_EQ(TEST_ROM_START_ADDRESS + 2, batch.get_state(1).pc);
+}
+
+TEST_F(MachineBatchFixture, MachineRunningOffTheEndOfRamHalts) {
+  load({
+      0x1F, 0xFF,  // 0x200: jump to 0xFFF, the last byte of RAM
+  });
+  Emulator::MachineBatch batch(prototype, 2);
+  EXPECT_EQ(2u, batch.run(1));
+  EXPECT_EQ(0u, batch.run(10));
+  EXPECT_EQ(Emulator::RunStatus::HALTED, batch.get_status(0));
+  EXPECT_EQ(Emulator::Fault::NONE, batch.get_fault(0).code);
+}
+
+TEST_F(MachineBatchFixture, SetStateRestartsStoppedMachine) {
+  load({0x00, 0x00});
+  Emulator::MachineBatch batch(prototype, 1);
+  batch.run(1);
+  ASSERT_EQ(Emulator::RunStatus::UNSUPPORTED_OPCODE, batch.get_status(0));
+  Emulator::MachineState state = batch.get_state(0);
+  state.ram[TEST_ROM_START_ADDRESS] = 0x12;
+  batch.set_state(0, state);
+  EXPECT_EQ(Emulator::RunStatus::OK, batch.get_status(0));
+  EXPECT_EQ(1u, batch.run(1));
+}
+
+TEST_F(MachineBatchFixture, TimersTickOnlyWhenAsked) {
+  Emulator::MachineBatch batch(prototype, 2);
+  Emulator::MachineState state = batch.get_state(0);
+  state.delay_timer = 2;
+  state.sound_timer = 1;
+  batch.set_state(0, state);
+  batch.run(10);
+  EXPECT_EQ(2, batch.get_state(0).delay_timer);
+  batch.tick_60hz();
+  batch.tick_60hz();
+  EXPECT_EQ(0, batch.get_state(0).delay_timer);
+  EXPECT_EQ(0, batch.get_state(0).sound_timer);
+  EXPECT_EQ(0, batch.get_state(1).delay_timer);
+}
+
+TEST_F(MachineBatchFixture, PixelsAreReadPerMachine) {
+  load({
+      0xA2, 0x06,  // 0x200: I = 0x206
+      0xD0, 0x01,  // 0x202: draw 1 row at (V0, V0)
+      0x12, 0x04,  // 0x204: jump to self
+      0x80, 0x00,  // 0x206: sprite, leftmost pixel on
+  });
+  Emulator::MachineBatch batch(prototype, 2);
+  Emulator::MachineState state = batch.get_state(1);
+  state.v[0] = 3;
+  batch.set_state(1, state);
+  batch.run(3);
+  EXPECT_EQ(TEST_ON_PIXEL, batch.get_pixel(0, 0, 0));
+  EXPECT_EQ(TEST_OFF_PIXEL, batch.get_pixel(1, 0, 0));
+  EXPECT_EQ(TEST_ON_PIXEL, batch.get_pixel(1, 3, 3));
+}
+
+#ifndef __CLION_IDE_
+#pragma clang diagnostic pop
+#endif
@@ -0,0 +1,167 @@
+#pragma clang diagnostic push
+#pragma ide diagnostic ignored "cert-err58-cpp"
+#include "gtest/gtest.h"
+
+#include <vector>
+
+#include "chip8machine.hpp"
+#include "machinefarm.hpp"
+#include "machinestate.hpp"
+
+#include "test-constants.hpp"
+
+namespace {
+// Draws a random sprite at a position set by the keys, forever
+const std::vector<unsigned char> KEY_DRAWING_ROM = {
+    0xC0, 0x3F,  // 0x200: V0 = random & 0x3F
+    0x61, 0x00,  // 0x202: V1 = 0x00
+    0x62, 0x05,  // 0x204: V2 = 0x05
+    0xE2, 0xA1,  // 0x206: skip if key V2 not pressed
+    0x61, 0x10,  // 0x208: V1 = 0x10
+    0xA2, 0x00,  // 0x20A: I = 0x200
+    0xD0, 0x15,  // 0x20C: draw 5 rows at (V0, V1)
+    0x12, 0x00,  // 0x20E: jump to 0x200
+};
+
+// Returns with an empty call stack
+const std::vector<unsigned char> FAULTING_ROM = {
+    0x60, 0x01,  // 0x200: V0 = 0x01
+    0x00, 0xEE,  // 0x202: return
+};
+
+Emulator::FarmJob create_job(const std::vector<unsigned char> &rom,
+                             uint64_t cycle_budget, int seed) {
+  Emulator::FarmJob job;
+  job.rom = rom;
+  job.cycle_budget = cycle_budget;
+  job.seed = seed;
+  return job;
+}
+}  // namespace
+
+class MachineFarmTest : public ::testing::Test {
+ protected:
+  Emulator::MachineFarm farm{3};
+};
+
+TEST_F(MachineFarmTest, HashStateChangesWithTheState) {
+  Emulator::Chip8Machine machine;
+  machine.reset();
+  Emulator::MachineState state = machine.get_state();
+  uint64_t hash = Emulator::hash_state(state);
+  EXPECT_EQ(hash, Emulator::hash_state(machine.get_state()));
+
+  state.frame_cycles += 1;
+  EXPECT_EQ(hash, Emulator::hash_state(state));
+  state.ram[Emulator::RAM_SIZE - 1] ^= 1;
+  EXPECT_NE(hash, Emulator::hash_state(state));
+}
+
+TEST_F(MachineFarmTest, UsesTheRequestedNumberOfWorkers) {
+  EXPECT_EQ(3u, farm.get_n_workers());
+  Emulator::MachineFarm default_farm;
+  EXPECT_GE(default_farm.get_n_workers(), 1u);
+}
+
+TEST_F(MachineFarmTest, ResultsMatchMachinesRunAlone) {
+  const int n_jobs = 20;
+  for (int seed = 0; seed < n_jobs; seed++) {
+    EXPECT_EQ(static_cast<size_t>(seed),
+              farm.submit(create_job(KEY_DRAWING_ROM, 1000, seed)));
+  }
+  std::vector<Emulator::FarmResult> results = farm.wait();
+  ASSERT_EQ(static_cast<size_t>(n_jobs), results.size());
+
+  for (int seed = 0; seed < n_jobs; seed++) {
+    Emulator::Chip8Machine machine;
+    machine.reset();
+    machine.load_rom(KEY_DRAWING_ROM);
+    machine.set_seed(seed);
+    for (int frame = 0; frame < 100; frame++) machine.run_frame(10);
+
+    SCOPED_TRACE("job " + std::to_string(seed));
+    EXPECT_EQ(static_cast<size_t>(seed), results[seed].job);
+    EXPECT_EQ(Emulator::RunStatus::OK, results[seed].status);
+    EXPECT_EQ(1000u, results[seed].cycles);
+    EXPECT_EQ(Emulator::hash_state(machine.get_state()),
+              results[seed].state_hash);
+    EXPECT_EQ(machine.get_state().screen, results[seed].screen);
+  }
+}
+
+TEST_F(MachineFarmTest, InputScriptChangesTheResult) {
+  Emulator::FarmJob idle = create_job(KEY_DRAWING_ROM, 100, 1);
+  Emulator::FarmJob pressed = idle;
+  pressed.inputs = {{3, 0x5, true}, {6, 0x5, false}};
+  farm.submit(idle);
+  farm.submit(pressed);
+  std::vector<Emulator::FarmResult> results = farm.wait();
+  EXPECT_NE(results[0].state_hash, results[1].state_hash);
+
+  Emulator::FarmResult again = Emulator::MachineFarm::run_job(pressed);
+  EXPECT_EQ(results[1].state_hash, again.state_hash);
+}
+
+TEST_F(MachineFarmTest, PartialFramesRespectTheBudget) {
+  Emulator::FarmJob job = create_job(KEY_DRAWING_ROM, 25, 0);
+  job.instructions_per_frame = 10;
+  Emulator::FarmResult result = Emulator::MachineFarm::run_job(job);
+  EXPECT_EQ(25u, result.cycles);
+
+  Emulator::Chip8Machine machine;
+  machine.reset();
+  machine.load_rom(KEY_DRAWING_ROM);
+  machine.set_seed(0);
+  machine.run_frame(10);
+  machine.run_frame(10);
+  machine.run_frame(5);
+  EXPECT_EQ(Emulator::hash_state(machine.get_state()), result.state_hash);
+}
+
+TEST_F(MachineFarmTest, FaultsStopTheJob) {
+  farm.submit(create_job(FAULTING_ROM, 1000, 0));
+  farm.submit(create_job(KEY_DRAWING_ROM, 1000, 0));
+  std::vector<Emulator::FarmResult> results = farm.wait();
+
+  EXPECT_EQ(Emulator::RunStatus::FAULTED, results[0].status);
+  EXPECT_EQ(Emulator::Fault::STACK_UNDERFLOW, results[0].fault.code);
+  EXPECT_EQ(0x202, results[0].fault.pc);
+  EXPECT_EQ(10u, results[0].cycles);
+  EXPECT_EQ(Emulator::RunStatus::OK, results[1].status);
+  EXPECT_EQ(Emulator::Fault::NONE, results[1].fault.code);
+}
+
+TEST_F(MachineFarmTest, WorkerStatsAddUpToTheJobs) {
+  const int n_jobs = 30;
+  for (int seed = 0; seed < n_jobs; seed++) {
+    farm.submit(create_job(KEY_DRAWING_ROM, 500, seed));
+  }
+  farm.wait();
+
+  uint64_t jobs = 0;
+  uint64_t cycles = 0;
+  std::vector<Emulator::WorkerStats> stats = farm.get_worker_stats();
+  ASSERT_EQ(3u, stats.size());
+  for (const Emulator::WorkerStats &worker : stats) {
+    EXPECT_LE(worker.stolen, worker.jobs);
+    jobs += worker.jobs;
+    cycles += worker.cycles;
+  }
+  EXPECT_EQ(static_cast<uint64_t>(n_jobs), jobs);
+  EXPECT_EQ(500u * n_jobs, cycles);
+}
+
+TEST_F(MachineFarmTest, WaitCanBeRepeated) {
+  farm.submit(create_job(KEY_DRAWING_ROM, 100, 0));
+  EXPECT_EQ(1u, farm.wait().size());
+  EXPECT_EQ(0u, farm.wait().size());
+
+  EXPECT_EQ(0u, farm.submit(create_job(KEY_DRAWING_ROM, 100, 7)));
+  EXPECT_EQ(1u, farm.submit(create_job(KEY_DRAWING_ROM, 100, 8)));
+  std::vector<Emulator::FarmResult> results = farm.wait();
+  ASSERT_EQ(2u, results.size());
+  EXPECT_EQ(0u, results[0].job);
+  EXPECT_EQ(1u, results[1].job);
+}
+
+#pragma clang diagnostic pop
@@ -0,0 +1,128 @@
+#pragma clang diagnostic push
+#pragma ide diagnostic ignored "cert-err58-cpp"
+#include "gtest/gtest.h"
+
+#include <sstream>
+
+#include "chip8machine.hpp"
+#include "profiler.hpp"
+
+#include "test-constants.hpp"
+
+namespace {
+const uint8_t LOAD = 0;
+const uint8_t ADD = 1;
+const uint8_t JUMP = 2;
+}  // namespace
+
+class ProfilerFixture : public ::testing::Test {
+ protected:
+  ProfilerFixture() : profiler({"6XNN", "7XNN", "1NNN"}) {}
+
+  // Records a loop of two additions at 0x202, entered from a load at 0x200
+  void record_loop(int n_iterations) {
+    profiler.record(LOAD, 0x200, 10);
+    for (int iteration = 0; iteration < n_iterations; iteration++) {
+      profiler.record(ADD, 0x202, 20);
+      profiler.record(ADD, 0x204, 20);
+      profiler.record(JUMP, 0x206, 5);
+    }
+  }
+
+  Emulator::Profiler profiler;
+};
+
+TEST_F(ProfilerFixture, CountsExecutionsAndTimePerClass) {
+  record_loop(4);
+  EXPECT_EQ(13u, profiler.get_total_executions());
+  std::vector<Emulator::Profiler::ClassStats> classes = profiler.get_classes();
+  ASSERT_EQ(3u, classes.size());
+  EXPECT_EQ("7XNN", classes[0].name);
+  EXPECT_EQ(8u, classes[0].executions);
+  EXPECT_EQ(160u, classes[0].nanoseconds);
+  EXPECT_EQ("1NNN", classes[1].name);
+  EXPECT_EQ("6XNN", classes[2].name);
+  EXPECT_EQ(1u, classes[2].executions);
+}
+
+TEST_F(ProfilerFixture, SortsAddressesByExecutions) {
+  record_loop(3);
+  profiler.record(ADD, 0x204, 20);
+  std::vector<Emulator::Profiler::AddressStats> addresses =
+      profiler.get_hottest_addresses(2);
+  ASSERT_EQ(2u, addresses.size());
+  EXPECT_EQ(0x204u, addresses[0].address);
+  EXPECT_EQ(4u, addresses[0].executions);
+  EXPECT_EQ(0x202u, addresses[1].address);
+}
+
+TEST_F(ProfilerFixture, FindsLoopsFromBackwardJumps) {
+  record_loop(5);
+  std::vector<Emulator::Profiler::LoopStats> loops =
+      profiler.get_hottest_loops(10);
+  ASSERT_EQ(1u, loops.size());
+  EXPECT_EQ(0x202u, loops[0].start);
+  EXPECT_EQ(0x206u, loops[0].end);
+  EXPECT_EQ(4u, loops[0].iterations);
+  EXPECT_EQ(15u, loops[0].executions);
+}
+
+TEST_F(ProfilerFixture, ClearForgetsEverything) {
+  record_loop(5);
+  profiler.clear();
+  EXPECT_EQ(0u, profiler.get_total_executions());
+  EXPECT_TRUE(profiler.get_hottest_addresses(10).empty());
+  EXPECT_TRUE(profiler.get_hottest_loops(10).empty());
+}
+
+TEST_F(ProfilerFixture, WritesEveryClassAddressAndLoopAsJson) {
+  record_loop(2);
+  std::stringstream stream;
+  profiler.write_json(stream);
+  std::string json = stream.str();
+  EXPECT_NE(std::string::npos, json.find("\"executions\": 7,"));
+  EXPECT_NE(std::string::npos,
+            json.find("{\"class\": \"7XNN\", \"executions\": 4, "
+                      "\"nanoseconds\": 80}"));
+  EXPECT_NE(std::string::npos,
+            json.find("{\"address\": 512, \"executions\": 1}"));
+  EXPECT_NE(std::string::npos,
+            json.find("{\"start\": 514, \"end\": 518, \"iterations\": 1, "
+                      "\"executions\": 6}"));
+}
+
+TEST(ProfilerMachineTest, ProfilerIsAvailableWhenCompiledIn) {
+  Emulator::Chip8Machine machine;
+  EXPECT_EQ(Emulator::Profiler::is_enabled(), machine.set_profiler(true));
+  EXPECT_EQ(Emulator::Profiler::is_enabled(),
+            machine.get_profiler() != nullptr);
+  machine.set_profiler(false);
+  EXPECT_EQ(nullptr, machine.get_profiler());
+}
+
+TEST(ProfilerMachineTest, EveryInterpreterRecordsExecutedInstructions) {
+  Emulator::Chip8Machine machine;
+  if (!machine.set_profiler(true)) GTEST_SKIP();
+  machine.load_rom({
+      0x60, 0x05,  // 0x200: V0 = 5
+      0x70, 0x01,  // 0x202: V0 += 1
+      0x12, 0x02,  // 0x204: jump to 0x202
+  });
+  machine.reset();
+  machine.advance();
+  machine.run(4);
+  machine.run_cycles(6);
+
+  const Emulator::Profiler &profiler = *machine.get_profiler();
+  EXPECT_EQ(11u, profiler.get_total_executions());
+  std::vector<Emulator::Profiler::LoopStats> loops =
+      profiler.get_hottest_loops(1);
+  ASSERT_EQ(1u, loops.size());
+  EXPECT_EQ(TEST_ROM_START_ADDRESS + 2, loops[0].start);
+  EXPECT_EQ(TEST_ROM_START_ADDRESS + 4, loops[0].end);
+  EXPECT_EQ(4u, loops[0].iterations);
+}
+
+#ifndef __CLION_IDE_
+#pragma clang diagnostic pop
+#endif
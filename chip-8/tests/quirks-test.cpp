@@ -0,0 +1,197 @@
+#pragma clang diagnostic push
+#pragma ide diagnostic ignored "cert-err58-cpp"
+#include "gtest/gtest.h"
+
+#include "chip8machine.hpp"
+#include "quirks.hpp"
+
+#include "chip8machinetester.hpp"
+#include "test-constants.hpp"
+
+using Emulator::QuirksProfile;
+
+class DetectQuirksParameterizedTestFixture
+    : public ::testing::TestWithParam<std::tuple<std::vector<unsigned char>,
+                                                 QuirksProfile>> {
+};
+TEST_P(DetectQuirksParameterizedTestFixture, DetectsProfileFromInstructionsUsed) {
+  std::vector<unsigned char> rom = std::get<0>(GetParam());
+  QuirksProfile expected = std::get<1>(GetParam());
+  EXPECT_EQ(expected, Emulator::detect_quirks_profile(rom));
+}
+INSTANTIATE_TEST_SUITE_P
+(
+    DetectQuirksTests,
+    DetectQuirksParameterizedTestFixture,
+    ::testing::Values(
+        std::make_tuple(std::vector<unsigned char>{}, QuirksProfile::DEFAULT),
+        std::make_tuple(std::vector<unsigned char>{0x60, 0x05, 0x12, 0x00},
+                        QuirksProfile::DEFAULT),
+        // Sprite data matching a long I load is not taken for XO-CHIP
+        std::make_tuple(std::vector<unsigned char>{0x12, 0x00, 0xF0, 0x00},
+                        QuirksProfile::DEFAULT),
+        // Odd offsets are not instructions
+        std::make_tuple(std::vector<unsigned char>{0x12, 0x00, 0xFF, 0x00},
+                        QuirksProfile::DEFAULT),
+        std::make_tuple(std::vector<unsigned char>{0x00, 0xFF, 0x12, 0x02},
+                        QuirksProfile::SUPER_CHIP),
+        std::make_tuple(std::vector<unsigned char>{0x60, 0x05, 0xF3, 0x75},
+                        QuirksProfile::SUPER_CHIP),
+        std::make_tuple(std::vector<unsigned char>{0x51, 0x22, 0x12, 0x02},
+                        QuirksProfile::XO_CHIP),
+        std::make_tuple(std::vector<unsigned char>{0x00, 0xFF, 0x51, 0x23},
+                        QuirksProfile::XO_CHIP)
+    )
+);
+
+class QuirksFixture : public ::testing::Test {
+ protected:
+  QuirksFixture() {
+    tester.set_machine(&machine);
+  }
+
+  Emulator::Chip8Machine machine;
+  Emulator::Chip8MachineTester tester;
+};
+
+TEST_F(QuirksFixture, DefaultMachineUsesDefaultQuirks) {
+  EXPECT_EQ(QuirksProfile::DEFAULT, machine.get_quirks_profile());
+}
+
+TEST_F(QuirksFixture, SwitchingProfileChangesAlreadyDecodedInstructions) {
+  machine.reset();
+  machine.load_rom({0xF1, 0x65});
+  tester.set_i(0x300);
+  machine.run_cycles(1);
+  EXPECT_EQ(0x300, tester.get_i());
+
+  machine.set_quirks_profile(QuirksProfile::COSMAC_VIP);
+  EXPECT_EQ(QuirksProfile::COSMAC_VIP, machine.get_quirks_profile());
+  machine.reset();
+  machine.run_cycles(1);
+  EXPECT_EQ(0x302, tester.get_i());
+}
+
+// Each quirk is checked for every profile, through both decode() and the
+// cached interpreters, which use separately instantiated handlers
+class QuirksParameterizedTestFixture
+    : public ::testing::TestWithParam<std::tuple<QuirksProfile, bool>> {
+ protected:
+  QuirksParameterizedTestFixture() : machine(std::get<0>(GetParam())) {
+    tester.set_machine(&machine);
+  }
+
+  void execute(Emulator::OPCODE_TYPE opcode) {
+    if (!std::get<1>(GetParam())) {
+      machine.decode(opcode);
+      return;
+    }
+    unsigned char byte_one = (opcode >> 8) & 0x00FF;
+    unsigned char byte_two = opcode & 0x00FF;
+    tester.set_memory_byte(TEST_ROM_START_ADDRESS, byte_one);
+    tester.set_memory_byte(TEST_ROM_START_ADDRESS + 1, byte_two);
+    machine.reset();
+    machine.run(1);
+  }
+
+  QuirksProfile profile() const {
+    return std::get<0>(GetParam());
+  }
+
+  Emulator::Chip8Machine machine;
+  Emulator::Chip8MachineTester tester;
+};
+
+TEST_P(QuirksParameterizedTestFixture, ShiftRightUsesSourceOfProfile) {
+  bool uses_vy = profile() == QuirksProfile::COSMAC_VIP
+      || profile() == QuirksProfile::XO_CHIP;
+  tester.set_v(1, 0x10);
+  tester.set_v(2, 0x03);
+  execute(0x8126);
+  EXPECT_EQ(uses_vy ? 0x01 : 0x08, tester.get_v(1));
+  EXPECT_EQ(uses_vy ? 0x1 : 0x0, tester.get_flag());
+  EXPECT_EQ(0x03, tester.get_v(2));
+}
+
+TEST_P(QuirksParameterizedTestFixture, ShiftLeftUsesSourceOfProfile) {
+  bool uses_vy = profile() == QuirksProfile::COSMAC_VIP
+      || profile() == QuirksProfile::XO_CHIP;
+  tester.set_v(1, 0x41);
+  tester.set_v(2, 0x81);
+  execute(0x812E);
+  EXPECT_EQ(uses_vy ? 0x02 : 0x82, tester.get_v(1));
+  EXPECT_EQ(uses_vy ? 0x1 : 0x0, tester.get_flag());
+}
+
+TEST_P(QuirksParameterizedTestFixture, LoadAndStoreIncrementIForProfile) {
+  bool increments = profile() == QuirksProfile::COSMAC_VIP
+      || profile() == QuirksProfile::XO_CHIP;
+  tester.set_i(0x300);
+  for (int reg_num = 0; reg_num < 3; reg_num++) {
+    tester.set_v(reg_num, 0xA0 + reg_num);
+  }
+  execute(0xF255);
+  for (int reg_num = 0; reg_num < 3; reg_num++) {
+    EXPECT_EQ(0xA0 + reg_num, tester.get_memory_byte(0x300 + reg_num));
+  }
+  EXPECT_EQ(0x00, tester.get_memory_byte(0x303));
+  EXPECT_EQ(increments ? 0x303 : 0x300, tester.get_i());
+
+  tester.set_i(0x301);
+  execute(0xF165);
+  EXPECT_EQ(0xA1, tester.get_v(0));
+  EXPECT_EQ(0xA2, tester.get_v(1));
+  EXPECT_EQ(0xA2, tester.get_v(2));
+  EXPECT_EQ(increments ? 0x303 : 0x301, tester.get_i());
+}
+
+TEST_P(QuirksParameterizedTestFixture, SpritesWrapOrClipForProfile) {
+  bool wraps = profile() == QuirksProfile::XO_CHIP;
+  tester.set_i(0x300);
+  tester.set_memory_byte(0x300, 0xFF);
+  tester.set_memory_byte(0x301, 0xFF);
+  tester.set_v(0, TEST_SCREEN_WIDTH - 4);
+  tester.set_v(1, TEST_SCREEN_HEIGHT - 1);
+  execute(0xD012);
+  EXPECT_EQ(TEST_ON_PIXEL, machine.get_pixel(TEST_SCREEN_WIDTH - 1,
+                                             TEST_SCREEN_HEIGHT - 1));
+  int wrapped = wraps ? TEST_ON_PIXEL : TEST_OFF_PIXEL;
+  EXPECT_EQ(wrapped, machine.get_pixel(3, TEST_SCREEN_HEIGHT - 1));
+  EXPECT_EQ(wrapped, machine.get_pixel(TEST_SCREEN_WIDTH - 1, 0));
+  EXPECT_EQ(wrapped, machine.get_pixel(3, 0));
+  EXPECT_EQ(TEST_OFF_PIXEL, machine.get_pixel(4, 0));
+}
+
+TEST_P(QuirksParameterizedTestFixture, LogicOperationsResetFlagForProfile) {
+  bool resets = profile() == QuirksProfile::COSMAC_VIP;
+  for (Emulator::OPCODE_TYPE opcode : {0x8121, 0x8122, 0x8123}) {
+    tester.set_v(1, 0x0F);
+    tester.set_v(2, 0x3C);
+    tester.set_flag(0x7);
+    execute(opcode);
+    EXPECT_EQ(resets ? 0x0 : 0x7, tester.get_flag());
+  }
+  EXPECT_EQ(0x0F ^ 0x3C, tester.get_v(1));
+}
+
+TEST_P(QuirksParameterizedTestFixture, JumpWithOffsetUsesRegisterOfProfile) {
+  bool uses_vx = profile() == QuirksProfile::SUPER_CHIP;
+  tester.set_v(0, 0x02);
+  tester.set_v(3, 0x10);
+  execute(0xB304);
+  EXPECT_EQ(uses_vx ? 0x314 : 0x306, tester.get_pc());
+}
+INSTANTIATE_TEST_SUITE_P
+(
+    QuirksTests,
+    QuirksParameterizedTestFixture,
+    ::testing::Combine(
+        ::testing::Values(QuirksProfile::DEFAULT, QuirksProfile::COSMAC_VIP,
+                          QuirksProfile::SUPER_CHIP, QuirksProfile::XO_CHIP),
+        ::testing::Bool()
+    )
+);
+
+#ifndef __CLION_IDE_
+#pragma clang diagnostic pop
+#endif
@@ -0,0 +1,65 @@
+#pragma clang diagnostic push
+#pragma ide diagnostic ignored "cert-err58-cpp"
+#include "gtest/gtest.h"
+
+#include <chrono>  // NOLINT
+
+#include "chip8machine.hpp"
+#include "realtimedriver.hpp"
+
+class RealTimeDriverFixture : public ::testing::Test {
+ protected:
+  RealTimeDriverFixture() : driver(machine), origin() {
+    machine.reset();
+    Emulator::MachineState state = machine.get_state();
+    state.delay_timer = 0xFF;
+    machine.set_state(state);
+    driver.start(origin);
+  }
+
+  Emulator::RealTimeDriver::Clock::time_point after(int milliseconds) const {
+    return origin + std::chrono::milliseconds(milliseconds);
+  }
+
+  Emulator::Chip8Machine machine;
+  Emulator::RealTimeDriver driver;
+  Emulator::RealTimeDriver::Clock::time_point origin;
+};
+
+TEST_F(RealTimeDriverFixture, NothingTicksBeforeFirstPeriodEnds) {
+  EXPECT_EQ(0, driver.sync(after(16)));
+  EXPECT_EQ(0xFF, machine.get_state().delay_timer);
+}
+
+TEST_F(RealTimeDriverFixture, TicksOncePerSixtiethOfASecond) {
+  EXPECT_EQ(1, driver.sync(after(17)));
+  EXPECT_EQ(0xFE, machine.get_state().delay_timer);
+  EXPECT_EQ(59, driver.sync(after(1000)));
+  EXPECT_EQ(60u, driver.get_ticks());
+  EXPECT_EQ(0xFF - 60, machine.get_state().delay_timer);
+}
+
+TEST_F(RealTimeDriverFixture, IrregularCallsDoNotDrift) {
+  int n_ticks = 0;
+  for (int milliseconds = 7; milliseconds <= 10000; milliseconds += 7) {
+    n_ticks += driver.sync(after(milliseconds));
+  }
+  // 9996 ms hold 599.76 periods
+  EXPECT_EQ(599, n_ticks);
+}
+
+TEST_F(RealTimeDriverFixture, EarlierTimesTickNothing) {
+  driver.sync(after(100));
+  EXPECT_EQ(0, driver.sync(after(50)));
+  EXPECT_EQ(0, driver.sync(origin - std::chrono::seconds(1)));
+  EXPECT_EQ(6u, driver.get_ticks());
+}
+
+TEST_F(RealTimeDriverFixture, StartRestartsCounting) {
+  driver.sync(after(100));
+  driver.start(after(100));
+  EXPECT_EQ(0u, driver.get_ticks());
+  EXPECT_EQ(1, driver.sync(after(117)));
+}
+
+#pragma clang diagnostic pop
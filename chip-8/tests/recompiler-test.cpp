@@ -0,0 +1,240 @@
+#pragma clang diagnostic push
+#pragma ide diagnostic ignored "cert-err58-cpp"
+#include "gtest/gtest.h"
+
+#include "chip8machine.hpp"
+#include "recompiler.hpp"
+
+#include "chip8machinetester.hpp"
+#include "test-constants.hpp"
+
+namespace {
+const int N_STEPS = 64;
+const int CYCLES_PER_STEP = 3;
+const Emulator::ADDR_TYPE DATA_ADDRESS = 0x300;
+}  // namespace
+
+// Runs the same program on a machine using the recompiler and on one using
+// the interpreter, comparing the full observable state after every step
+class RecompilerLockstepFixture : public ::testing::Test {
+ protected:
+  RecompilerLockstepFixture() {
+    tester.set_machine(&machine);
+    reference_tester.set_machine(&reference);
+    recompiler_enabled = machine.set_recompiler(true);
+    reference.set_recompiler(false);
+  }
+
+  void load(const std::vector<unsigned char> &rom) {
+    for (Emulator::Chip8Machine *current : {&machine, &reference}) {
+      current->reset();
+      current->load_rom(rom);
+      current->set_seed(0);
+    }
+    for (Emulator::Chip8MachineTester *current : {&tester, &reference_tester}) {
+      current->set_i(DATA_ADDRESS);
+      for (int offset = 0; offset < 0x10; offset++) {
+        current->set_memory_byte(DATA_ADDRESS + offset, 0xA5 ^ offset);
+      }
+    }
+  }
+
+  void set_v(int reg_num, Emulator::REG_TYPE value) {
+    tester.set_v(reg_num, value);
+    reference_tester.set_v(reg_num, value);
+  }
+
+  void run_in_lockstep() {
+    for (int step = 0; step < N_STEPS; step++) {
+      machine.run_cycles(CYCLES_PER_STEP);
+      reference.run_cycles(CYCLES_PER_STEP);
+      ASSERT_EQ(tester.get_pc(), reference_tester.get_pc()) << "step " << step;
+      ASSERT_EQ(tester.get_i(), reference_tester.get_i()) << "step " << step;
+      for (int reg_num = 0; reg_num < TEST_NUM_REGISTERS; reg_num++) {
+        ASSERT_EQ(tester.get_v(reg_num), reference_tester.get_v(reg_num))
+            << "step " << step << ", V" << reg_num;
+      }
+      ASSERT_EQ(tester.get_delay_timer(), reference_tester.get_delay_timer());
+      ASSERT_EQ(tester.get_ram(), reference_tester.get_ram());
+      ASSERT_EQ(machine.display_str(), reference.display_str());
+    }
+  }
+
+  bool recompiler_enabled;
+  Emulator::Chip8Machine machine;
+  Emulator::Chip8MachineTester tester;
+  Emulator::Chip8Machine reference;
+  Emulator::Chip8MachineTester reference_tester;
+};
+
+TEST_F(RecompilerLockstepFixture, RecompilerIsUsedWhenSupported) {
+  EXPECT_EQ(recompiler_enabled, Emulator::Recompiler::is_supported());
+}
+
+TEST_F(RecompilerLockstepFixture, SubroutineCallsMatchInterpreter) {
+  load({
+      0x22, 0x06,  // 0x200: call 0x206
+      0x70, 0x01,  // 0x202: V0 += 1
+      0x12, 0x00,  // 0x204: jump to 0x200
+      0x81, 0x04,  // 0x206: V1 += V0
+      0x00, 0xEE,  // 0x208: return
+  });
+  run_in_lockstep();
+}
+
+TEST_F(RecompilerLockstepFixture, LogicOperationsMatchInterpreterWithVipQuirks) {
+  machine.set_quirks_profile(Emulator::QuirksProfile::COSMAC_VIP);
+  reference.set_quirks_profile(Emulator::QuirksProfile::COSMAC_VIP);
+  load({
+      0x6F, 0x07,  // 0x200: VF = 0x07
+      0x81, 0x21,  // 0x202: V1 |= V2, VF = 0
+      0x6F, 0x07,  // 0x204: VF = 0x07
+      0x81, 0x32,  // 0x206: V1 &= V3, VF = 0
+      0x6F, 0x07,  // 0x208: VF = 0x07
+      0x81, 0x43,  // 0x20A: V1 ^= V4, VF = 0
+      0x12, 0x00,  // 0x20C: jump to 0x200
+  });
+  set_v(2, 0x3C);
+  set_v(3, 0x0F);
+  set_v(4, 0x55);
+  run_in_lockstep();
+}
+
+// Every opcode (and register contents) exercised by decoder-test.cpp, placed
+// in a loop so that the recompiler sees it often enough to compile it
+class RecompilerLockstepParameterizedTestFixture
+    : public RecompilerLockstepFixture,
+      public ::testing::WithParamInterface<std::tuple<Emulator::OPCODE_TYPE,
+                                                      Emulator::REG_TYPE,
+                                                      Emulator::REG_TYPE>> {
+};
+TEST_P(RecompilerLockstepParameterizedTestFixture, OpcodeInLoopMatchesInterpreter) {
+  Emulator::OPCODE_TYPE opcode = std::get<0>(GetParam());
+  Emulator::REG_TYPE value_x = std::get<1>(GetParam());
+  Emulator::REG_TYPE value_y = std::get<2>(GetParam());
+  int reg_num_x = (opcode & 0x0F00) >> 8;
+  int reg_num_y = (opcode & 0x00F0) >> 4;
+
+  unsigned char byte_one = (opcode >> 8) & 0x00FF;
+  unsigned char byte_two = opcode & 0x00FF;
+  // Skips land on the second jump
+  load({byte_one, byte_two, 0x12, 0x00, 0x12, 0x00});
+  set_v(reg_num_y, value_y);
+  set_v(reg_num_x, value_x);
+  run_in_lockstep();
+}
+INSTANTIATE_TEST_SUITE_P
+(
+    RecompilerLockstepTests,
+    RecompilerLockstepParameterizedTestFixture,
+    ::testing::Values(
+        // 00E0
+        std::make_tuple(0x00E0, 0x00, 0x00),
+        // ANNN
+        std::make_tuple(0xA000, 0x00, 0x00),
+        std::make_tuple(0xABFA, 0x00, 0x00),
+        std::make_tuple(0xA212, 0x00, 0x00),
+        std::make_tuple(0xAFFF, 0x00, 0x00),
+        // 3XNN, taken and not taken
+        std::make_tuple(0x3B83, 0x83, 0x83),
+        std::make_tuple(0x3029, 0x2A, 0x2A),
+        std::make_tuple(0x3898, 0x98, 0x98),
+        std::make_tuple(0x3630, 0x31, 0x31),
+        // 4XNN, taken and not taken
+        std::make_tuple(0x42CC, 0xCC, 0xCC),
+        std::make_tuple(0x4528, 0x29, 0x29),
+        std::make_tuple(0x486C, 0x6C, 0x6C),
+        std::make_tuple(0x4B1E, 0x1F, 0x1F),
+        // 6XNN
+        std::make_tuple(0x6000, 0xFF, 0xFF),
+        std::make_tuple(0x6366, 0x00, 0x00),
+        std::make_tuple(0x6AF7, 0x00, 0x00),
+        std::make_tuple(0x6FFF, 0x00, 0x00),
+        // 7XNN
+        std::make_tuple(0x7000, 0x00, 0x00),
+        std::make_tuple(0x7900, 0x9D, 0x9D),
+        std::make_tuple(0x73EF, 0x00, 0x00),
+        std::make_tuple(0x7C38, 0x6F, 0x6F),
+        std::make_tuple(0x7F65, 0xA2, 0xA2),
+        // 8XYZ without carry
+        std::make_tuple(0x8000, 0x00, 0x00),
+        std::make_tuple(0x8000, 0xFF, 0xFF),
+        std::make_tuple(0x8010, 0x00, 0xFF),
+        std::make_tuple(0x8010, 0xFF, 0x00),
+        std::make_tuple(0x8010, 0xFF, 0xFF),
+        std::make_tuple(0x82F0, 0x02, 0xDF),
+        std::make_tuple(0x80C0, 0xAA, 0xCD),
+        std::make_tuple(0x8630, 0x4C, 0xA2),
+        std::make_tuple(0x8840, 0x1B, 0x6F),
+        std::make_tuple(0x8960, 0x67, 0x73),
+        std::make_tuple(0x8002, 0x00, 0x00),
+        std::make_tuple(0x8002, 0xFF, 0xFF),
+        std::make_tuple(0x8012, 0x00, 0xFF),
+        std::make_tuple(0x8012, 0xFF, 0x00),
+        std::make_tuple(0x8012, 0xFF, 0xFF),
+        std::make_tuple(0x8282, 0xE4, 0xB9),
+        std::make_tuple(0x8992, 0x71, 0x71),
+        std::make_tuple(0x8342, 0xD7, 0x59),
+        std::make_tuple(0x8722, 0x56, 0x57),
+        std::make_tuple(0x8B12, 0x70, 0x4F),
+        std::make_tuple(0x8011, 0xF0, 0x0F),
+        std::make_tuple(0x8A31, 0x52, 0x18),
+        std::make_tuple(0x8013, 0xF0, 0x0F),
+        std::make_tuple(0x8C63, 0x81, 0x80),
+        std::make_tuple(0x8F13, 0x81, 0x80),
+        // 8XYZ with carry
+        std::make_tuple(0x8004, 0x00, 0x00),
+        std::make_tuple(0x8004, 0xFF, 0xFF),
+        std::make_tuple(0x8014, 0x00, 0xFF),
+        std::make_tuple(0x8014, 0xFF, 0x00),
+        std::make_tuple(0x8014, 0xFF, 0xFF),
+        std::make_tuple(0x89D4, 0xB2, 0x05),
+        std::make_tuple(0x8874, 0x10, 0x1E),
+        std::make_tuple(0x8BC4, 0xBB, 0x4D),
+        std::make_tuple(0x8A44, 0xD4, 0xEB),
+        std::make_tuple(0x8554, 0x06, 0x06),
+        std::make_tuple(0x8005, 0x00, 0x00),
+        std::make_tuple(0x8005, 0xFF, 0xFF),
+        std::make_tuple(0x8015, 0x00, 0xFF),
+        std::make_tuple(0x8015, 0xFF, 0x00),
+        std::make_tuple(0x8015, 0xFF, 0xFF),
+        std::make_tuple(0x8A15, 0x9C, 0xAD),
+        std::make_tuple(0x8625, 0x80, 0x53),
+        std::make_tuple(0x83D5, 0x7D, 0xFD),
+        std::make_tuple(0x8C25, 0xFD, 0xEA),
+        std::make_tuple(0x85D5, 0xA8, 0xD2),
+        std::make_tuple(0x8A17, 0x9C, 0xAD),
+        std::make_tuple(0x8A36, 0xFF, 0x00),
+        std::make_tuple(0x801E, 0x41, 0x80),
+        // 8XYZ with register values above 0xFF, as set by FX29 tests
+        std::make_tuple(0x8014, 0x2E12, 0x27AE),
+        std::make_tuple(0x8015, 0x27E7, 0x22BE),
+        // DXYN
+        std::make_tuple(0xD131, 0x02, 0x04),
+        std::make_tuple(0xD138, 0x02, 0x04),
+        std::make_tuple(0xD13F, 0x02, 0x04),
+        std::make_tuple(0xD12A, 0x39, 0x01),
+        std::make_tuple(0xDBDF, 0x25, 0x13),
+        // CXNN
+        std::make_tuple(0xC0FF, 0x00, 0x00),
+        std::make_tuple(0xC6FF, 0x00, 0x00),
+        std::make_tuple(0xC300, 0x00, 0x00),
+        std::make_tuple(0xCC21, 0x00, 0x00),
+        std::make_tuple(0xCF56, 0x00, 0x00),
+        // FX07, FX15, FX29, FX33, FX65
+        std::make_tuple(0xF007, 0x00, 0x00),
+        std::make_tuple(0xF215, 0x86, 0x86),
+        std::make_tuple(0xF929, 0x27AE, 0x27AE),
+        std::make_tuple(0xFA33, 0x00, 0x00),
+        std::make_tuple(0xF733, 0x07, 0x07),
+        std::make_tuple(0xFB33, 0x62, 0x62),
+        std::make_tuple(0xF933, 0xFF, 0xFF),
+        std::make_tuple(0xF065, 0x00, 0x00),
+        std::make_tuple(0xF565, 0x00, 0x00),
+        std::make_tuple(0xFF65, 0x00, 0x00)
+    )
+);
+
+#ifndef __CLION_IDE_
+#pragma clang diagnostic pop
+#endif
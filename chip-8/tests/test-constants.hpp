@@ -7,6 +7,7 @@
 #define TEST_RAM_SIZE 0x1000
 
 #define TEST_NUM_REGISTERS 16
+#define TEST_STACK_DEPTH 16
 
 #define TEST_OFF_PIXEL 0
 #define TEST_ON_PIXEL 1
@@ -0,0 +1,59 @@
+#pragma clang diagnostic push
+#pragma ide diagnostic ignored "cert-err58-cpp"
+#include "gtest/gtest.h"
+
+#include "chip8machine.hpp"
+
+#include "chip8machinetester.hpp"
+#include "test-constants.hpp"
+#include "utilities.hpp"
+
+class ThreadedInterpreterFixture : public Emulator::LockstepFixture {};
+
+class RunParameterizedTestFixture : public ThreadedInterpreterFixture,
+                                    public ::testing::WithParamInterface<int> {
+};
+TEST_P(RunParameterizedTestFixture, RunMatchesRepeatedAdvance) {
+  int n_instructions = GetParam();
+  load(Emulator::LOOP_ROM);
+  machine.run(n_instructions);
+  for (int i = 0; i < n_instructions; i++) {
+    reference.advance();
+  }
+  expect_same_state();
+}
+INSTANTIATE_TEST_SUITE_P
+(
+    RunTests,
+    RunParameterizedTestFixture,
+    ::testing::Values(0, 1, 2, 5, 8, 17, 40)
+);
+
+TEST_F(ThreadedInterpreterFixture, RunExecutesInstructionAtOddAddress) {
+  load({0x12, 0x03, 0x00, 0x61, 0x2A});  // jump to 0x203: V1 = 0x2A
+  machine.run(2);
+  EXPECT_EQ(0x2A, tester.get_v(1));
+  EXPECT_EQ(TEST_ROM_START_ADDRESS + 5, tester.get_pc());
+}
+
+TEST_F(ThreadedInterpreterFixture, RunExecutesCodeOverwrittenByFX33) {
+  std::vector<unsigned char> rom = {
+      0xF0, 0x33,  // 0x200: BCD of V0 at I = 0x203, overwrites NN below
+      0x61, 0x00,  // 0x202: V1 = hundreds digit of V0
+  };
+  load(rom);
+  tester.set_v(0, 200);
+  tester.set_i(TEST_ROM_START_ADDRESS + 3);
+  machine.run(2);
+  EXPECT_EQ(0x02, tester.get_v(1));
+}
+
+TEST_F(ThreadedInterpreterFixture, RunThrowsOnUnsupportedOpcode) {
+  load({0x61, 0x01, 0x90, 0x00});
+  EXPECT_THROW(machine.run(2), Emulator::OpcodeNotSupported);
+  EXPECT_EQ(0x01, tester.get_v(1));
+}
+
+#ifndef __CLION_IDE_
+#pragma clang diagnostic pop
+#endif
@@ -0,0 +1,145 @@
+#pragma clang diagnostic push
+#pragma ide diagnostic ignored "cert-err58-cpp"
+#include "gtest/gtest.h"
+
+#include <chrono>  // NOLINT
+#include <memory>
+#include <thread>  // NOLINT
+
+#include "chip8machine.hpp"
+#include "timerservice.hpp"
+
+namespace {
+// Fast enough for tests to see many ticks without sleeping for long
+const int TEST_TICKS_PER_SECOND = 1000;
+
+void set_delay_timer(Emulator::Chip8Machine *machine,
+                     Emulator::REG_TYPE value) {
+  Emulator::MachineState state = machine->get_state();
+  state.delay_timer = value;
+  machine->set_state(state);
+}
+
+// Sleeps until a subscription has received a few ticks, or gives up
+void wait_for_ticks(const Emulator::TimerSubscription &subscription) {
+  for (int attempt = 0; attempt < 200; attempt++) {
+    if (subscription.get_pending() >= 5) return;
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+}
+}  // namespace
+
+class TimerServiceFixture : public ::testing::Test {
+ protected:
+  TimerServiceFixture() : service(TEST_TICKS_PER_SECOND) {
+    machine.reset();
+    set_delay_timer(&machine, 0xFF);
+  }
+
+  Emulator::TimerService service;
+  Emulator::Chip8Machine machine;
+};
+
+TEST(TimerServiceTest, ProcessWideServiceTicksAt60Hz) {
+  Emulator::TimerService &service = Emulator::TimerService::get_instance();
+  EXPECT_EQ(&service, &Emulator::TimerService::get_instance());
+  EXPECT_EQ(60, service.get_ticks_per_second());
+}
+
+TEST_F(TimerServiceFixture, TicksArePendingUntilApplied) {
+  std::unique_ptr<Emulator::TimerSubscription> subscription =
+      service.subscribe(machine);
+  wait_for_ticks(*subscription);
+  EXPECT_EQ(0xFF, machine.get_state().delay_timer);
+
+  int n_ticks = subscription->apply();
+  EXPECT_GE(n_ticks, 5);
+  EXPECT_EQ(0xFF - n_ticks, machine.get_state().delay_timer);
+  EXPECT_LE(static_cast<uint64_t>(n_ticks), service.get_ticks());
+}
+
+// Services without a thread are driven by sync(), so that schedules can be
+// tested without sleeping
+class ManualTimerServiceFixture : public ::testing::Test {
+ protected:
+  ManualTimerServiceFixture()
+      : service(TEST_TICKS_PER_SECOND, false),
+        origin(Emulator::TimerService::Clock::now()) {
+    machine.reset();
+    set_delay_timer(&machine, 0xFF);
+    service.start(origin);
+  }
+
+  // Time elapsed since the start of the schedule, in microseconds
+  Emulator::TimerService::Clock::time_point at(const int64_t microseconds) {
+    return origin + std::chrono::microseconds(microseconds);
+  }
+
+  Emulator::TimerService service;
+  Emulator::TimerService::Clock::time_point origin;
+  Emulator::Chip8Machine machine;
+};
+
+TEST_F(ManualTimerServiceFixture, EveryMachineIsTicked) {
+  Emulator::Chip8Machine other;
+  other.reset();
+  set_delay_timer(&other, 0xFF);
+  std::unique_ptr<Emulator::TimerSubscription> first =
+      service.subscribe(machine);
+  std::unique_ptr<Emulator::TimerSubscription> second =
+      service.subscribe(other);
+  EXPECT_EQ(2u, service.get_n_subscribers());
+
+  EXPECT_EQ(5u, service.sync(at(5000)));
+  EXPECT_EQ(5, first->apply());
+  EXPECT_EQ(5, second->apply());
+  EXPECT_EQ(0xFF - 5, other.get_state().delay_timer);
+}
+
+TEST_F(ManualTimerServiceFixture, DestroyedSubscriptionsStopTicking) {
+  std::unique_ptr<Emulator::TimerSubscription> subscription =
+      service.subscribe(machine);
+  EXPECT_EQ(1u, service.get_n_subscribers());
+  subscription.reset();
+  EXPECT_EQ(0u, service.get_n_subscribers());
+
+  EXPECT_EQ(0u, service.sync(at(20000)));
+  EXPECT_EQ(0xFF, machine.get_state().delay_timer);
+  EXPECT_EQ(0u, service.get_ticks());
+}
+
+TEST_F(ManualTimerServiceFixture, LateWakeUpsDeliverTicksTogether) {
+  std::unique_ptr<Emulator::TimerSubscription> subscription =
+      service.subscribe(machine);
+  EXPECT_EQ(0u, service.sync(at(500)));
+  EXPECT_EQ(1u, service.sync(at(1000)));
+  EXPECT_EQ(0u, service.get_missed_ticks());
+
+  // Ticks due at 2, 3 and 4 ms
+  EXPECT_EQ(3u, service.sync(at(4500)));
+  EXPECT_EQ(2u, service.get_missed_ticks());
+  EXPECT_EQ(4u, service.get_ticks());
+  EXPECT_EQ(4u, subscription->get_pending());
+}
+
+TEST_F(ManualTimerServiceFixture, StallsOverOneSecondDropExcessTicks) {
+  std::unique_ptr<Emulator::TimerSubscription> subscription =
+      service.subscribe(machine);
+  EXPECT_EQ(static_cast<uint32_t>(TEST_TICKS_PER_SECOND),
+            service.sync(at(2500000)));
+  EXPECT_EQ(2499u, service.get_missed_ticks());
+  EXPECT_EQ(static_cast<uint64_t>(TEST_TICKS_PER_SECOND),
+            service.get_ticks());
+
+  // The schedule goes on from the time of the stall
+  EXPECT_EQ(1u, service.sync(at(2501000)));
+  EXPECT_EQ(2499u, service.get_missed_ticks());
+}
+
+TEST_F(TimerServiceFixture, IdleServiceDeliversNothing) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_EQ(0u, service.get_ticks());
+  EXPECT_EQ(0u, service.get_missed_ticks());
+}
+
+#pragma clang diagnostic pop
@@ -0,0 +1,186 @@
+#pragma clang diagnostic push
+#pragma ide diagnostic ignored "cert-err58-cpp"
+#include "gtest/gtest.h"
+
+#include "chip8machine.hpp"
+
+#include "chip8machinetester.hpp"
+#include "test-constants.hpp"
+
+namespace {
+// Counts iterations in V0
+const std::vector<unsigned char> COUNTING_ROM = {
+    0x70, 0x01,  // 0x200: V0 += 1
+    0x12, 0x00,  // 0x202: jump to 0x200
+};
+}  // namespace
+
+class TimingFixture : public ::testing::Test {
+ protected:
+  TimingFixture() {
+    tester.set_machine(&machine);
+    machine.set_timing_model(Emulator::TimingModel::COSMAC_VIP);
+  }
+
+  void load(const std::vector<unsigned char> &rom) {
+    machine.reset();
+    machine.load_rom(rom);
+  }
+
+  Emulator::Chip8Machine machine;
+  Emulator::Chip8MachineTester tester;
+};
+
+TEST(TimingModelTest, DefaultMachineCountsInstructions) {
+  Emulator::Chip8Machine machine;
+  EXPECT_EQ(Emulator::TimingModel::INSTRUCTIONS, machine.get_timing_model());
+}
+
+TEST_F(TimingFixture, FrameLastsFixedNumberOfCycles) {
+  load(COUNTING_ROM);
+  EXPECT_EQ(Emulator::RunStatus::OK, machine.run_frame(1));
+  EXPECT_EQ(26, tester.get_v(0));
+  EXPECT_EQ(TEST_ROM_START_ADDRESS, tester.get_pc());
+}
+
+TEST_F(TimingFixture, CyclesOverrunningFrameAreTakenFromNextFrame) {
+  load(COUNTING_ROM);
+  int previous = 0;
+  int total = 0;
+  for (int frame = 0; frame < 60; frame++) {
+    machine.run_frame(1);
+    total += (tester.get_v(0) - previous) & 0xFF;
+    previous = tester.get_v(0);
+  }
+  // 60 frames hold 60 * 2612 machine cycles, 102 per iteration;  the
+  // increment of an unfinished iteration fits in the last frame
+  EXPECT_EQ(60 * 2612 / 102 + 1, total);
+}
+
+TEST_F(TimingFixture, FramesAreReproducible) {
+  Emulator::Chip8Machine other;
+  Emulator::Chip8MachineTester other_tester;
+  other_tester.set_machine(&other);
+  other.set_timing_model(Emulator::TimingModel::COSMAC_VIP);
+  std::vector<unsigned char> rom = {
+      0xC1, 0x0F,  // 0x200: V1 = random & 0x0F
+      0xF1, 0x33,  // 0x202: BCD of V1 at I, costs depend on V1
+      0x81, 0x14,  // 0x204: V1 += V1
+      0x70, 0x01,  // 0x206: V0 += 1
+      0x12, 0x00,  // 0x208: jump to 0x200
+  };
+  for (Emulator::Chip8Machine *current : {&machine, &other}) {
+    current->reset();
+    current->load_rom(rom);
+    current->set_seed(3);
+  }
+  tester.set_i(0x300);
+  other_tester.set_i(0x300);
+  for (int frame = 0; frame < 10; frame++) {
+    machine.run_frame(1);
+    other.run_frame(1);
+    EXPECT_EQ(tester.get_v(0), other_tester.get_v(0));
+    EXPECT_EQ(tester.get_pc(), other_tester.get_pc());
+  }
+}
+
+TEST_F(TimingFixture, TimersTickOncePerFrame) {
+  load(COUNTING_ROM);
+  tester.set_delay_timer(0x10);
+  for (int frame = 0; frame < 4; frame++) {
+    machine.run_frame(1);
+  }
+  EXPECT_EQ(0x0C, tester.get_delay_timer());
+}
+
+TEST(TimerTest, TimersOnlyMoveWhenTicked) {
+  Emulator::Chip8Machine machine;
+  machine.reset();
+  machine.load_rom(COUNTING_ROM);
+  Emulator::MachineState state = machine.get_state();
+  state.delay_timer = 2;
+  state.sound_timer = 1;
+  machine.set_state(state);
+
+  machine.run_cycles(1000);
+  EXPECT_EQ(2, machine.get_state().delay_timer);
+  EXPECT_EQ(1, machine.get_state().sound_timer);
+  machine.tick_60hz();
+  EXPECT_EQ(1, machine.get_state().delay_timer);
+  EXPECT_EQ(0, machine.get_state().sound_timer);
+  machine.tick_60hz();
+  machine.tick_60hz();
+  EXPECT_EQ(0, machine.get_state().delay_timer);
+  EXPECT_EQ(0, machine.get_state().sound_timer);
+}
+
+TEST(TimerTest, BuzzerSoundsWhileSoundTimerRuns) {
+  Emulator::Chip8Machine machine;
+  machine.reset();
+  machine.load_rom({
+      0x60, 0x02,  // 0x200: V0 = 0x02
+      0xF0, 0x18,  // 0x202: sound timer = V0
+      0x12, 0x04,  // 0x204: jump to self
+  });
+  EXPECT_FALSE(machine.is_sound_playing());
+  machine.run_frame(10);
+  EXPECT_TRUE(machine.is_sound_playing());
+  machine.run_frame(10);
+  EXPECT_TRUE(machine.is_sound_playing());
+  machine.run_frame(10);
+  EXPECT_FALSE(machine.is_sound_playing());
+}
+
+TEST_F(TimingFixture, DrawingWaitsForStartOfFrame) {
+  load({
+      0x70, 0x01,  // 0x200: V0 += 1
+      0xD1, 0x11,  // 0x202: draw 1 row
+      0x70, 0x01,  // 0x204: V0 += 1
+      0x12, 0x04,  // 0x206: jump to 0x204
+  });
+  tester.set_i(0x300);
+  tester.set_memory_byte(0x300, 0x80);
+  machine.run_frame(1);
+  EXPECT_EQ(TEST_ROM_START_ADDRESS + 2, tester.get_pc());
+  EXPECT_EQ(TEST_OFF_PIXEL, machine.get_pixel(0, 0));
+
+  machine.run_frame(1);
+  EXPECT_EQ(TEST_ON_PIXEL, machine.get_pixel(0, 0));
+}
+
+TEST_F(TimingFixture, UnalignedSpritesTakeLonger) {
+  std::vector<unsigned char> rom = {
+      0xD0, 0x1F,  // 0x200: draw 15 rows at (V0, V1)
+      0x72, 0x01,  // 0x202: V2 += 1
+      0x12, 0x02,  // 0x204: jump to 0x202
+  };
+  load(rom);
+  tester.set_v(0, 8);
+  machine.run_frame(1);
+  int aligned = tester.get_v(2);
+
+  load(rom);
+  tester.set_v(0, 3);
+  tester.set_v(2, 0);
+  machine.set_timing_model(Emulator::TimingModel::COSMAC_VIP);
+  machine.run_frame(1);
+  EXPECT_LT(tester.get_v(2), aligned);
+}
+
+TEST_F(TimingFixture, JumpToSelfEndsFrame) {
+  load({0x12, 0x00});
+  tester.set_delay_timer(0x2);
+  EXPECT_EQ(Emulator::RunStatus::HALTED, machine.run_frame(1));
+  EXPECT_EQ(0x1, tester.get_delay_timer());
+}
+
+TEST_F(TimingFixture, UnsupportedOpcodeEndsFrameWithoutExecuting) {
+  load({0x70, 0x01, 0x90, 0x01});
+  EXPECT_EQ(Emulator::RunStatus::UNSUPPORTED_OPCODE, machine.run_frame(1));
+  EXPECT_EQ(TEST_ROM_START_ADDRESS + 2, machine.get_fault().pc);
+  EXPECT_EQ(TEST_ROM_START_ADDRESS + 2, tester.get_pc());
+}
+
+#ifndef __CLION_IDE_
+#pragma clang diagnostic pop
+#endif
@@ -0,0 +1,136 @@
+#include "upscaler.hpp"
+
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "chip8machine.hpp"
+
+class UpscalerTest : public ::testing::Test {
+ protected:
+  UpscalerTest() { my_machine.reset(); }
+
+  // Arbitrary but irregular screen, so that every span sees both pixel
+  // values
+  void fill_screen() {
+    Emulator::MachineState state = my_machine.get_state();
+    uint64_t bits = 0x9E3779B97F4A7C15u;
+    for (int row = 0; row < my_machine.display_height; row++) {
+      bits ^= bits << 13;
+      bits ^= bits >> 7;
+      bits ^= bits << 17;
+      state.screen[row] = bits;
+    }
+    state.screen[0] = ~uint64_t{0};
+    state.screen[1] = 0;
+    my_machine.set_state(state);
+  }
+
+  // One output pixel at a time, as the upscaler used to
+  template <class Pixel>
+  std::vector<Pixel> upscale_one_pixel_at_a_time(
+      const Emulator::Upscaler &upscaler) const {
+    int width = upscaler.x_scale * my_machine.display_width;
+    int height = upscaler.y_scale * my_machine.display_height;
+    Pixel off = Emulator::Upscaler::convert_color(upscaler.palette.off_color,
+                                                  upscaler.format);
+    Pixel on = Emulator::Upscaler::convert_color(upscaler.palette.on_color,
+                                                 upscaler.format);
+    std::vector<Pixel> frame_buffer(width * height);
+    for (int y = 0; y < height; y++) {
+      for (int x = 0; x < width; x++) {
+        bool pixel_on = my_machine.get_pixel(x / upscaler.x_scale,
+                                             y / upscaler.y_scale) != 0;
+        frame_buffer[y * width + x] = pixel_on ? on : off;
+      }
+    }
+    return frame_buffer;
+  }
+
+  template <class Pixel>
+  std::vector<Pixel> upscale(const Emulator::Upscaler &upscaler) const {
+    int width = upscaler.x_scale * my_machine.display_width;
+    int height = upscaler.y_scale * my_machine.display_height;
+    std::vector<Pixel> frame_buffer(width * height, 0x1234);
+    upscaler.upscale(frame_buffer.data(), width, my_machine);
+    return frame_buffer;
+  }
+
+  Emulator::Chip8Machine my_machine;
+};
+
+TEST_F(UpscalerTest, DefaultsToWhiteOnBlackRgb565TimesEight) {
+  Emulator::Upscaler upscaler;
+  EXPECT_EQ(upscaler.x_scale, 8);
+  EXPECT_EQ(upscaler.y_scale, 8);
+  EXPECT_EQ(upscaler.format, Emulator::PixelFormat::RGB565);
+  EXPECT_EQ(upscaler.get_bytes_per_pixel(), 2);
+  fill_screen();
+  std::vector<uint16_t> frame_buffer = upscale<uint16_t>(upscaler);
+  EXPECT_EQ(frame_buffer[0], 0xFFFF);
+  EXPECT_EQ(frame_buffer[8 * 8 * 64], 0x0000);
+}
+
+TEST_F(UpscalerTest, Rgb565MatchesOnePixelAtATime) {
+  fill_screen();
+  for (int scale = 1; scale <= 10; scale++) {
+    Emulator::Upscaler upscaler(scale, scale + 1,
+                                Emulator::PixelFormat::RGB565,
+                                {0x123456, 0xFEDCBA});
+    EXPECT_EQ(upscale<uint16_t>(upscaler),
+              upscale_one_pixel_at_a_time<uint16_t>(upscaler))
+        << "scale " << scale;
+  }
+}
+
+TEST_F(UpscalerTest, Xrgb8888MatchesOnePixelAtATime) {
+  fill_screen();
+  for (int scale = 1; scale <= 10; scale++) {
+    Emulator::Upscaler upscaler(scale, scale + 1,
+                                Emulator::PixelFormat::XRGB8888,
+                                {0x123456, 0xFEDCBA});
+    EXPECT_EQ(upscale<uint32_t>(upscaler),
+              upscale_one_pixel_at_a_time<uint32_t>(upscaler))
+        << "scale " << scale;
+  }
+}
+
+TEST_F(UpscalerTest, LinesArePlacedByPitch) {
+  fill_screen();
+  Emulator::Upscaler upscaler;
+  int width = upscaler.x_scale * my_machine.display_width;
+  int height = upscaler.y_scale * my_machine.display_height;
+  int pitch = width + 16;
+  std::vector<uint16_t> frame_buffer(pitch * height, 0x1234);
+  upscaler.upscale(frame_buffer.data(), pitch, my_machine);
+  std::vector<uint16_t> expected =
+      upscale_one_pixel_at_a_time<uint16_t>(upscaler);
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      ASSERT_EQ(frame_buffer[y * pitch + x], expected[y * width + x]);
+    }
+    for (int x = width; x < pitch; x++) {
+      ASSERT_EQ(frame_buffer[y * pitch + x], 0x1234);
+    }
+  }
+}
+
+TEST_F(UpscalerTest, ConvertsColorsToPixelFormat) {
+  EXPECT_EQ(Emulator::Upscaler::convert_color(
+                0xFFFFFF, Emulator::PixelFormat::RGB565), 0xFFFFu);
+  EXPECT_EQ(Emulator::Upscaler::convert_color(
+                0xFF0000, Emulator::PixelFormat::RGB565), 0xF800u);
+  EXPECT_EQ(Emulator::Upscaler::convert_color(
+                0x00FF00, Emulator::PixelFormat::RGB565), 0x07E0u);
+  EXPECT_EQ(Emulator::Upscaler::convert_color(
+                0x0000FF, Emulator::PixelFormat::RGB565), 0x001Fu);
+  EXPECT_EQ(Emulator::Upscaler::convert_color(
+                0xFF123456, Emulator::PixelFormat::XRGB8888), 0x123456u);
+}
+
+TEST_F(UpscalerTest, ThrowsOnScaleLessThanOne) {
+  EXPECT_THROW(Emulator::Upscaler(0, 1), std::invalid_argument);
+  EXPECT_THROW(Emulator::Upscaler(1, 0), std::invalid_argument);
+}
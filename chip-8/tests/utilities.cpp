@@ -2,6 +2,8 @@
 
 #include <stdexcept>
 
+#include "test-constants.hpp"
+
 namespace Emulator {
 
 OPCODE_TYPE gen_XYNN_opcode(const int A, const int X, const int NN) {
@@ -54,4 +56,50 @@ Emulator::Chip8Machine create_machine_for_drawing(const OPCODE_TYPE opcode,
   return machine;
 }
 
+// Counts V0 down from 3 in a subroutine, skipping over a jump-to-self once it
+// reaches zero and drawing a sprite along the way
+const std::vector<unsigned char> LOOP_ROM = {
+    0x60, 0x03,  // 0x200: V0 = 3
+    0xA2, 0x20,  // 0x202: I = 0x220
+    0x22, 0x10,  // 0x204: call 0x210
+    0x30, 0x00,  // 0x206: skip if V0 == 0
+    0x12, 0x04,  // 0x208: jump to 0x204
+    0x12, 0x0A,  // 0x20A: jump to self
+    0x00, 0x00,  // 0x20C: padding
+    0x00, 0x00,  // 0x20E: padding
+    0x70, 0xFF,  // 0x210: V0 -= 1
+    0xD0, 0x11,  // 0x212: draw 1 row at (V0, V1)
+    0x00, 0xEE,  // 0x214: return
+    0x00, 0x00,  // 0x216: padding
+    0x00, 0x00,  // 0x218: padding
+    0x00, 0x00,  // 0x21A: padding
+    0x00, 0x00,  // 0x21C: padding
+    0x00, 0x00,  // 0x21E: padding
+    0xF0, 0x00,  // 0x220: sprite data
+};
+
+LockstepFixture::LockstepFixture() {
+  tester.set_machine(&machine);
+  reference_tester.set_machine(&reference);
+}
+
+/// \brief Load the same ROM into both machines, from their default state
+/// \param rom Program to load
+void LockstepFixture::load(const std::vector<unsigned char> &rom) {
+  machine.reset();
+  machine.load_rom(rom);
+  reference.reset();
+  reference.load_rom(rom);
+}
+
+/// \brief Expect the registers and screen of both machines to match
+void LockstepFixture::expect_same_state() {
+  EXPECT_EQ(tester.get_pc(), reference_tester.get_pc());
+  EXPECT_EQ(tester.get_i(), reference_tester.get_i());
+  for (int reg_num = 0; reg_num < TEST_NUM_REGISTERS; reg_num++) {
+    EXPECT_EQ(tester.get_v(reg_num), reference_tester.get_v(reg_num));
+  }
+  EXPECT_EQ(machine.display_str(), reference.display_str());
+}
+
 }  // namespace Emulator
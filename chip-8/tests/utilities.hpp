@@ -3,14 +3,37 @@
 
 #include <vector>
 
+#include "gtest/gtest.h"
+
 #include "chip8machine.hpp"
 
+#include "chip8machinetester.hpp"
+
 namespace Emulator {
 
 OPCODE_TYPE gen_XYNN_opcode(int, int, int);
 OPCODE_TYPE gen_WXYZ_opcode(int, int, int, int);
 Emulator::Chip8Machine create_machine_for_drawing(OPCODE_TYPE, ADDR_TYPE, const std::vector<MEM_TYPE> &, int, int);
 
+/// Counts V0 down in a subroutine, then halts on a jump to self
+extern const std::vector<unsigned char> LOOP_ROM;
+
+/// \class LockstepFixture
+/// \brief Runs a ROM on a machine under test and on a reference machine,
+///        whose states are then compared
+class LockstepFixture : public ::testing::Test {
+ protected:
+  LockstepFixture();
+
+  void load(const std::vector<unsigned char> &);
+  void expect_same_state();
+
+  Emulator::Chip8Machine machine;
+  Emulator::Chip8MachineTester tester;
+  Emulator::Chip8Machine reference;
+  Emulator::Chip8MachineTester reference_tester;
+};
+
 }  // namespace Emulator
 
 #endif  // CHIP_8_TESTS_UTILITIES_HPP_